@@ -1,35 +1,15 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
-#ifdef _WIN32
-#include <windows.h>
-#endif
-
-// C implementation function from separate file
-extern float* imgCvtGrayInttoFloat_C(int n, int *a);
-
-// High-resolution timer function
-double get_time() {
-#ifdef _WIN32
-    LARGE_INTEGER frequency, counter;
-    QueryPerformanceFrequency(&frequency);
-    QueryPerformanceCounter(&counter);
-    return (double)counter.QuadPart / (double)frequency.QuadPart;
-#else
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
-#endif
-}
+#include "imgCvtGray.h"  // C kernel, output writers and timer
 
 // Check correctness of conversion
 int check_correctness(int *int_array, float *float_array, int n) {
     for (int i = 0; i < n; i++) {
         float expected = (float)int_array[i] / 255.0f;
-        float diff = float_array[i] - expected;
-        if (diff < 0) diff = -diff; // absolute value
-        if (diff > 0.001f) { // Allow small floating point error
+        if (float_array[i] != expected) { // Every kernel is bit-exact
             printf("Error at index %d: expected %.6f, got %.6f\n", 
                    i, expected, float_array[i]);
             return 0;
@@ -48,10 +28,17 @@ void manual_mode() {
     printf("Enter width: ");
     scanf("%d", &width);
     
-    int total_elements = height * width;
+    // The product is checked before it is used: the kernel counts pixels
+    // in an int. Worked out in long long, so large sizes cannot wrap.
+    long long pixels = (long long)height * width;
+    if (height <= 0 || width <= 0 || pixels > INT_MAX) {
+        printf("Invalid dimensions: %d x %d\n", height, width);
+        return;
+    }
+    int total_elements = (int)pixels;
     
     // Allocate memory for 2D array (flattened as 1D)
-    int *array = (int *)malloc(total_elements * sizeof(int));
+    int *array = (int *)malloc((size_t)total_elements * sizeof(int));
     
     if (array == NULL) {
         printf("Memory allocation failed\n");
@@ -96,7 +83,7 @@ void manual_mode() {
     printf("Conversion Results (C Implementation)\n");
     printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     printf("Correctness check: PASSED\n");
-    printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+    printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
     printf("\nConverted grayscale values (2D array):\n");
     for (int i = 0; i < height; i++) {
         for (int j = 0; j < width; j++) {
@@ -199,34 +186,37 @@ void automated_mode() {
     
     // For 1000x1000, output to text file
     if (height == 1000 && width == 1000) {
+        double output_start = get_time();
         FILE *file = fopen("output_1000x1000_c.txt", "w");
         if (file != NULL) {
             fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             fprintf(file, "Grayscale Conversion Results (1000x1000) - C Implementation\n");
             fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             fprintf(file, "Correctness check: PASSED\n");
-            fprintf(file, "Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            fprintf(file, "Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
             fprintf(file, "\nGenerated Input (Integer Pixel Values):\n");
-            for (int i = 0; i < height; i++) {
-                for (int j = 0; j < width; j++) {
-                    fprintf(file, "%d ", array[i * width + j]);
-                }
-                fprintf(file, "\n");
-            }
+            write_int_text(file, array, height, width);
             fprintf(file, "\nConverted Output (Float Pixel Values):\n");
-            for (int i = 0; i < height; i++) {
-                for (int j = 0; j < width; j++) {
-                    fprintf(file, "%.2f ", float_array[i * width + j]);
-                }
-                fprintf(file, "\n");
-            }
+            write_float_text(file, float_array, height, width);
             fclose(file);
+            double text_time = get_time() - output_start;
+            
+            // Same frame as raw float32 (GRF1 header + pixels)
+            output_start = get_time();
+            FILE *bin_file = fopen("output_1000x1000_c.bin", "wb");
+            int bin_ok = bin_file != NULL && write_float_binary(bin_file, float_array, height, width) == 0;
+            if (bin_file != NULL) fclose(bin_file);
+            double binary_time = get_time() - output_start;
             printf("\n+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             printf("Results for %dx%d\n", height, width);
             printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             printf("Correctness check: PASSED\n");
-            printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            printf("Output time: %.6f ms (text), %.6f ms (binary)\n", text_time * 1000.0, binary_time * 1000.0);
             printf("Full output saved to: output_1000x1000_c.txt\n");
+            if (bin_ok) {
+                printf("Binary output saved to: output_1000x1000_c.bin\n");
+            }
         } else {
             printf("Error: Could not create output file\n");
             // Fall back to console output
@@ -234,7 +224,7 @@ void automated_mode() {
             printf("Results for %dx%d\n", height, width);
             printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             printf("Correctness check: PASSED\n");
-            printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
             printf("\nSample output (first 5x5 pixels):\n");
             for (int i = 0; i < 5; i++) {
                 for (int j = 0; j < 5; j++) {
@@ -249,7 +239,7 @@ void automated_mode() {
         printf("Results for %dx%d\n", height, width);
         printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
         printf("Correctness check: PASSED\n");
-        printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+        printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
         
         // Display full output for smaller sizes
         printf("\nConverted Output (Float Pixel Values):\n");
@@ -1,4 +1,6 @@
 ; Calculate and convert pixel values from int to float
+%include "asmgrayscale.inc"
+
 section .data
     divisor dd 255.0        ; Single-precision float (32-bit)
 
@@ -6,44 +8,40 @@ section .text
     bits 64
     default rel
     global imgCvtGrayInttoFloat
+    global imgCvtGrayInttoFloat_into
+    global imgCvtGrayInttoFloat_inplace
     extern malloc
 
+; float* imgCvtGrayInttoFloat(int n, int *a)
+; Allocates the float array and converts into it
 imgCvtGrayInttoFloat:
-    push rbp
-    mov rbp, rsp
-    push rbx
-    push r12
-    
-    mov r12, rcx            ; store 1st argument n in r12
-    mov rbx, rdx            ; rbx = pointer to int array
-    
-    ; Allocate memory for float array (n * 4 bytes)
-    mov rcx, r12
-    imul rcx, 4             ; rcx = n * 4
-    sub rsp, 32             ; Shadow space for malloc
-    call malloc
-    add rsp, 32
-    
-    ; Check if malloc failed
-    test rax, rax
-    jz .malloc_failed      ; If NULL, return NULL
-    
-    ; rax now holds pointer to float array
-    mov r10, rax            ; r10 = pointer to output float array
+    ALLOC_AND_CONVERT imgCvtGrayInttoFloat_into
+
+; void imgCvtGrayInttoFloat_inplace(int n, int *a)
+; Converts the n ints at a into floats in the same memory
+imgCvtGrayInttoFloat_inplace:
+    INPLACE_ENTRY imgCvtGrayInttoFloat_into
+
+; void imgCvtGrayInttoFloat_into(int n, int *a, float *out)
+; Converts into a caller-provided array of n floats
+imgCvtGrayInttoFloat_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx         ; rcx = n
+    mov r10, r8             ; r10 = pointer to output float array
     xor r11, r11            ; r11 = counter (i = 0)
     
-    cmp r12, 0
+    cmp rcx, 0
     jle .done
     
 .convert_loop:
-    cmp r11, r12 ; loop through number of elements
+    cmp r11, rcx ; loop through number of elements
     jge .done
     
     ; Load int value from input array
-    mov ecx, dword[rbx + r11*4]  
+    mov eax, dword[rdx + r11*4]  
     
     ; Convert int to float: divide by 255.0
-    cvtsi2ss xmm0, ecx      ; xmm0 = (float)array[i] (use 32-bit register)
+    cvtsi2ss xmm0, eax      ; xmm0 = (float)array[i] (use 32-bit register)
     movss xmm1, [rel divisor]
     divss xmm0, xmm1        ; xmm0 = array[i] / 255.0
     
@@ -52,16 +50,5 @@ imgCvtGrayInttoFloat:
     inc r11
     jmp .convert_loop
     
-.malloc_failed:
-    xor rax, rax            ; Return NULL
-    jmp .cleanup
-    
 .done:
-    mov rax, r10            ; Return pointer to float array
-    
-.cleanup:
-    pop r12
-    pop rbx
-    mov rsp, rbp            ; Restore stack pointer
-    pop rbp                 ; Restore base pointer
-    ret
\ No newline at end of file
+    ret
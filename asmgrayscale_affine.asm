@@ -0,0 +1,305 @@
+; Affine pixel transform kernels: integer pixels to float, IEEE half or
+; bfloat16 in one pass
+;   void f(int n, T *a, U *out, const affine_params_t *params)
+; params points to three floats {divisor, mean, inv_std}, and each pixel
+; becomes
+;   out = ((float)v / divisor - mean) * inv_std
+; with one rounding per step in that order, so the results are
+; bit-identical to the C instantiations in imgCvtGrayAffine_C.c. The
+; divisor is arbitrary, so these divide with vdivps rather than the
+; reciprocal correction of asmgrayscale_simd.asm (exact for 255 only).
+; T is uint8_t, uint16_t or int. U is float, or uint16_t holding the float
+; rounded to nearest even as in asmgrayscale_half.asm: vcvtps2ph for half,
+; add 0x7FFF plus the lowest kept bit for bfloat16. One macro per
+; instruction set generates every routine, with the store steps passed in.
+
+SECTION_RODATA
+    align 32
+    bf16_bias8  times 8 dd 0x00007FFF
+    bf16_lsb8   times 8 dd 0x00000001
+
+section .text
+    bits 64
+    default rel
+    global imgCvtGrayU8toFloat_Affine_AVX2_into
+    global imgCvtGrayU16toFloat_Affine_AVX2_into
+    global imgCvtGrayInttoFloat_Affine_AVX2_into
+    global imgCvtGrayU8toHalf_Affine_AVX2_into
+    global imgCvtGrayU16toHalf_Affine_AVX2_into
+    global imgCvtGrayInttoHalf_Affine_AVX2_into
+    global imgCvtGrayU8toBF16_Affine_AVX2_into
+    global imgCvtGrayU16toBF16_Affine_AVX2_into
+    global imgCvtGrayInttoBF16_Affine_AVX2_into
+    global imgCvtGrayU8toFloat_Affine_AVX512_into
+    global imgCvtGrayU16toFloat_Affine_AVX512_into
+    global imgCvtGrayInttoFloat_Affine_AVX512_into
+    global imgCvtGrayU8toHalf_Affine_AVX512_into
+    global imgCvtGrayU16toHalf_Affine_AVX512_into
+    global imgCvtGrayInttoHalf_Affine_AVX512_into
+    global imgCvtGrayU8toBF16_Affine_AVX512_into
+    global imgCvtGrayU16toBF16_Affine_AVX512_into
+    global imgCvtGrayInttoBF16_Affine_AVX512_into
+
+; Store steps for the AVX2 kernels: 16 results in ymm0 (pixels 0-7) and
+; ymm1 (8-15), 8 results in ymm0, or one result in xmm0, to out[rax].
+; ymm3-ymm5 hold the parameters, so ymm2 is the only scratch register.
+%macro STORE16_FLOAT_AVX2 0
+    vmovups [r8 + rax*4], ymm0
+    vmovups [r8 + rax*4 + 32], ymm1
+%endmacro
+
+%macro STORE8_FLOAT_AVX2 0
+    vmovups [r8 + rax*4], ymm0
+%endmacro
+
+%macro STORE1_FLOAT 0
+    vmovss dword [r8 + rax*4], xmm0
+%endmacro
+
+%macro STORE16_HALF_AVX2 0
+    vcvtps2ph [r8 + rax*2], ymm0, 0
+    vcvtps2ph [r8 + rax*2 + 16], ymm1, 0
+%endmacro
+
+%macro STORE8_HALF_AVX2 0
+    vcvtps2ph [r8 + rax*2], ymm0, 0
+%endmacro
+
+%macro STORE1_HALF 0
+    vcvtps2ph xmm0, xmm0, 0
+    vpextrw word [r8 + rax*2], xmm0, 0
+%endmacro
+
+; %1 = 8 floats, rounded in place to bfloat16 in the low word of each
+; dword; %2 = temp
+%macro BF16_ROUND_AVX2 2
+    vpsrld %2, %1, 16
+    vpand %2, %2, [rel bf16_lsb8]       ; Lowest kept bit
+    vpaddd %1, %1, [rel bf16_bias8]
+    vpaddd %1, %1, %2
+    vpsrld %1, %1, 16
+%endmacro
+
+%macro STORE16_BF16_AVX2 0
+    BF16_ROUND_AVX2 ymm0, ymm2
+    BF16_ROUND_AVX2 ymm1, ymm2
+    vpackusdw ymm0, ymm0, ymm1          ; Words, interleaved by 128-bit lane
+    vpermq ymm0, ymm0, 0xD8             ; Back in pixel order
+    vmovdqu [r8 + rax*2], ymm0
+%endmacro
+
+%macro STORE8_BF16_AVX2 0
+    BF16_ROUND_AVX2 ymm0, ymm2
+    vextracti128 xmm1, ymm0, 1
+    vpackusdw xmm0, xmm0, xmm1
+    vmovdqu [r8 + rax*2], xmm0
+%endmacro
+
+%macro STORE1_BF16 0
+    vmovd r10d, xmm0
+    mov r11d, r10d
+    shr r11d, 16
+    and r11d, 1
+    add r10d, 0x7FFF
+    add r10d, r11d
+    shr r10d, 16
+    mov word [r8 + rax*2], r10w
+%endmacro
+
+; ---------------------------------------------------------------------------
+; AVX2: 16 pixels per iteration (2 x 8), then 8 per iteration, scalar tail
+; %1 = routine name
+; %2 = vector load of 8 pixels as int32 (vpmovzxbd, vpmovzxwd or vmovdqu)
+; %3 = operand size of that load
+; %4 = bytes per input pixel
+; %5 = scalar load of 1 pixel into r10d (movzx or mov)
+; %6 = operand size of that load
+; %7 = 16-pixel store macro
+; %8 = 8-pixel store macro
+; %9 = 1-pixel store macro
+; ---------------------------------------------------------------------------
+%macro AFFINE_AVX2 9
+%1:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle %%ret
+
+    vbroadcastss ymm3, [r9]         ; ymm3 = divisor
+    vbroadcastss ymm4, [r9 + 4]     ; ymm4 = mean
+    vbroadcastss ymm5, [r9 + 8]     ; ymm5 = inv_std
+    xor eax, eax            ; rax = counter (i = 0)
+
+    mov r10, rcx
+    and r10, -16
+    jz %%loop8_check
+
+%%loop16:
+    %2 ymm0, %3 [rdx + rax*%4]          ; x = a[i..i+7] as int32
+    %2 ymm1, %3 [rdx + rax*%4 + 8*%4]
+    vcvtdq2ps ymm0, ymm0
+    vcvtdq2ps ymm1, ymm1
+    vdivps ymm0, ymm0, ymm3             ; x / divisor
+    vdivps ymm1, ymm1, ymm3
+    vsubps ymm0, ymm0, ymm4             ; - mean
+    vsubps ymm1, ymm1, ymm4
+    vmulps ymm0, ymm0, ymm5             ; * inv_std
+    vmulps ymm1, ymm1, ymm5
+    %7
+    add rax, 16
+    cmp rax, r10
+    jl %%loop16
+
+%%loop8_check:
+    mov r10, rcx
+    and r10, -8
+    cmp rax, r10
+    jge %%tail_check
+
+    %2 ymm0, %3 [rdx + rax*%4]
+    vcvtdq2ps ymm0, ymm0
+    vdivps ymm0, ymm0, ymm3
+    vsubps ymm0, ymm0, ymm4
+    vmulps ymm0, ymm0, ymm5
+    %8
+    add rax, 8
+
+%%tail_check:
+    cmp rax, rcx
+    jge %%done
+
+%%tail:                     ; Remaining 1-7 pixels
+    %5 r10d, %6 [rdx + rax*%4]
+    vcvtsi2ss xmm0, xmm0, r10d
+    vdivss xmm0, xmm0, xmm3
+    vsubss xmm0, xmm0, xmm4
+    vmulss xmm0, xmm0, xmm5
+    %9
+    inc rax
+    cmp rax, rcx
+    jl %%tail
+
+%%done:
+    vzeroupper
+%%ret:
+    ret
+%endmacro
+
+; Store steps for the AVX-512 kernels: 16 results in %2 to %1, a memory
+; operand that may carry a {k1} mask. zmm2 is scratch.
+%macro STORE_FLOAT_AVX512 2
+    vmovups %1, %2
+%endmacro
+
+%macro STORE_HALF_AVX512 2
+    vcvtps2ph %1, %2, 0
+%endmacro
+
+%macro STORE_BF16_AVX512 2
+    vpsrld zmm2, %2, 16
+    vpandd zmm2, zmm2, [rel bf16_lsb8]{1to16}   ; Lowest kept bit
+    vpaddd %2, %2, [rel bf16_bias8]{1to16}
+    vpaddd %2, %2, zmm2
+    vpsrld %2, %2, 16
+    vpmovdw %1, %2                      ; Keep the low word of each dword
+%endmacro
+
+; ---------------------------------------------------------------------------
+; AVX-512: 32 pixels per iteration (2 x 16), then 16 per iteration, masked
+; tail (masked-off pixels are never read)
+; %1 = routine name
+; %2 = vector load of 16 pixels as int32 (vpmovzxbd, vpmovzxwd or vmovdqu32)
+; %3 = bytes per input pixel
+; %4 = store macro
+; %5 = bytes per output pixel
+; ---------------------------------------------------------------------------
+%macro AFFINE_AVX512 5
+%1:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle %%ret
+
+    vbroadcastss zmm3, [r9]         ; zmm3 = divisor
+    vbroadcastss zmm4, [r9 + 4]     ; zmm4 = mean
+    vbroadcastss zmm5, [r9 + 8]     ; zmm5 = inv_std
+    xor eax, eax
+
+    mov r10, rcx
+    and r10, -32
+    jz %%loop16_check
+
+%%loop32:
+    %2 zmm0, [rdx + rax*%3]
+    %2 zmm1, [rdx + rax*%3 + 16*%3]
+    vcvtdq2ps zmm0, zmm0
+    vcvtdq2ps zmm1, zmm1
+    vdivps zmm0, zmm0, zmm3
+    vdivps zmm1, zmm1, zmm3
+    vsubps zmm0, zmm0, zmm4
+    vsubps zmm1, zmm1, zmm4
+    vmulps zmm0, zmm0, zmm5
+    vmulps zmm1, zmm1, zmm5
+    %4 [r8 + rax*%5], zmm0
+    %4 [r8 + rax*%5 + 16*%5], zmm1
+    add rax, 32
+    cmp rax, r10
+    jl %%loop32
+
+%%loop16_check:
+    mov r10, rcx
+    and r10, -16
+    cmp rax, r10
+    jge %%tail
+
+    %2 zmm0, [rdx + rax*%3]
+    vcvtdq2ps zmm0, zmm0
+    vdivps zmm0, zmm0, zmm3
+    vsubps zmm0, zmm0, zmm4
+    vmulps zmm0, zmm0, zmm5
+    %4 [r8 + rax*%5], zmm0
+    add rax, 16
+
+%%tail:                     ; Remaining 1-15 pixels with a k-mask
+    sub rcx, rax
+    jz %%done
+    mov r10d, 1
+    shl r10d, cl
+    dec r10d                ; r10 = (1 << remaining) - 1
+    kmovw k1, r10d
+    %2 zmm0{k1}{z}, [rdx + rax*%3]
+    vcvtdq2ps zmm0, zmm0
+    vdivps zmm0, zmm0, zmm3
+    vsubps zmm0, zmm0, zmm4
+    vmulps zmm0, zmm0, zmm5
+    %4 [r8 + rax*%5]{k1}, zmm0
+
+%%done:
+    vzeroupper
+%%ret:
+    ret
+%endmacro
+
+AFFINE_AVX2 imgCvtGrayU8toFloat_Affine_AVX2_into, vpmovzxbd, qword, 1, movzx, byte, STORE16_FLOAT_AVX2, STORE8_FLOAT_AVX2, STORE1_FLOAT
+AFFINE_AVX2 imgCvtGrayU16toFloat_Affine_AVX2_into, vpmovzxwd, oword, 2, movzx, word, STORE16_FLOAT_AVX2, STORE8_FLOAT_AVX2, STORE1_FLOAT
+AFFINE_AVX2 imgCvtGrayInttoFloat_Affine_AVX2_into, vmovdqu, yword, 4, mov, dword, STORE16_FLOAT_AVX2, STORE8_FLOAT_AVX2, STORE1_FLOAT
+
+AFFINE_AVX2 imgCvtGrayU8toHalf_Affine_AVX2_into, vpmovzxbd, qword, 1, movzx, byte, STORE16_HALF_AVX2, STORE8_HALF_AVX2, STORE1_HALF
+AFFINE_AVX2 imgCvtGrayU16toHalf_Affine_AVX2_into, vpmovzxwd, oword, 2, movzx, word, STORE16_HALF_AVX2, STORE8_HALF_AVX2, STORE1_HALF
+AFFINE_AVX2 imgCvtGrayInttoHalf_Affine_AVX2_into, vmovdqu, yword, 4, mov, dword, STORE16_HALF_AVX2, STORE8_HALF_AVX2, STORE1_HALF
+
+AFFINE_AVX2 imgCvtGrayU8toBF16_Affine_AVX2_into, vpmovzxbd, qword, 1, movzx, byte, STORE16_BF16_AVX2, STORE8_BF16_AVX2, STORE1_BF16
+AFFINE_AVX2 imgCvtGrayU16toBF16_Affine_AVX2_into, vpmovzxwd, oword, 2, movzx, word, STORE16_BF16_AVX2, STORE8_BF16_AVX2, STORE1_BF16
+AFFINE_AVX2 imgCvtGrayInttoBF16_Affine_AVX2_into, vmovdqu, yword, 4, mov, dword, STORE16_BF16_AVX2, STORE8_BF16_AVX2, STORE1_BF16
+
+AFFINE_AVX512 imgCvtGrayU8toFloat_Affine_AVX512_into, vpmovzxbd, 1, STORE_FLOAT_AVX512, 4
+AFFINE_AVX512 imgCvtGrayU16toFloat_Affine_AVX512_into, vpmovzxwd, 2, STORE_FLOAT_AVX512, 4
+AFFINE_AVX512 imgCvtGrayInttoFloat_Affine_AVX512_into, vmovdqu32, 4, STORE_FLOAT_AVX512, 4
+
+AFFINE_AVX512 imgCvtGrayU8toHalf_Affine_AVX512_into, vpmovzxbd, 1, STORE_HALF_AVX512, 2
+AFFINE_AVX512 imgCvtGrayU16toHalf_Affine_AVX512_into, vpmovzxwd, 2, STORE_HALF_AVX512, 2
+AFFINE_AVX512 imgCvtGrayInttoHalf_Affine_AVX512_into, vmovdqu32, 4, STORE_HALF_AVX512, 2
+
+AFFINE_AVX512 imgCvtGrayU8toBF16_Affine_AVX512_into, vpmovzxbd, 1, STORE_BF16_AVX512, 2
+AFFINE_AVX512 imgCvtGrayU16toBF16_Affine_AVX512_into, vpmovzxwd, 2, STORE_BF16_AVX512, 2
+AFFINE_AVX512 imgCvtGrayInttoBF16_Affine_AVX512_into, vmovdqu32, 4, STORE_BF16_AVX512, 2
@@ -0,0 +1,213 @@
+; 16-bit output kernels: integer pixels to IEEE half or bfloat16
+;   void f(int n, T *a, uint16_t *out)
+; Each pixel is first converted exactly as in asmgrayscale_simd.asm,
+; (float)v / 255.0f via the reciprocal multiply plus FMA correction, and
+; then rounded to nearest even:
+;   half     vcvtps2ph with rounding mode 0 (F16C, or AVX-512 for zmm)
+;   bfloat16 the top 16 bits of the float after adding 0x7FFF plus the
+;            lowest kept bit (inputs are integers, so never NaN)
+; Results are bit-identical to imgCvtGrayHalf_C.c. T is int or uint8_t;
+; the same macros generate both, with the store step passed in as a macro.
+
+section .data
+    align 32
+    recip_255   dd 0x3B808081           ; 1.0f / 255.0f
+    const_255   dd 255.0
+    bf16_bias   dd 0x00007FFF
+    bf16_lsb    dd 0x00000001
+    align 32
+    bf16_bias8  times 8 dd 0x00007FFF
+    bf16_lsb8   times 8 dd 0x00000001
+
+section .text
+    bits 64
+    default rel
+    global imgCvtGrayInttoHalf_AVX2_into
+    global imgCvtGrayU8toHalf_AVX2_into
+    global imgCvtGrayInttoBF16_AVX2_into
+    global imgCvtGrayU8toBF16_AVX2_into
+    global imgCvtGrayInttoHalf_AVX512_into
+    global imgCvtGrayU8toHalf_AVX512_into
+    global imgCvtGrayInttoBF16_AVX512_into
+    global imgCvtGrayU8toBF16_AVX512_into
+
+; x = x / 255 exactly
+; %1 = x, %2 = temp, %3 = 1/255, %4 = 255.0
+%macro DIV255 4
+    vmulps %2, %1, %3       ; q = x * (1/255)
+    vfnmadd231ps %1, %2, %4 ; e = x - q*255
+    vfmadd132ps %1, %2, %3  ; q + e/255
+%endmacro
+
+; Store steps for the AVX2 kernels: 16 results in ymm0 (pixels 0-7) and
+; ymm1 (8-15) to out[rax], or one result in xmm0 for the scalar tail
+%macro STORE16_HALF_AVX2 0
+    vcvtps2ph [r8 + rax*2], ymm0, 0
+    vcvtps2ph [r8 + rax*2 + 16], ymm1, 0
+%endmacro
+
+%macro STORE16_BF16_AVX2 0
+    vpsrld ymm2, ymm0, 16
+    vpsrld ymm3, ymm1, 16
+    vpand ymm2, ymm2, [rel bf16_lsb8]   ; Lowest kept bit
+    vpand ymm3, ymm3, [rel bf16_lsb8]
+    vpaddd ymm0, ymm0, [rel bf16_bias8]
+    vpaddd ymm1, ymm1, [rel bf16_bias8]
+    vpaddd ymm0, ymm0, ymm2
+    vpaddd ymm1, ymm1, ymm3
+    vpsrld ymm0, ymm0, 16
+    vpsrld ymm1, ymm1, 16
+    vpackusdw ymm0, ymm0, ymm1          ; Words, interleaved by 128-bit lane
+    vpermq ymm0, ymm0, 0xD8             ; Back in pixel order
+    vmovdqu [r8 + rax*2], ymm0
+%endmacro
+
+%macro STORE1_HALF 0
+    vcvtps2ph xmm0, xmm0, 0
+    vpextrw word [r8 + rax*2], xmm0, 0
+%endmacro
+
+%macro STORE1_BF16 0
+    vmovd r10d, xmm0
+    mov r11d, r10d
+    shr r11d, 16
+    and r11d, 1
+    add r10d, 0x7FFF
+    add r10d, r11d
+    shr r10d, 16
+    mov word [r8 + rax*2], r10w
+%endmacro
+
+; ---------------------------------------------------------------------------
+; AVX2 + FMA + F16C: 16 pixels per iteration, scalar tail
+; %1 = routine name
+; %2 = vector load of 8 pixels as int32 (vpmovzxbd or vmovdqu)
+; %3 = operand size of that load
+; %4 = bytes per input pixel
+; %5 = scalar load of 1 pixel into r9d (movzx or mov)
+; %6 = operand size of that load
+; %7 = 16-pixel store macro
+; %8 = 1-pixel store macro
+; ---------------------------------------------------------------------------
+%macro HALF_AVX2 8
+%1:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle %%ret
+
+    vbroadcastss ymm4, [rel recip_255]  ; ymm4 = 1/255 (hoisted)
+    vbroadcastss ymm5, [rel const_255]  ; ymm5 = 255.0
+    xor eax, eax            ; rax = counter (i = 0)
+
+    mov r9, rcx
+    and r9, -16
+    jz %%tail_check
+
+%%loop16:
+    %2 ymm0, %3 [rdx + rax*%4]          ; x = a[i..i+7] as int32
+    %2 ymm1, %3 [rdx + rax*%4 + 8*%4]
+    vcvtdq2ps ymm0, ymm0
+    vcvtdq2ps ymm1, ymm1
+    DIV255 ymm0, ymm2, ymm4, ymm5
+    DIV255 ymm1, ymm3, ymm4, ymm5
+    %7
+    add rax, 16
+    cmp rax, r9
+    jl %%loop16
+
+%%tail_check:
+    cmp rax, rcx
+    jge %%done
+
+%%tail:                     ; Remaining 1-15 pixels: divss is exact
+    %5 r9d, %6 [rdx + rax*%4]
+    vcvtsi2ss xmm0, xmm0, r9d
+    vdivss xmm0, xmm0, xmm5
+    %8
+    inc rax
+    cmp rax, rcx
+    jl %%tail
+
+%%done:
+    vzeroupper
+%%ret:
+    ret
+%endmacro
+
+; Store steps for the AVX-512 kernels: 16 results in zmm0 to %1, a
+; memory operand that may carry a {k1} mask
+%macro STORE_HALF_AVX512 1
+    vcvtps2ph %1, zmm0, 0
+%endmacro
+
+%macro STORE_BF16_AVX512 1
+    vpsrld zmm2, zmm0, 16
+    vpandd zmm2, zmm2, zmm29            ; Lowest kept bit
+    vpaddd zmm0, zmm0, zmm28
+    vpaddd zmm0, zmm0, zmm2
+    vpsrld zmm0, zmm0, 16
+    vpmovdw %1, zmm0                    ; Keep the low word of each dword
+%endmacro
+
+; ---------------------------------------------------------------------------
+; AVX-512: 16 pixels per iteration, masked tail (masked-off pixels are
+; never read or written)
+; %1 = routine name
+; %2 = vector load of 16 pixels as int32 (vpmovzxbd or vmovdqu32)
+; %3 = bytes per input pixel
+; %4 = store macro
+; ---------------------------------------------------------------------------
+%macro HALF_AVX512 4
+%1:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle %%ret
+
+    vbroadcastss zmm30, [rel recip_255] ; zmm30 = 1/255 (hoisted)
+    vbroadcastss zmm31, [rel const_255] ; zmm31 = 255.0
+    vpbroadcastd zmm28, [rel bf16_bias]
+    vpbroadcastd zmm29, [rel bf16_lsb]
+    xor eax, eax
+
+    mov r9, rcx
+    and r9, -16
+    jz %%tail
+
+%%loop16:
+    %2 zmm0, [rdx + rax*%3]
+    vcvtdq2ps zmm0, zmm0
+    DIV255 zmm0, zmm1, zmm30, zmm31
+    %4 [r8 + rax*2]
+    add rax, 16
+    cmp rax, r9
+    jl %%loop16
+
+%%tail:                     ; Remaining 1-15 pixels with a k-mask
+    sub rcx, rax
+    jz %%done
+    mov r9d, 1
+    shl r9d, cl
+    dec r9d                 ; r9 = (1 << remaining) - 1
+    kmovw k1, r9d
+    %2 zmm0{k1}{z}, [rdx + rax*%3]
+    vcvtdq2ps zmm0, zmm0
+    DIV255 zmm0, zmm1, zmm30, zmm31
+    %4 [r8 + rax*2]{k1}
+
+%%done:
+    vzeroupper
+%%ret:
+    ret
+%endmacro
+
+HALF_AVX2 imgCvtGrayInttoHalf_AVX2_into, vmovdqu, yword, 4, mov, dword, STORE16_HALF_AVX2, STORE1_HALF
+HALF_AVX2 imgCvtGrayU8toHalf_AVX2_into, vpmovzxbd, qword, 1, movzx, byte, STORE16_HALF_AVX2, STORE1_HALF
+HALF_AVX2 imgCvtGrayInttoBF16_AVX2_into, vmovdqu, yword, 4, mov, dword, STORE16_BF16_AVX2, STORE1_BF16
+HALF_AVX2 imgCvtGrayU8toBF16_AVX2_into, vpmovzxbd, qword, 1, movzx, byte, STORE16_BF16_AVX2, STORE1_BF16
+
+HALF_AVX512 imgCvtGrayInttoHalf_AVX512_into, vmovdqu32, 4, STORE_HALF_AVX512
+HALF_AVX512 imgCvtGrayU8toHalf_AVX512_into, vpmovzxbd, 1, STORE_HALF_AVX512
+HALF_AVX512 imgCvtGrayInttoBF16_AVX512_into, vmovdqu32, 4, STORE_BF16_AVX512
+HALF_AVX512 imgCvtGrayU8toBF16_AVX512_into, vpmovzxbd, 1, STORE_BF16_AVX512
@@ -0,0 +1,252 @@
+; Inverse conversion kernels: float pixel values (0.0-1.0) back to 8-bit
+; levels, written as uint8_t or int
+;   void f(int n, float *a, T *out)
+; Each value is scaled by 255, clamped to [0, 255] and rounded to nearest
+; even with cvtps2dq (the default MXCSR mode):
+;   out = round(min(max(x * 255, 0), 255))
+; The clamp runs in float, before the conversion, so values too large for
+; int32 still saturate to 255; max with zero as the second operand also
+; turns NaN into 0. For uint8_t output packusdw/packuswb (or vpmovusdb)
+; narrow the results. Bit-identical to imgCvtGrayFloattoInt_C.c, and for
+; every 8-bit level v, (float)v / 255.0f comes back as v.
+
+section .data
+    align 64
+    const_255   times 8 dd 255.0
+    const_zero  times 8 dd 0.0
+    ; vpermd order that undoes the per-lane interleave of vpackusdw +
+    ; vpackuswb on ymm registers
+    pack_order  dd 0, 4, 1, 5, 2, 6, 3, 7
+
+section .text
+    bits 64
+    default rel
+    global imgCvtGrayFloattoU8_SSE41_into
+    global imgCvtGrayFloattoInt_SSE41_into
+    global imgCvtGrayFloattoU8_AVX2_into
+    global imgCvtGrayFloattoInt_AVX2_into
+    global imgCvtGrayFloattoU8_AVX512_into
+    global imgCvtGrayFloattoInt_AVX512_into
+
+; Store steps: 16 (SSE4.1, xmm0-xmm3) or 32 (AVX2, ymm0-ymm3) rounded
+; int32 results to out[rax], or one result in r9d for the scalar tail
+%macro STORE16_U8_SSE41 0
+    packusdw xmm0, xmm1
+    packusdw xmm2, xmm3
+    packuswb xmm0, xmm2
+    movdqu [r8 + rax], xmm0
+%endmacro
+
+%macro STORE16_INT_SSE41 0
+    movdqu [r8 + rax*4], xmm0
+    movdqu [r8 + rax*4 + 16], xmm1
+    movdqu [r8 + rax*4 + 32], xmm2
+    movdqu [r8 + rax*4 + 48], xmm3
+%endmacro
+
+%macro STORE32_U8_AVX2 0
+    vpackusdw ymm0, ymm0, ymm1
+    vpackusdw ymm2, ymm2, ymm3
+    vpackuswb ymm0, ymm0, ymm2
+    vpermd ymm0, ymm4, ymm0
+    vmovdqu [r8 + rax], ymm0
+%endmacro
+
+%macro STORE32_INT_AVX2 0
+    vmovdqu [r8 + rax*4], ymm0
+    vmovdqu [r8 + rax*4 + 32], ymm1
+    vmovdqu [r8 + rax*4 + 64], ymm2
+    vmovdqu [r8 + rax*4 + 96], ymm3
+%endmacro
+
+%macro STORE1_U8 0
+    mov byte [r8 + rax], r9b
+%endmacro
+
+%macro STORE1_INT 0
+    mov dword [r8 + rax*4], r9d
+%endmacro
+
+; Scale, clamp and round one register of floats
+; %1 = x, %2 = 255.0, %3 = 0.0
+%macro CLAMP_ROUND_SSE 3
+    mulps %1, %2
+    maxps %1, %3            ; NaN -> 0 (second operand wins)
+    minps %1, %2
+    cvtps2dq %1, %1
+%endmacro
+
+%macro CLAMP_ROUND_AVX 3
+    vmulps %1, %1, %2
+    vmaxps %1, %1, %3
+    vminps %1, %1, %2
+    vcvtps2dq %1, %1
+%endmacro
+
+; One pixel in xmm0 to r9d (scalar tails)
+%macro CLAMP_ROUND_SCALAR 0
+    vmulss xmm0, xmm0, xmm5
+    vmaxss xmm0, xmm0, xmm2
+    vminss xmm0, xmm0, xmm5
+    vcvtss2si r9d, xmm0
+%endmacro
+
+; ---------------------------------------------------------------------------
+; SSE4.1: 16 pixels per iteration (4 x 4), scalar tail
+; %1 = routine name, %2 = 16-pixel store, %3 = 1-pixel store
+; ---------------------------------------------------------------------------
+%macro INVERSE_SSE41 3
+%1:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle %%ret
+
+    movaps xmm5, [rel const_255]    ; xmm5 = 255.0 (hoisted)
+    xorps xmm4, xmm4                ; xmm4 = 0.0
+    xor eax, eax            ; rax = counter (i = 0)
+
+    mov r9, rcx
+    and r9, -16
+    jz %%tail_check
+
+%%loop16:
+    movups xmm0, [rdx + rax*4]
+    movups xmm1, [rdx + rax*4 + 16]
+    movups xmm2, [rdx + rax*4 + 32]
+    movups xmm3, [rdx + rax*4 + 48]
+    CLAMP_ROUND_SSE xmm0, xmm5, xmm4
+    CLAMP_ROUND_SSE xmm1, xmm5, xmm4
+    CLAMP_ROUND_SSE xmm2, xmm5, xmm4
+    CLAMP_ROUND_SSE xmm3, xmm5, xmm4
+    %2
+    add rax, 16
+    cmp rax, r9
+    jl %%loop16
+
+%%tail_check:
+    cmp rax, rcx
+    jge %%ret
+
+%%tail:                     ; Remaining 1-15 pixels
+    movss xmm0, [rdx + rax*4]
+    mulss xmm0, xmm5
+    maxss xmm0, xmm4
+    minss xmm0, xmm5
+    cvtss2si r9d, xmm0
+    %3
+    inc rax
+    cmp rax, rcx
+    jl %%tail
+
+%%ret:
+    ret
+%endmacro
+
+; ---------------------------------------------------------------------------
+; AVX2: 32 pixels per iteration (4 x 8), scalar tail
+; %1 = routine name, %2 = 32-pixel store, %3 = 1-pixel store
+; ---------------------------------------------------------------------------
+%macro INVERSE_AVX2 3
+%1:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle %%ret
+
+    vmovaps ymm5, [rel const_255]   ; ymm5 = 255.0 (hoisted)
+    vmovdqu ymm4, [rel pack_order]
+    xor eax, eax
+
+    mov r9, rcx
+    and r9, -32
+    jz %%tail_check
+
+%%loop32:
+    vmovups ymm0, [rdx + rax*4]
+    vmovups ymm1, [rdx + rax*4 + 32]
+    vmovups ymm2, [rdx + rax*4 + 64]
+    vmovups ymm3, [rdx + rax*4 + 96]
+    CLAMP_ROUND_AVX ymm0, ymm5, [rel const_zero]
+    CLAMP_ROUND_AVX ymm1, ymm5, [rel const_zero]
+    CLAMP_ROUND_AVX ymm2, ymm5, [rel const_zero]
+    CLAMP_ROUND_AVX ymm3, ymm5, [rel const_zero]
+    %2
+    add rax, 32
+    cmp rax, r9
+    jl %%loop32
+
+%%tail_check:
+    cmp rax, rcx
+    jge %%done
+    vxorps xmm2, xmm2, xmm2         ; xmm2 = 0.0
+
+%%tail:                     ; Remaining 1-31 pixels
+    vmovss xmm0, [rdx + rax*4]
+    CLAMP_ROUND_SCALAR
+    %3
+    inc rax
+    cmp rax, rcx
+    jl %%tail
+
+%%done:
+    vzeroupper
+%%ret:
+    ret
+%endmacro
+
+; ---------------------------------------------------------------------------
+; AVX-512: 16 pixels per iteration, masked tail (masked-off pixels are
+; never read or written)
+; %1 = routine name
+; %2 = store of 16 int32 results (vpmovusdb narrows to bytes)
+; %3 = bytes per output pixel
+; ---------------------------------------------------------------------------
+%macro INVERSE_AVX512 3
+%1:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle %%ret
+
+    vbroadcastss zmm31, [rel const_255] ; zmm31 = 255.0 (hoisted)
+    vpxord zmm30, zmm30, zmm30          ; zmm30 = 0.0
+    xor eax, eax
+
+    mov r9, rcx
+    and r9, -16
+    jz %%tail
+
+%%loop16:
+    vmovups zmm0, [rdx + rax*4]
+    CLAMP_ROUND_AVX zmm0, zmm31, zmm30
+    %2 [r8 + rax*%3], zmm0
+    add rax, 16
+    cmp rax, r9
+    jl %%loop16
+
+%%tail:                     ; Remaining 1-15 pixels with a k-mask
+    sub rcx, rax
+    jz %%done
+    mov r9d, 1
+    shl r9d, cl
+    dec r9d                 ; r9 = (1 << remaining) - 1
+    kmovw k1, r9d
+    vmovups zmm0{k1}{z}, [rdx + rax*4]
+    CLAMP_ROUND_AVX zmm0, zmm31, zmm30
+    %2 [r8 + rax*%3]{k1}, zmm0
+
+%%done:
+    vzeroupper
+%%ret:
+    ret
+%endmacro
+
+INVERSE_SSE41 imgCvtGrayFloattoU8_SSE41_into, STORE16_U8_SSE41, STORE1_U8
+INVERSE_SSE41 imgCvtGrayFloattoInt_SSE41_into, STORE16_INT_SSE41, STORE1_INT
+
+INVERSE_AVX2 imgCvtGrayFloattoU8_AVX2_into, STORE32_U8_AVX2, STORE1_U8
+INVERSE_AVX2 imgCvtGrayFloattoInt_AVX2_into, STORE32_INT_AVX2, STORE1_INT
+
+INVERSE_AVX512 imgCvtGrayFloattoU8_AVX512_into, vpmovusdb, 1
+INVERSE_AVX512 imgCvtGrayFloattoInt_AVX512_into, vmovdqu32, 4
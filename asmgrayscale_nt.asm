@@ -0,0 +1,662 @@
+; Streaming-store (non-temporal) versions of the packed SIMD kernels
+;   void f(int n, int *a, float *out)       int input
+;   void f(int n, uint8_t *a, float *out)   uint8_t input
+; Same conversion as asmgrayscale_simd.asm / asmgrayscale_u8.asm
+; (bit-identical to (float)v / 255.0f), but the main loops write with
+; movntps / vmovntps. Ordinary stores read every output line into the cache
+; before overwriting it (read-for-ownership); streaming stores go straight
+; to memory through the write-combining buffers, which saves that read and
+; leaves the caches alone. That only pays off when the output is larger
+; than the last-level cache, so these are used above nt_threshold_pixels()
+; and not registered as kernels of their own.
+;
+; out only needs the alignment of a float: a short head runs up to the
+; first vector-aligned address, as movntps requires. Input is prefetched
+; PREFETCH_INT / PREFETCH_U8 bytes ahead with prefetcht0 (prefetchnta
+; measured slower than no prefetch at all on a Xeon, 0.5-0.9x). Every
+; routine ends with sfence, so the streamed data is visible to other
+; threads by the time it returns.
+
+%define PREFETCH_INT 4096   ; 1024 pixels of int input ahead
+%define PREFETCH_U8  1024   ; The same number of pixels of uint8_t input
+
+section .data
+    align 64
+    recip_255   times 16 dd 0x3B808081  ; 1.0f / 255.0f
+    const_255   times 16 dd 255.0
+    lane_index  dd 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+
+section .text
+    bits 64
+    default rel
+    global imgCvtGrayInttoFloat_SSE2_NT_into
+    global imgCvtGrayInttoFloat_AVX2_NT_into
+    global imgCvtGrayInttoFloat_AVX512_NT_into
+    global imgCvtGrayU8toFloat_SSE41_NT_into
+    global imgCvtGrayU8toFloat_AVX2_NT_into
+    global imgCvtGrayU8toFloat_AVX512_NT_into
+
+; ---------------------------------------------------------------------------
+; SSE2, int input: scalar head to a 16-byte boundary, 8 pixels per
+; iteration (2 x 4), then 4, scalar tail. divps, as in the ordinary SSE2
+; kernel: the residual step is only exact with FMA.
+; ---------------------------------------------------------------------------
+imgCvtGrayInttoFloat_SSE2_NT_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    movaps xmm5, [rel const_255]    ; xmm5 = 255.0 (hoisted)
+    xor eax, eax            ; rax = counter (i = 0)
+
+    mov r9, r8
+    neg r9
+    and r9, 15
+    shr r9, 2               ; r9 = pixels before out is 16-byte aligned (0-3)
+    cmp r9, rcx
+    cmova r9, rcx
+    jmp .head_check
+
+.head:
+    cvtsi2ss xmm0, dword [rdx + rax*4]
+    divss xmm0, xmm5
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+.head_check:
+    cmp rax, r9
+    jl .head
+
+    mov r9, rcx
+    sub r9, rax
+    and r9, -8
+    add r9, rax             ; r9 = end of the 8-pixel blocks
+    cmp rax, r9
+    jge .loop4_check
+
+.loop8:
+    prefetcht0 [rdx + rax*4 + PREFETCH_INT]
+    movdqu xmm0, [rdx + rax*4]
+    movdqu xmm1, [rdx + rax*4 + 16]
+    cvtdq2ps xmm0, xmm0     ; x = (float)a[i..i+3]
+    cvtdq2ps xmm1, xmm1
+    divps xmm0, xmm5        ; x / 255
+    divps xmm1, xmm5
+    movntps [r8 + rax*4], xmm0
+    movntps [r8 + rax*4 + 16], xmm1
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.loop4_check:
+    mov r9, rcx
+    sub r9, rax
+    cmp r9, 4
+    jl .tail_check
+
+    movdqu xmm0, [rdx + rax*4]
+    cvtdq2ps xmm0, xmm0
+    divps xmm0, xmm5
+    movntps [r8 + rax*4], xmm0
+    add rax, 4
+
+.tail_check:
+    cmp rax, rcx
+    jge .done
+
+.tail:                      ; Remaining 1-3 pixels
+    cvtsi2ss xmm0, dword [rdx + rax*4]
+    divss xmm0, xmm5
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.done:
+    sfence                  ; Order the streaming stores before returning
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX2 + FMA, int input: scalar head to a 32-byte boundary, 32 pixels per
+; iteration (4 x 8), then 8, masked tail
+; ---------------------------------------------------------------------------
+imgCvtGrayInttoFloat_AVX2_NT_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 72             ; xmm6-xmm9 are callee-saved
+    vmovdqu [rsp], xmm6
+    vmovdqu [rsp + 16], xmm7
+    vmovdqu [rsp + 32], xmm8
+    vmovdqu [rsp + 48], xmm9
+
+    vbroadcastss ymm8, [rel recip_255]  ; ymm8 = 1/255 (hoisted)
+    vbroadcastss ymm9, [rel const_255]  ; ymm9 = 255.0
+    xor eax, eax
+
+    mov r9, r8
+    neg r9
+    and r9, 31
+    shr r9, 2               ; r9 = pixels before out is 32-byte aligned (0-7)
+    cmp r9, rcx
+    cmova r9, rcx
+    jmp .head_check
+
+.head:                      ; divss is exact
+    vcvtsi2ss xmm0, xmm0, dword [rdx + rax*4]
+    vdivss xmm0, xmm0, xmm9
+    vmovss dword [r8 + rax*4], xmm0
+    inc rax
+.head_check:
+    cmp rax, r9
+    jl .head
+
+    mov r9, rcx
+    sub r9, rax
+    and r9, -32
+    add r9, rax             ; r9 = end of the 32-pixel blocks
+    cmp rax, r9
+    jge .loop8_check
+
+.loop32:
+    prefetcht0 [rdx + rax*4 + PREFETCH_INT]
+    prefetcht0 [rdx + rax*4 + PREFETCH_INT + 64]
+    vcvtdq2ps ymm0, [rdx + rax*4]
+    vcvtdq2ps ymm2, [rdx + rax*4 + 32]
+    vcvtdq2ps ymm4, [rdx + rax*4 + 64]
+    vcvtdq2ps ymm6, [rdx + rax*4 + 96]
+    vmulps ymm1, ymm0, ymm8             ; q = x * (1/255)
+    vmulps ymm3, ymm2, ymm8
+    vmulps ymm5, ymm4, ymm8
+    vmulps ymm7, ymm6, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9       ; e = x - q*255
+    vfnmadd231ps ymm2, ymm3, ymm9
+    vfnmadd231ps ymm4, ymm5, ymm9
+    vfnmadd231ps ymm6, ymm7, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8        ; q + e/255
+    vfmadd132ps ymm2, ymm3, ymm8
+    vfmadd132ps ymm4, ymm5, ymm8
+    vfmadd132ps ymm6, ymm7, ymm8
+    vmovntps [r8 + rax*4], ymm0
+    vmovntps [r8 + rax*4 + 32], ymm2
+    vmovntps [r8 + rax*4 + 64], ymm4
+    vmovntps [r8 + rax*4 + 96], ymm6
+    add rax, 32
+    cmp rax, r9
+    jl .loop32
+
+.loop8_check:
+    mov r9, rcx
+    sub r9, rax
+    and r9, -8
+    add r9, rax
+    cmp rax, r9
+    jge .tail
+
+.loop8:
+    vcvtdq2ps ymm0, [rdx + rax*4]
+    vmulps ymm1, ymm0, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8
+    vmovntps [r8 + rax*4], ymm0
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.tail:                      ; Remaining 1-7 pixels with a lane mask
+    mov r9, rcx
+    sub r9, rax
+    jz .restore
+    vmovd xmm2, r9d
+    vpbroadcastd ymm2, xmm2
+    vpcmpgtd ymm2, ymm2, [rel lane_index]   ; lane < remaining
+    vpmaskmovd ymm0, ymm2, [rdx + rax*4]
+    vcvtdq2ps ymm0, ymm0
+    vmulps ymm1, ymm0, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8
+    vmaskmovps [r8 + rax*4], ymm2, ymm0
+
+.restore:
+    sfence
+    vmovdqu xmm6, [rsp]
+    vmovdqu xmm7, [rsp + 16]
+    vmovdqu xmm8, [rsp + 32]
+    vmovdqu xmm9, [rsp + 48]
+    add rsp, 72
+    vzeroupper
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX-512, int input: masked head to a 64-byte boundary, 64 pixels per
+; iteration (4 x 16), then 16, masked tail
+; ---------------------------------------------------------------------------
+imgCvtGrayInttoFloat_AVX512_NT_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    vbroadcastss zmm30, [rel recip_255] ; zmm30 = 1/255 (hoisted)
+    vbroadcastss zmm31, [rel const_255] ; zmm31 = 255.0
+    xor eax, eax
+
+    mov r9, r8
+    neg r9
+    and r9, 63
+    shr r9, 2               ; r9 = pixels before out is 64-byte aligned (0-15)
+    jz .blocks
+    cmp r9, rcx
+    cmova r9, rcx
+    mov r11, rcx
+    mov ecx, r9d
+    mov r10d, 1
+    shl r10d, cl
+    dec r10d                ; r10 = (1 << head) - 1
+    mov rcx, r11
+    kmovw k1, r10d
+    vcvtdq2ps zmm16{k1}{z}, [rdx]
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8]{k1}, zmm16
+    mov rax, r9
+
+.blocks:
+    mov r9, rcx
+    sub r9, rax
+    and r9, -64
+    add r9, rax             ; r9 = end of the 64-pixel blocks
+    cmp rax, r9
+    jge .loop16_check
+
+.loop64:
+    prefetcht0 [rdx + rax*4 + PREFETCH_INT]
+    prefetcht0 [rdx + rax*4 + PREFETCH_INT + 64]
+    prefetcht0 [rdx + rax*4 + PREFETCH_INT + 128]
+    prefetcht0 [rdx + rax*4 + PREFETCH_INT + 192]
+    vcvtdq2ps zmm16, [rdx + rax*4]
+    vcvtdq2ps zmm18, [rdx + rax*4 + 64]
+    vcvtdq2ps zmm20, [rdx + rax*4 + 128]
+    vcvtdq2ps zmm22, [rdx + rax*4 + 192]
+    vmulps zmm17, zmm16, zmm30          ; q = x * (1/255)
+    vmulps zmm19, zmm18, zmm30
+    vmulps zmm21, zmm20, zmm30
+    vmulps zmm23, zmm22, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31    ; e = x - q*255
+    vfnmadd231ps zmm18, zmm19, zmm31
+    vfnmadd231ps zmm20, zmm21, zmm31
+    vfnmadd231ps zmm22, zmm23, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30     ; q + e/255
+    vfmadd132ps zmm18, zmm19, zmm30
+    vfmadd132ps zmm20, zmm21, zmm30
+    vfmadd132ps zmm22, zmm23, zmm30
+    vmovntps [r8 + rax*4], zmm16
+    vmovntps [r8 + rax*4 + 64], zmm18
+    vmovntps [r8 + rax*4 + 128], zmm20
+    vmovntps [r8 + rax*4 + 192], zmm22
+    add rax, 64
+    cmp rax, r9
+    jl .loop64
+
+.loop16_check:
+    mov r9, rcx
+    sub r9, rax
+    and r9, -16
+    add r9, rax
+    cmp rax, r9
+    jge .tail
+
+.loop16:
+    vcvtdq2ps zmm16, [rdx + rax*4]
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovntps [r8 + rax*4], zmm16
+    add rax, 16
+    cmp rax, r9
+    jl .loop16
+
+.tail:                      ; Remaining 1-15 pixels with a k-mask
+    sub rcx, rax
+    jz .done
+    mov r9d, 1
+    shl r9d, cl
+    dec r9d                 ; r9 = (1 << remaining) - 1
+    kmovw k1, r9d
+    vcvtdq2ps zmm16{k1}{z}, [rdx + rax*4]
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8 + rax*4]{k1}, zmm16
+
+.done:
+    sfence
+    vzeroupper
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; SSE4.1, uint8_t input: scalar head to a 16-byte boundary, 8 pixels per
+; iteration (2 x 4), scalar tail
+; ---------------------------------------------------------------------------
+imgCvtGrayU8toFloat_SSE41_NT_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 40             ; xmm6/xmm7 are callee-saved
+    movdqu [rsp], xmm6
+    movdqu [rsp + 16], xmm7
+
+    movaps xmm6, [rel recip_255]    ; xmm6 = 1/255 (hoisted)
+    movaps xmm7, [rel const_255]    ; xmm7 = 255.0
+    xor eax, eax
+
+    mov r9, r8
+    neg r9
+    and r9, 15
+    shr r9, 2               ; r9 = pixels before out is 16-byte aligned (0-3)
+    cmp r9, rcx
+    cmova r9, rcx
+    jmp .head_check
+
+.head:                      ; divss is exact
+    movzx r10d, byte [rdx + rax]
+    cvtsi2ss xmm0, r10d
+    divss xmm0, xmm7
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+.head_check:
+    cmp rax, r9
+    jl .head
+
+    mov r9, rcx
+    sub r9, rax
+    and r9, -8
+    add r9, rax             ; r9 = end of the 8-pixel blocks
+    cmp rax, r9
+    jge .tail_check
+
+.loop8:
+    prefetcht0 [rdx + rax + PREFETCH_U8]
+    pmovzxbd xmm0, dword [rdx + rax]        ; x = a[i..i+3] widened to int32
+    pmovzxbd xmm3, dword [rdx + rax + 4]
+    cvtdq2ps xmm0, xmm0
+    cvtdq2ps xmm3, xmm3
+    movaps xmm1, xmm0
+    movaps xmm4, xmm3
+    mulps xmm1, xmm6        ; q = x * (1/255)
+    mulps xmm4, xmm6
+    movaps xmm2, xmm1
+    movaps xmm5, xmm4
+    mulps xmm2, xmm7        ; q * 255
+    mulps xmm5, xmm7
+    subps xmm0, xmm2        ; e = x - q*255
+    subps xmm3, xmm5
+    mulps xmm0, xmm6        ; e / 255
+    mulps xmm3, xmm6
+    addps xmm0, xmm1        ; q + e/255
+    addps xmm3, xmm4
+    movntps [r8 + rax*4], xmm0
+    movntps [r8 + rax*4 + 16], xmm3
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.tail_check:
+    cmp rax, rcx
+    jge .restore
+
+.tail:                      ; Remaining 1-7 pixels
+    movzx r10d, byte [rdx + rax]
+    cvtsi2ss xmm0, r10d
+    divss xmm0, xmm7
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.restore:
+    sfence
+    movdqu xmm6, [rsp]
+    movdqu xmm7, [rsp + 16]
+    add rsp, 40
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX2 + FMA, uint8_t input: scalar head to a 32-byte boundary, 32 pixels
+; per iteration (4 x 8), then 8, scalar tail
+; ---------------------------------------------------------------------------
+imgCvtGrayU8toFloat_AVX2_NT_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 72             ; xmm6-xmm9 are callee-saved
+    vmovdqu [rsp], xmm6
+    vmovdqu [rsp + 16], xmm7
+    vmovdqu [rsp + 32], xmm8
+    vmovdqu [rsp + 48], xmm9
+
+    vbroadcastss ymm8, [rel recip_255]  ; ymm8 = 1/255 (hoisted)
+    vbroadcastss ymm9, [rel const_255]  ; ymm9 = 255.0
+    xor eax, eax
+
+    mov r9, r8
+    neg r9
+    and r9, 31
+    shr r9, 2               ; r9 = pixels before out is 32-byte aligned (0-7)
+    cmp r9, rcx
+    cmova r9, rcx
+    jmp .head_check
+
+.head:                      ; divss is exact
+    movzx r10d, byte [rdx + rax]
+    vcvtsi2ss xmm0, xmm0, r10d
+    vdivss xmm0, xmm0, xmm9
+    vmovss dword [r8 + rax*4], xmm0
+    inc rax
+.head_check:
+    cmp rax, r9
+    jl .head
+
+    mov r9, rcx
+    sub r9, rax
+    and r9, -32
+    add r9, rax             ; r9 = end of the 32-pixel blocks
+    cmp rax, r9
+    jge .loop8_check
+
+.loop32:
+    prefetcht0 [rdx + rax + PREFETCH_U8]
+    vpmovzxbd ymm0, qword [rdx + rax]   ; x = a[i..i+7] widened to int32
+    vpmovzxbd ymm2, qword [rdx + rax + 8]
+    vpmovzxbd ymm4, qword [rdx + rax + 16]
+    vpmovzxbd ymm6, qword [rdx + rax + 24]
+    vcvtdq2ps ymm0, ymm0
+    vcvtdq2ps ymm2, ymm2
+    vcvtdq2ps ymm4, ymm4
+    vcvtdq2ps ymm6, ymm6
+    vmulps ymm1, ymm0, ymm8             ; q = x * (1/255)
+    vmulps ymm3, ymm2, ymm8
+    vmulps ymm5, ymm4, ymm8
+    vmulps ymm7, ymm6, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9       ; e = x - q*255
+    vfnmadd231ps ymm2, ymm3, ymm9
+    vfnmadd231ps ymm4, ymm5, ymm9
+    vfnmadd231ps ymm6, ymm7, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8        ; q + e/255
+    vfmadd132ps ymm2, ymm3, ymm8
+    vfmadd132ps ymm4, ymm5, ymm8
+    vfmadd132ps ymm6, ymm7, ymm8
+    vmovntps [r8 + rax*4], ymm0
+    vmovntps [r8 + rax*4 + 32], ymm2
+    vmovntps [r8 + rax*4 + 64], ymm4
+    vmovntps [r8 + rax*4 + 96], ymm6
+    add rax, 32
+    cmp rax, r9
+    jl .loop32
+
+.loop8_check:
+    mov r9, rcx
+    sub r9, rax
+    and r9, -8
+    add r9, rax
+    cmp rax, r9
+    jge .tail_check
+
+.loop8:
+    vpmovzxbd ymm0, qword [rdx + rax]
+    vcvtdq2ps ymm0, ymm0
+    vmulps ymm1, ymm0, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8
+    vmovntps [r8 + rax*4], ymm0
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.tail_check:
+    cmp rax, rcx
+    jge .restore
+
+.tail:                      ; Remaining 1-7 pixels
+    movzx r10d, byte [rdx + rax]
+    vcvtsi2ss xmm0, xmm0, r10d
+    vdivss xmm0, xmm0, xmm9
+    vmovss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.restore:
+    sfence
+    vmovdqu xmm6, [rsp]
+    vmovdqu xmm7, [rsp + 16]
+    vmovdqu xmm8, [rsp + 32]
+    vmovdqu xmm9, [rsp + 48]
+    add rsp, 72
+    vzeroupper
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX-512, uint8_t input: masked head to a 64-byte boundary, 64 pixels per
+; iteration (4 x 16), then 16, masked tail (masked-off bytes are never read)
+; ---------------------------------------------------------------------------
+imgCvtGrayU8toFloat_AVX512_NT_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    vbroadcastss zmm30, [rel recip_255] ; zmm30 = 1/255 (hoisted)
+    vbroadcastss zmm31, [rel const_255] ; zmm31 = 255.0
+    xor eax, eax
+
+    mov r9, r8
+    neg r9
+    and r9, 63
+    shr r9, 2               ; r9 = pixels before out is 64-byte aligned (0-15)
+    jz .blocks
+    cmp r9, rcx
+    cmova r9, rcx
+    mov r11, rcx
+    mov ecx, r9d
+    mov r10d, 1
+    shl r10d, cl
+    dec r10d                ; r10 = (1 << head) - 1
+    mov rcx, r11
+    kmovw k1, r10d
+    vpmovzxbd zmm16{k1}{z}, [rdx]
+    vcvtdq2ps zmm16, zmm16
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8]{k1}, zmm16
+    mov rax, r9
+
+.blocks:
+    mov r9, rcx
+    sub r9, rax
+    and r9, -64
+    add r9, rax             ; r9 = end of the 64-pixel blocks
+    cmp rax, r9
+    jge .loop16_check
+
+.loop64:
+    prefetcht0 [rdx + rax + PREFETCH_U8]
+    vpmovzxbd zmm16, [rdx + rax]        ; x = a[i..i+15] widened to int32
+    vpmovzxbd zmm18, [rdx + rax + 16]
+    vpmovzxbd zmm20, [rdx + rax + 32]
+    vpmovzxbd zmm22, [rdx + rax + 48]
+    vcvtdq2ps zmm16, zmm16
+    vcvtdq2ps zmm18, zmm18
+    vcvtdq2ps zmm20, zmm20
+    vcvtdq2ps zmm22, zmm22
+    vmulps zmm17, zmm16, zmm30          ; q = x * (1/255)
+    vmulps zmm19, zmm18, zmm30
+    vmulps zmm21, zmm20, zmm30
+    vmulps zmm23, zmm22, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31    ; e = x - q*255
+    vfnmadd231ps zmm18, zmm19, zmm31
+    vfnmadd231ps zmm20, zmm21, zmm31
+    vfnmadd231ps zmm22, zmm23, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30     ; q + e/255
+    vfmadd132ps zmm18, zmm19, zmm30
+    vfmadd132ps zmm20, zmm21, zmm30
+    vfmadd132ps zmm22, zmm23, zmm30
+    vmovntps [r8 + rax*4], zmm16
+    vmovntps [r8 + rax*4 + 64], zmm18
+    vmovntps [r8 + rax*4 + 128], zmm20
+    vmovntps [r8 + rax*4 + 192], zmm22
+    add rax, 64
+    cmp rax, r9
+    jl .loop64
+
+.loop16_check:
+    mov r9, rcx
+    sub r9, rax
+    and r9, -16
+    add r9, rax
+    cmp rax, r9
+    jge .tail
+
+.loop16:
+    vpmovzxbd zmm16, [rdx + rax]
+    vcvtdq2ps zmm16, zmm16
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovntps [r8 + rax*4], zmm16
+    add rax, 16
+    cmp rax, r9
+    jl .loop16
+
+.tail:                      ; Remaining 1-15 pixels with a k-mask
+    sub rcx, rax
+    jz .done
+    mov r9d, 1
+    shl r9d, cl
+    dec r9d                 ; r9 = (1 << remaining) - 1
+    kmovw k1, r9d
+    vpmovzxbd zmm16{k1}{z}, [rdx + rax]
+    vcvtdq2ps zmm16, zmm16
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8 + rax*4]{k1}, zmm16
+
+.done:
+    sfence
+    vzeroupper
+.ret:
+    ret
@@ -0,0 +1,348 @@
+; Fused color-to-grayscale kernels: interleaved RGB8 / RGBA8 pixels to
+; normalized float luma in one pass
+;   void f(int n, uint8_t *pixels, float *out, const luma_weights_t *weights)
+; n counts pixels, not bytes. weights points to four int16 values
+; {wr, wg, wb, 0} in 14-bit fixed point summing to 16384, so the weighted
+; sum y = wr*R + wg*G + wb*B is an exact integer (at most 255 * 16384).
+; Each pixel becomes (float)y / 255.0f * 2^-14, bit-identical to
+; imgCvtGrayRGBtoFloat_C: y / 255 is correctly rounded, and scaling by a
+; power of two is exact.
+;
+; pshufb spreads R, G, B of two pixels into words (alpha dropped), pmaddwd
+; multiplies by the weights and adds pairs, phaddd finishes each pixel's
+; sum. The reciprocal-multiply correction of asmgrayscale_simd.asm is only
+; exact for sums this large with FMA, so SSE4.1 uses divps.
+
+section .data
+    align 64
+    recip_255   dd 0x3B808081           ; 1.0f / 255.0f
+    align 16
+    const_255   times 4 dd 255.0
+    weight_unit times 4 dd 0x38800000   ; 2^-14, one weight step
+    ; pshufb masks: R, G, B of two pixels as zero-extended words
+    rgb_lo      db 0, 0x80, 1, 0x80, 2, 0x80, 0x80, 0x80, 3, 0x80, 4, 0x80, 5, 0x80, 0x80, 0x80
+    rgb_hi      db 6, 0x80, 7, 0x80, 8, 0x80, 0x80, 0x80, 9, 0x80, 10, 0x80, 11, 0x80, 0x80, 0x80
+    rgba_lo     db 0, 0x80, 1, 0x80, 2, 0x80, 0x80, 0x80, 4, 0x80, 5, 0x80, 6, 0x80, 0x80, 0x80
+    rgba_hi     db 8, 0x80, 9, 0x80, 10, 0x80, 0x80, 0x80, 12, 0x80, 13, 0x80, 14, 0x80, 0x80, 0x80
+
+section .text
+    bits 64
+    default rel
+    global imgCvtGrayRGBtoFloat_SSE41_into
+    global imgCvtGrayRGBAtoFloat_SSE41_into
+    global imgCvtGrayRGBtoFloat_AVX2_into
+    global imgCvtGrayRGBAtoFloat_AVX2_into
+
+; ---------------------------------------------------------------------------
+; SSE4.1, RGB: 8 pixels (24 bytes) per iteration, one pixel at a time at
+; the end. The two 16-byte loads reach 28 bytes in, so the loop stops while
+; at least 10 pixels remain.
+; ---------------------------------------------------------------------------
+imgCvtGrayRGBtoFloat_SSE41_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    movq xmm4, [r9]
+    punpcklqdq xmm4, xmm4   ; xmm4 = wr wg wb 0 wr wg wb 0 (words)
+    movaps xmm5, [rel const_255]
+    xor eax, eax            ; rax = pixel counter (i = 0)
+    xor r11d, r11d          ; r11 = byte offset (3 * i)
+    lea r10, [rcx - 9]      ; Vector loop while i < n - 9
+
+.loop8:
+    cmp rax, r10
+    jge .tail_check
+    movdqu xmm0, [rdx + r11]            ; Pixels i..i+3 (and 4 extra bytes)
+    movdqu xmm2, [rdx + r11 + 12]       ; Pixels i+4..i+7
+    movdqa xmm1, xmm0
+    movdqa xmm3, xmm2
+    pshufb xmm0, [rel rgb_lo]
+    pshufb xmm1, [rel rgb_hi]
+    pshufb xmm2, [rel rgb_lo]
+    pshufb xmm3, [rel rgb_hi]
+    pmaddwd xmm0, xmm4      ; wr*R + wg*G, wb*B for each pixel
+    pmaddwd xmm1, xmm4
+    pmaddwd xmm2, xmm4
+    pmaddwd xmm3, xmm4
+    phaddd xmm0, xmm1       ; y of pixels i..i+3
+    phaddd xmm2, xmm3
+    cvtdq2ps xmm0, xmm0
+    cvtdq2ps xmm2, xmm2
+    divps xmm0, xmm5        ; y / 255
+    divps xmm2, xmm5
+    mulps xmm0, [rel weight_unit]
+    mulps xmm2, [rel weight_unit]
+    movups [r8 + rax*4], xmm0
+    movups [r8 + rax*4 + 16], xmm2
+    add rax, 8
+    add r11, 24
+    jmp .loop8
+
+.tail_check:
+    cmp rax, rcx
+    jge .ret
+
+.tail:                      ; Remaining 1-9 pixels, 3 bytes each
+    movzx r10d, word [rdx + r11]
+    movzx r9d, byte [rdx + r11 + 2]
+    shl r9d, 16
+    or r10d, r9d
+    movd xmm0, r10d
+    pshufb xmm0, [rel rgb_lo]
+    pmaddwd xmm0, xmm4
+    phaddd xmm0, xmm0
+    cvtdq2ps xmm0, xmm0
+    divss xmm0, xmm5
+    mulss xmm0, [rel weight_unit]
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+    add r11, 3
+    cmp rax, rcx
+    jl .tail
+
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; SSE4.1, RGBA: 8 pixels (32 bytes) per iteration, one pixel at a time at
+; the end
+; ---------------------------------------------------------------------------
+imgCvtGrayRGBAtoFloat_SSE41_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    movq xmm4, [r9]
+    punpcklqdq xmm4, xmm4   ; xmm4 = wr wg wb 0 wr wg wb 0 (words)
+    movaps xmm5, [rel const_255]
+    xor eax, eax
+
+    mov r10, rcx
+    and r10, -8
+    jz .tail_check
+
+.loop8:
+    movdqu xmm0, [rdx + rax*4]          ; Pixels i..i+3
+    movdqu xmm2, [rdx + rax*4 + 16]     ; Pixels i+4..i+7
+    movdqa xmm1, xmm0
+    movdqa xmm3, xmm2
+    pshufb xmm0, [rel rgba_lo]
+    pshufb xmm1, [rel rgba_hi]
+    pshufb xmm2, [rel rgba_lo]
+    pshufb xmm3, [rel rgba_hi]
+    pmaddwd xmm0, xmm4      ; wr*R + wg*G, wb*B for each pixel
+    pmaddwd xmm1, xmm4
+    pmaddwd xmm2, xmm4
+    pmaddwd xmm3, xmm4
+    phaddd xmm0, xmm1       ; y of pixels i..i+3
+    phaddd xmm2, xmm3
+    cvtdq2ps xmm0, xmm0
+    cvtdq2ps xmm2, xmm2
+    divps xmm0, xmm5        ; y / 255
+    divps xmm2, xmm5
+    mulps xmm0, [rel weight_unit]
+    mulps xmm2, [rel weight_unit]
+    movups [r8 + rax*4], xmm0
+    movups [r8 + rax*4 + 16], xmm2
+    add rax, 8
+    cmp rax, r10
+    jl .loop8
+
+.tail_check:
+    cmp rax, rcx
+    jge .ret
+
+.tail:                      ; Remaining 1-7 pixels
+    movd xmm0, [rdx + rax*4]
+    pshufb xmm0, [rel rgba_lo]
+    pmaddwd xmm0, xmm4
+    phaddd xmm0, xmm0
+    cvtdq2ps xmm0, xmm0
+    divss xmm0, xmm5
+    mulss xmm0, [rel weight_unit]
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX2 + FMA, RGB: 16 pixels (48 bytes) per iteration, each ymm holding 4
+; pixels per 128-bit lane; one pixel at a time at the end. The loads reach
+; 52 bytes in, so the loop stops while at least 18 pixels remain.
+; ---------------------------------------------------------------------------
+imgCvtGrayRGBtoFloat_AVX2_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 72             ; xmm6-xmm9 are callee-saved
+    vmovdqu [rsp], xmm6
+    vmovdqu [rsp + 16], xmm7
+    vmovdqu [rsp + 32], xmm8
+    vmovdqu [rsp + 48], xmm9
+
+    vpbroadcastq ymm4, [r9]                 ; ymm4 = wr wg wb 0 ... (words)
+    vbroadcastss ymm5, [rel weight_unit]    ; ymm5 = 2^-14
+    vbroadcasti128 ymm6, [rel rgb_lo]
+    vbroadcasti128 ymm7, [rel rgb_hi]
+    vbroadcastss ymm8, [rel recip_255]      ; ymm8 = 1/255 (hoisted)
+    vbroadcastss ymm9, [rel const_255]      ; ymm9 = 255.0
+    xor eax, eax
+    xor r11d, r11d          ; r11 = byte offset (3 * i)
+    lea r10, [rcx - 17]     ; Vector loop while i < n - 17
+
+.loop16:
+    cmp rax, r10
+    jge .tail_check
+    vmovdqu xmm0, [rdx + r11]                   ; Pixels i..i+3
+    vinserti128 ymm0, ymm0, [rdx + r11 + 12], 1 ; Pixels i+4..i+7
+    vmovdqu xmm2, [rdx + r11 + 24]
+    vinserti128 ymm2, ymm2, [rdx + r11 + 36], 1
+    vpshufb ymm1, ymm0, ymm7
+    vpshufb ymm0, ymm0, ymm6
+    vpshufb ymm3, ymm2, ymm7
+    vpshufb ymm2, ymm2, ymm6
+    vpmaddwd ymm0, ymm0, ymm4           ; wr*R + wg*G, wb*B for each pixel
+    vpmaddwd ymm1, ymm1, ymm4
+    vpmaddwd ymm2, ymm2, ymm4
+    vpmaddwd ymm3, ymm3, ymm4
+    vphaddd ymm0, ymm0, ymm1            ; y of 8 pixels, in order
+    vphaddd ymm2, ymm2, ymm3
+    vcvtdq2ps ymm0, ymm0
+    vcvtdq2ps ymm2, ymm2
+    vmulps ymm1, ymm0, ymm8             ; q = y * (1/255)
+    vmulps ymm3, ymm2, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9       ; e = y - q*255
+    vfnmadd231ps ymm2, ymm3, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8        ; q + e/255
+    vfmadd132ps ymm2, ymm3, ymm8
+    vmulps ymm0, ymm0, ymm5
+    vmulps ymm2, ymm2, ymm5
+    vmovups [r8 + rax*4], ymm0
+    vmovups [r8 + rax*4 + 32], ymm2
+    add rax, 16
+    add r11, 48
+    jmp .loop16
+
+.tail_check:
+    cmp rax, rcx
+    jge .restore
+
+.tail:                      ; Remaining 1-17 pixels, 3 bytes each
+    movzx r10d, word [rdx + r11]
+    movzx r9d, byte [rdx + r11 + 2]
+    shl r9d, 16
+    or r10d, r9d
+    vmovd xmm0, r10d
+    vpshufb xmm0, xmm0, xmm6
+    vpmaddwd xmm0, xmm0, xmm4
+    vphaddd xmm0, xmm0, xmm0
+    vcvtdq2ps xmm0, xmm0
+    vdivss xmm0, xmm0, xmm9
+    vmulss xmm0, xmm0, xmm5
+    vmovss dword [r8 + rax*4], xmm0
+    inc rax
+    add r11, 3
+    cmp rax, rcx
+    jl .tail
+
+.restore:
+    vmovdqu xmm6, [rsp]
+    vmovdqu xmm7, [rsp + 16]
+    vmovdqu xmm8, [rsp + 32]
+    vmovdqu xmm9, [rsp + 48]
+    add rsp, 72
+    vzeroupper
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX2 + FMA, RGBA: 16 pixels (64 bytes) per iteration, one pixel at a time
+; at the end
+; ---------------------------------------------------------------------------
+imgCvtGrayRGBAtoFloat_AVX2_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 72             ; xmm6-xmm9 are callee-saved
+    vmovdqu [rsp], xmm6
+    vmovdqu [rsp + 16], xmm7
+    vmovdqu [rsp + 32], xmm8
+    vmovdqu [rsp + 48], xmm9
+
+    vpbroadcastq ymm4, [r9]                 ; ymm4 = wr wg wb 0 ... (words)
+    vbroadcastss ymm5, [rel weight_unit]    ; ymm5 = 2^-14
+    vbroadcasti128 ymm6, [rel rgba_lo]
+    vbroadcasti128 ymm7, [rel rgba_hi]
+    vbroadcastss ymm8, [rel recip_255]      ; ymm8 = 1/255 (hoisted)
+    vbroadcastss ymm9, [rel const_255]      ; ymm9 = 255.0
+    xor eax, eax
+
+    mov r10, rcx
+    and r10, -16
+    jz .tail_check
+
+.loop16:
+    vmovdqu ymm0, [rdx + rax*4]         ; Pixels i..i+7
+    vmovdqu ymm2, [rdx + rax*4 + 32]    ; Pixels i+8..i+15
+    vpshufb ymm1, ymm0, ymm7
+    vpshufb ymm0, ymm0, ymm6
+    vpshufb ymm3, ymm2, ymm7
+    vpshufb ymm2, ymm2, ymm6
+    vpmaddwd ymm0, ymm0, ymm4           ; wr*R + wg*G, wb*B for each pixel
+    vpmaddwd ymm1, ymm1, ymm4
+    vpmaddwd ymm2, ymm2, ymm4
+    vpmaddwd ymm3, ymm3, ymm4
+    vphaddd ymm0, ymm0, ymm1            ; y of 8 pixels, in order
+    vphaddd ymm2, ymm2, ymm3
+    vcvtdq2ps ymm0, ymm0
+    vcvtdq2ps ymm2, ymm2
+    vmulps ymm1, ymm0, ymm8             ; q = y * (1/255)
+    vmulps ymm3, ymm2, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9       ; e = y - q*255
+    vfnmadd231ps ymm2, ymm3, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8        ; q + e/255
+    vfmadd132ps ymm2, ymm3, ymm8
+    vmulps ymm0, ymm0, ymm5
+    vmulps ymm2, ymm2, ymm5
+    vmovups [r8 + rax*4], ymm0
+    vmovups [r8 + rax*4 + 32], ymm2
+    add rax, 16
+    cmp rax, r10
+    jl .loop16
+
+.tail_check:
+    cmp rax, rcx
+    jge .restore
+
+.tail:                      ; Remaining 1-15 pixels
+    vmovd xmm0, [rdx + rax*4]
+    vpshufb xmm0, xmm0, xmm6
+    vpmaddwd xmm0, xmm0, xmm4
+    vphaddd xmm0, xmm0, xmm0
+    vcvtdq2ps xmm0, xmm0
+    vdivss xmm0, xmm0, xmm9
+    vmulss xmm0, xmm0, xmm5
+    vmovss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.restore:
+    vmovdqu xmm6, [rsp]
+    vmovdqu xmm7, [rsp + 16]
+    vmovdqu xmm8, [rsp + 32]
+    vmovdqu xmm9, [rsp + 48]
+    add rsp, 72
+    vzeroupper
+.ret:
+    ret
@@ -0,0 +1,275 @@
+; Packed SIMD versions of imgCvtGrayInttoFloat (SSE2, AVX2, AVX-512)
+; Same contracts as the scalar routine:
+;   float* f(int n, int *a)               returns a malloc'd array of n floats
+;                                         (NULL on failure or n <= 0)
+;   void f_into(int n, int *a, float *out) converts into a caller-owned array
+;   void f_inplace(int n, int *a)          converts over the input (out = a)
+;
+; Each pixel is converted with cvtdq2ps and multiplied by the hoisted
+; reciprocal of 255.0. One residual correction step, q + (x - q*255)/255,
+; computed with FMA, then makes every result bit-identical to
+; (float)v / 255.0f for every int32. SSE2 has no FMA and divides instead.
+%include "asmgrayscale.inc"
+
+section .data
+    align 64
+    recip_255   times 16 dd 0x3B808081  ; 1.0f / 255.0f
+    const_255   times 16 dd 255.0
+    lane_index  dd 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+
+section .text
+    bits 64
+    default rel
+    global imgCvtGrayInttoFloat_SSE2
+    global imgCvtGrayInttoFloat_AVX2
+    global imgCvtGrayInttoFloat_AVX512
+    global imgCvtGrayInttoFloat_SSE2_into
+    global imgCvtGrayInttoFloat_AVX2_into
+    global imgCvtGrayInttoFloat_AVX512_into
+    global imgCvtGrayInttoFloat_SSE2_inplace
+    global imgCvtGrayInttoFloat_AVX2_inplace
+    global imgCvtGrayInttoFloat_AVX512_inplace
+    extern malloc
+
+imgCvtGrayInttoFloat_SSE2:
+    ALLOC_AND_CONVERT imgCvtGrayInttoFloat_SSE2_into
+
+imgCvtGrayInttoFloat_AVX2:
+    ALLOC_AND_CONVERT imgCvtGrayInttoFloat_AVX2_into
+
+imgCvtGrayInttoFloat_AVX512:
+    ALLOC_AND_CONVERT imgCvtGrayInttoFloat_AVX512_into
+
+imgCvtGrayInttoFloat_SSE2_inplace:
+    INPLACE_ENTRY imgCvtGrayInttoFloat_SSE2_into
+
+imgCvtGrayInttoFloat_AVX2_inplace:
+    INPLACE_ENTRY imgCvtGrayInttoFloat_AVX2_into
+
+imgCvtGrayInttoFloat_AVX512_inplace:
+    INPLACE_ENTRY imgCvtGrayInttoFloat_AVX512_into
+
+; ---------------------------------------------------------------------------
+; SSE2: 8 pixels per iteration (2 x 4), then 4 per iteration, scalar tail
+; Without FMA the residual step is rounded twice and is not exact for ints
+; of 509 and up, so SSE2 divides with divps, which rounds like the C
+; division for every int32.
+; ---------------------------------------------------------------------------
+imgCvtGrayInttoFloat_SSE2_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    movaps xmm5, [rel const_255]    ; xmm5 = 255.0 (hoisted)
+    xor eax, eax            ; rax = counter (i = 0)
+
+    mov r9, rcx
+    and r9, -8              ; r9 = n rounded down to a multiple of 8
+    jz .loop4_check
+
+.loop8:
+    movdqu xmm0, [rdx + rax*4]
+    movdqu xmm1, [rdx + rax*4 + 16]
+    cvtdq2ps xmm0, xmm0     ; x = (float)a[i..i+3]
+    cvtdq2ps xmm1, xmm1
+    divps xmm0, xmm5        ; x / 255
+    divps xmm1, xmm5
+    movups [r8 + rax*4], xmm0
+    movups [r8 + rax*4 + 16], xmm1
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.loop4_check:
+    mov r9, rcx
+    and r9, -4
+    cmp rax, r9
+    jge .tail_check
+
+    movdqu xmm0, [rdx + rax*4]
+    cvtdq2ps xmm0, xmm0
+    divps xmm0, xmm5
+    movups [r8 + rax*4], xmm0
+    add rax, 4
+
+.tail_check:
+    cmp rax, rcx
+    jge .ret
+
+.tail:                      ; Remaining 1-3 pixels
+    cvtsi2ss xmm0, dword [rdx + rax*4]
+    divss xmm0, xmm5
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX2 + FMA: 32 pixels per iteration (4 x 8), then 8 per iteration,
+; masked tail
+; ---------------------------------------------------------------------------
+imgCvtGrayInttoFloat_AVX2_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 72             ; xmm6-xmm9 are callee-saved
+    vmovdqu [rsp], xmm6
+    vmovdqu [rsp + 16], xmm7
+    vmovdqu [rsp + 32], xmm8
+    vmovdqu [rsp + 48], xmm9
+
+    vbroadcastss ymm8, [rel recip_255]  ; ymm8 = 1/255 (hoisted)
+    vbroadcastss ymm9, [rel const_255]  ; ymm9 = 255.0
+    xor eax, eax
+
+    mov r9, rcx
+    and r9, -32
+    jz .loop8_check
+
+.loop32:
+    vcvtdq2ps ymm0, [rdx + rax*4]
+    vcvtdq2ps ymm2, [rdx + rax*4 + 32]
+    vcvtdq2ps ymm4, [rdx + rax*4 + 64]
+    vcvtdq2ps ymm6, [rdx + rax*4 + 96]
+    vmulps ymm1, ymm0, ymm8             ; q = x * (1/255)
+    vmulps ymm3, ymm2, ymm8
+    vmulps ymm5, ymm4, ymm8
+    vmulps ymm7, ymm6, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9       ; e = x - q*255
+    vfnmadd231ps ymm2, ymm3, ymm9
+    vfnmadd231ps ymm4, ymm5, ymm9
+    vfnmadd231ps ymm6, ymm7, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8        ; q + e/255
+    vfmadd132ps ymm2, ymm3, ymm8
+    vfmadd132ps ymm4, ymm5, ymm8
+    vfmadd132ps ymm6, ymm7, ymm8
+    vmovups [r8 + rax*4], ymm0
+    vmovups [r8 + rax*4 + 32], ymm2
+    vmovups [r8 + rax*4 + 64], ymm4
+    vmovups [r8 + rax*4 + 96], ymm6
+    add rax, 32
+    cmp rax, r9
+    jl .loop32
+
+.loop8_check:
+    mov r9, rcx
+    and r9, -8
+    cmp rax, r9
+    jge .tail
+
+.loop8:
+    vcvtdq2ps ymm0, [rdx + rax*4]
+    vmulps ymm1, ymm0, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8
+    vmovups [r8 + rax*4], ymm0
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.tail:                      ; Remaining 1-7 pixels with a lane mask
+    mov r9, rcx
+    sub r9, rax
+    jz .restore
+    vmovd xmm2, r9d
+    vpbroadcastd ymm2, xmm2
+    vpcmpgtd ymm2, ymm2, [rel lane_index]   ; lane < remaining
+    vpmaskmovd ymm0, ymm2, [rdx + rax*4]
+    vcvtdq2ps ymm0, ymm0
+    vmulps ymm1, ymm0, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8
+    vmaskmovps [r8 + rax*4], ymm2, ymm0
+
+.restore:
+    vmovdqu xmm6, [rsp]
+    vmovdqu xmm7, [rsp + 16]
+    vmovdqu xmm8, [rsp + 32]
+    vmovdqu xmm9, [rsp + 48]
+    add rsp, 72
+    vzeroupper
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX-512: 64 pixels per iteration (4 x 16), then 16 per iteration,
+; masked tail. zmm16-zmm31 are volatile, so nothing needs saving.
+; ---------------------------------------------------------------------------
+imgCvtGrayInttoFloat_AVX512_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    vbroadcastss zmm30, [rel recip_255] ; zmm30 = 1/255 (hoisted)
+    vbroadcastss zmm31, [rel const_255] ; zmm31 = 255.0
+    xor eax, eax
+
+    mov r9, rcx
+    and r9, -64
+    jz .loop16_check
+
+.loop64:
+    vcvtdq2ps zmm16, [rdx + rax*4]
+    vcvtdq2ps zmm18, [rdx + rax*4 + 64]
+    vcvtdq2ps zmm20, [rdx + rax*4 + 128]
+    vcvtdq2ps zmm22, [rdx + rax*4 + 192]
+    vmulps zmm17, zmm16, zmm30          ; q = x * (1/255)
+    vmulps zmm19, zmm18, zmm30
+    vmulps zmm21, zmm20, zmm30
+    vmulps zmm23, zmm22, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31    ; e = x - q*255
+    vfnmadd231ps zmm18, zmm19, zmm31
+    vfnmadd231ps zmm20, zmm21, zmm31
+    vfnmadd231ps zmm22, zmm23, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30     ; q + e/255
+    vfmadd132ps zmm18, zmm19, zmm30
+    vfmadd132ps zmm20, zmm21, zmm30
+    vfmadd132ps zmm22, zmm23, zmm30
+    vmovups [r8 + rax*4], zmm16
+    vmovups [r8 + rax*4 + 64], zmm18
+    vmovups [r8 + rax*4 + 128], zmm20
+    vmovups [r8 + rax*4 + 192], zmm22
+    add rax, 64
+    cmp rax, r9
+    jl .loop64
+
+.loop16_check:
+    mov r9, rcx
+    and r9, -16
+    cmp rax, r9
+    jge .tail
+
+.loop16:
+    vcvtdq2ps zmm16, [rdx + rax*4]
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8 + rax*4], zmm16
+    add rax, 16
+    cmp rax, r9
+    jl .loop16
+
+.tail:                      ; Remaining 1-15 pixels with a k-mask
+    sub rcx, rax
+    jz .done
+    mov r9d, 1
+    shl r9d, cl
+    dec r9d                 ; r9 = (1 << remaining) - 1
+    kmovw k1, r9d
+    vcvtdq2ps zmm16{k1}{z}, [rdx + rax*4]
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8 + rax*4]{k1}, zmm16
+
+.done:
+    vzeroupper
+.ret:
+    ret
@@ -0,0 +1,275 @@
+; 8-bit input versions of the packed SIMD kernels
+;   float* f(int n, uint8_t *a)
+;   void f_into(int n, uint8_t *a, float *out)
+; Pixels are read as bytes and widened with pmovzxbd/vpmovzxbd, so a frame
+; reads 1 byte per pixel instead of 4. The conversion is the same reciprocal
+; multiply plus correction step as asmgrayscale_simd.asm (bit-identical to
+; (float)v / 255.0f).
+%include "asmgrayscale.inc"
+
+section .data
+    align 64
+    recip_255   times 16 dd 0x3B808081  ; 1.0f / 255.0f
+    const_255   times 16 dd 255.0
+
+section .text
+    bits 64
+    default rel
+    global imgCvtGrayU8toFloat_SSE41
+    global imgCvtGrayU8toFloat_AVX2
+    global imgCvtGrayU8toFloat_AVX512
+    global imgCvtGrayU8toFloat_SSE41_into
+    global imgCvtGrayU8toFloat_AVX2_into
+    global imgCvtGrayU8toFloat_AVX512_into
+    extern malloc
+
+imgCvtGrayU8toFloat_SSE41:
+    ALLOC_AND_CONVERT imgCvtGrayU8toFloat_SSE41_into
+
+imgCvtGrayU8toFloat_AVX2:
+    ALLOC_AND_CONVERT imgCvtGrayU8toFloat_AVX2_into
+
+imgCvtGrayU8toFloat_AVX512:
+    ALLOC_AND_CONVERT imgCvtGrayU8toFloat_AVX512_into
+
+; ---------------------------------------------------------------------------
+; SSE4.1: 8 pixels per iteration (2 x 4), scalar tail
+; ---------------------------------------------------------------------------
+imgCvtGrayU8toFloat_SSE41_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 40             ; xmm6/xmm7 are callee-saved
+    movdqu [rsp], xmm6
+    movdqu [rsp + 16], xmm7
+
+    movaps xmm6, [rel recip_255]    ; xmm6 = 1/255 (hoisted)
+    movaps xmm7, [rel const_255]    ; xmm7 = 255.0
+    xor eax, eax            ; rax = counter (i = 0)
+
+    mov r9, rcx
+    and r9, -8
+    jz .tail_check
+
+.loop8:
+    pmovzxbd xmm0, dword [rdx + rax]        ; x = a[i..i+3] widened to int32
+    pmovzxbd xmm3, dword [rdx + rax + 4]
+    cvtdq2ps xmm0, xmm0
+    cvtdq2ps xmm3, xmm3
+    movaps xmm1, xmm0
+    movaps xmm4, xmm3
+    mulps xmm1, xmm6        ; q = x * (1/255)
+    mulps xmm4, xmm6
+    movaps xmm2, xmm1
+    movaps xmm5, xmm4
+    mulps xmm2, xmm7        ; q * 255
+    mulps xmm5, xmm7
+    subps xmm0, xmm2        ; e = x - q*255
+    subps xmm3, xmm5
+    mulps xmm0, xmm6        ; e / 255
+    mulps xmm3, xmm6
+    addps xmm0, xmm1        ; q + e/255
+    addps xmm3, xmm4
+    movups [r8 + rax*4], xmm0
+    movups [r8 + rax*4 + 16], xmm3
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.tail_check:
+    cmp rax, rcx
+    jge .restore
+
+.tail:                      ; Remaining 1-7 pixels: divss is exact
+    movzx r9d, byte [rdx + rax]
+    cvtsi2ss xmm0, r9d
+    divss xmm0, xmm7
+    movss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.restore:
+    movdqu xmm6, [rsp]
+    movdqu xmm7, [rsp + 16]
+    add rsp, 40
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX2 + FMA: 32 pixels per iteration (4 x 8), then 8 per iteration,
+; scalar tail
+; ---------------------------------------------------------------------------
+imgCvtGrayU8toFloat_AVX2_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    sub rsp, 72             ; xmm6-xmm9 are callee-saved
+    vmovdqu [rsp], xmm6
+    vmovdqu [rsp + 16], xmm7
+    vmovdqu [rsp + 32], xmm8
+    vmovdqu [rsp + 48], xmm9
+
+    vbroadcastss ymm8, [rel recip_255]  ; ymm8 = 1/255 (hoisted)
+    vbroadcastss ymm9, [rel const_255]  ; ymm9 = 255.0
+    xor eax, eax
+
+    mov r9, rcx
+    and r9, -32
+    jz .loop8_check
+
+.loop32:
+    vpmovzxbd ymm0, qword [rdx + rax]   ; x = a[i..i+7] widened to int32
+    vpmovzxbd ymm2, qword [rdx + rax + 8]
+    vpmovzxbd ymm4, qword [rdx + rax + 16]
+    vpmovzxbd ymm6, qword [rdx + rax + 24]
+    vcvtdq2ps ymm0, ymm0
+    vcvtdq2ps ymm2, ymm2
+    vcvtdq2ps ymm4, ymm4
+    vcvtdq2ps ymm6, ymm6
+    vmulps ymm1, ymm0, ymm8             ; q = x * (1/255)
+    vmulps ymm3, ymm2, ymm8
+    vmulps ymm5, ymm4, ymm8
+    vmulps ymm7, ymm6, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9       ; e = x - q*255
+    vfnmadd231ps ymm2, ymm3, ymm9
+    vfnmadd231ps ymm4, ymm5, ymm9
+    vfnmadd231ps ymm6, ymm7, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8        ; q + e/255
+    vfmadd132ps ymm2, ymm3, ymm8
+    vfmadd132ps ymm4, ymm5, ymm8
+    vfmadd132ps ymm6, ymm7, ymm8
+    vmovups [r8 + rax*4], ymm0
+    vmovups [r8 + rax*4 + 32], ymm2
+    vmovups [r8 + rax*4 + 64], ymm4
+    vmovups [r8 + rax*4 + 96], ymm6
+    add rax, 32
+    cmp rax, r9
+    jl .loop32
+
+.loop8_check:
+    mov r9, rcx
+    and r9, -8
+    cmp rax, r9
+    jge .tail_check
+
+.loop8:
+    vpmovzxbd ymm0, qword [rdx + rax]
+    vcvtdq2ps ymm0, ymm0
+    vmulps ymm1, ymm0, ymm8
+    vfnmadd231ps ymm0, ymm1, ymm9
+    vfmadd132ps ymm0, ymm1, ymm8
+    vmovups [r8 + rax*4], ymm0
+    add rax, 8
+    cmp rax, r9
+    jl .loop8
+
+.tail_check:
+    cmp rax, rcx
+    jge .restore
+
+.tail:                      ; Remaining 1-7 pixels: divss is exact
+    movzx r9d, byte [rdx + rax]
+    vcvtsi2ss xmm0, xmm0, r9d
+    vdivss xmm0, xmm0, xmm9
+    vmovss dword [r8 + rax*4], xmm0
+    inc rax
+    cmp rax, rcx
+    jl .tail
+
+.restore:
+    vmovdqu xmm6, [rsp]
+    vmovdqu xmm7, [rsp + 16]
+    vmovdqu xmm8, [rsp + 32]
+    vmovdqu xmm9, [rsp + 48]
+    add rsp, 72
+    vzeroupper
+.ret:
+    ret
+
+; ---------------------------------------------------------------------------
+; AVX-512: 64 pixels per iteration (4 x 16), then 16 per iteration,
+; masked tail (masked-off bytes are never read)
+; ---------------------------------------------------------------------------
+imgCvtGrayU8toFloat_AVX512_into:
+    KERNEL_ARGS
+    movsxd rcx, ecx
+    test rcx, rcx
+    jle .ret
+
+    vbroadcastss zmm30, [rel recip_255] ; zmm30 = 1/255 (hoisted)
+    vbroadcastss zmm31, [rel const_255] ; zmm31 = 255.0
+    xor eax, eax
+
+    mov r9, rcx
+    and r9, -64
+    jz .loop16_check
+
+.loop64:
+    vpmovzxbd zmm16, [rdx + rax]        ; x = a[i..i+15] widened to int32
+    vpmovzxbd zmm18, [rdx + rax + 16]
+    vpmovzxbd zmm20, [rdx + rax + 32]
+    vpmovzxbd zmm22, [rdx + rax + 48]
+    vcvtdq2ps zmm16, zmm16
+    vcvtdq2ps zmm18, zmm18
+    vcvtdq2ps zmm20, zmm20
+    vcvtdq2ps zmm22, zmm22
+    vmulps zmm17, zmm16, zmm30          ; q = x * (1/255)
+    vmulps zmm19, zmm18, zmm30
+    vmulps zmm21, zmm20, zmm30
+    vmulps zmm23, zmm22, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31    ; e = x - q*255
+    vfnmadd231ps zmm18, zmm19, zmm31
+    vfnmadd231ps zmm20, zmm21, zmm31
+    vfnmadd231ps zmm22, zmm23, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30     ; q + e/255
+    vfmadd132ps zmm18, zmm19, zmm30
+    vfmadd132ps zmm20, zmm21, zmm30
+    vfmadd132ps zmm22, zmm23, zmm30
+    vmovups [r8 + rax*4], zmm16
+    vmovups [r8 + rax*4 + 64], zmm18
+    vmovups [r8 + rax*4 + 128], zmm20
+    vmovups [r8 + rax*4 + 192], zmm22
+    add rax, 64
+    cmp rax, r9
+    jl .loop64
+
+.loop16_check:
+    mov r9, rcx
+    and r9, -16
+    cmp rax, r9
+    jge .tail
+
+.loop16:
+    vpmovzxbd zmm16, [rdx + rax]
+    vcvtdq2ps zmm16, zmm16
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8 + rax*4], zmm16
+    add rax, 16
+    cmp rax, r9
+    jl .loop16
+
+.tail:                      ; Remaining 1-15 pixels with a k-mask
+    sub rcx, rax
+    jz .done
+    mov r9d, 1
+    shl r9d, cl
+    dec r9d                 ; r9 = (1 << remaining) - 1
+    kmovw k1, r9d
+    vpmovzxbd zmm16{k1}{z}, [rdx + rax]
+    vcvtdq2ps zmm16, zmm16
+    vmulps zmm17, zmm16, zmm30
+    vfnmadd231ps zmm16, zmm17, zmm31
+    vfmadd132ps zmm16, zmm17, zmm30
+    vmovups [r8 + rax*4]{k1}, zmm16
+
+.done:
+    vzeroupper
+.ret:
+    ret
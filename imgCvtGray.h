@@ -0,0 +1,544 @@
+#ifndef IMGCVTGRAY_H
+#define IMGCVTGRAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Grayscale conversion kernels: integer pixel values (0-255) to float
+// pixel values (0.0-1.0). Each kernel comes in two forms:
+//   f(n, a)            returns a malloc'd array of n floats, or NULL on failure
+//   f_into(n, a, out)  writes n floats into a caller-owned array
+
+// Assembly kernels (asmgrayscale.asm, asmgrayscale_simd.asm, asmgrayscale_lut.asm)
+extern float* imgCvtGrayInttoFloat(int n, int *a);         // Scalar
+extern float* imgCvtGrayInttoFloat_SSE2(int n, int *a);    // 4 pixels/instruction
+extern float* imgCvtGrayInttoFloat_AVX2(int n, int *a);    // 8 pixels/instruction
+extern float* imgCvtGrayInttoFloat_AVX512(int n, int *a);  // 16 pixels/instruction
+extern void imgCvtGrayInttoFloat_into(int n, int *a, float *out);
+extern void imgCvtGrayInttoFloat_SSE2_into(int n, int *a, float *out);
+extern void imgCvtGrayInttoFloat_AVX2_into(int n, int *a, float *out);
+extern void imgCvtGrayInttoFloat_AVX512_into(int n, int *a, float *out);
+
+// Lookup-table kernels: inputs are clamped to 0-255, results are
+// bit-identical to (float)v / 255.0f
+extern float* imgCvtGrayInttoFloat_LUT(int n, int *a);        // Scalar lookup
+extern float* imgCvtGrayInttoFloat_LUT_AVX2(int n, int *a);   // vgatherdps
+extern void imgCvtGrayInttoFloat_LUT_into(int n, int *a, float *out);
+extern void imgCvtGrayInttoFloat_LUT_AVX2_into(int n, int *a, float *out);
+
+// C kernels (imgCvtGrayInttoFloat_C.c, imgCvtGrayInttoFloat_LUT_C.c)
+extern float* imgCvtGrayInttoFloat_C(int n, int *a);
+extern void imgCvtGrayInttoFloat_C_into(int n, int *a, float *out);
+extern float* imgCvtGrayInttoFloat_LUT_C(int n, int *a);
+extern void imgCvtGrayInttoFloat_LUT_C_into(int n, int *a, float *out);
+
+// 8-bit input kernels: read uint8_t pixels directly, 1 byte per pixel
+// instead of 4 (asmgrayscale_u8.asm, imgCvtGrayU8toFloat_C.c)
+extern float* imgCvtGrayU8toFloat_SSE41(int n, uint8_t *a);   // pmovzxbd
+extern float* imgCvtGrayU8toFloat_AVX2(int n, uint8_t *a);    // vpmovzxbd ymm
+extern float* imgCvtGrayU8toFloat_AVX512(int n, uint8_t *a);  // vpmovzxbd zmm
+extern float* imgCvtGrayU8toFloat_C(int n, uint8_t *a);
+extern void imgCvtGrayU8toFloat_SSE41_into(int n, uint8_t *a, float *out);
+extern void imgCvtGrayU8toFloat_AVX2_into(int n, uint8_t *a, float *out);
+extern void imgCvtGrayU8toFloat_AVX512_into(int n, uint8_t *a, float *out);
+extern void imgCvtGrayU8toFloat_C_into(int n, uint8_t *a, float *out);
+
+// Fused color kernels: interleaved RGB8 (3 bytes per pixel) or RGBA8 (4,
+// alpha ignored) straight to normalized float luma in one pass, with no
+// intermediate luma frame (asmgrayscale_rgb.asm, imgCvtGrayRGBtoFloat_C.c).
+// n counts pixels. Weights are 14-bit fixed point summing to
+// LUMA_WEIGHT_ONE; every kernel gives the same bits as the C version.
+#define LUMA_WEIGHT_BITS  14
+#define LUMA_WEIGHT_ONE   (1 << LUMA_WEIGHT_BITS)
+typedef struct {
+    int16_t w[4];           // R, G, B weights, then 0 (the kernels load all 4)
+} luma_weights_t;
+extern const luma_weights_t luma_bt601;
+extern const luma_weights_t luma_bt709;
+int make_luma_weights(double r, double g, double b, luma_weights_t *weights);
+extern void imgCvtGrayRGBtoFloat_SSE41_into(int n, uint8_t *rgb, float *out, const luma_weights_t *weights);
+extern void imgCvtGrayRGBtoFloat_AVX2_into(int n, uint8_t *rgb, float *out, const luma_weights_t *weights);
+extern void imgCvtGrayRGBtoFloat_C_into(int n, uint8_t *rgb, float *out, const luma_weights_t *weights);
+extern void imgCvtGrayRGBAtoFloat_SSE41_into(int n, uint8_t *rgba, float *out, const luma_weights_t *weights);
+extern void imgCvtGrayRGBAtoFloat_AVX2_into(int n, uint8_t *rgba, float *out, const luma_weights_t *weights);
+extern void imgCvtGrayRGBAtoFloat_C_into(int n, uint8_t *rgba, float *out, const luma_weights_t *weights);
+
+// Affine transform kernels: integer pixels to float with a configurable
+// normalization in one pass, instead of a /255 pass followed by a second
+// pass over the floats (asmgrayscale_affine.asm, imgCvtGrayAffine_C.c):
+//   out = ((float)v / divisor - mean) * inv_std
+// Each step rounds once, in that order, in every kernel. With affine_unit
+// this is exactly (float)v / 255.0f, the conversion of the kernels above.
+// The toHalf and toBF16 kernels round that float once more, to nearest
+// even, into the 16-bit formats of the kernels below.
+typedef struct {
+    float divisor;
+    float mean;
+    float inv_std;
+} affine_params_t;
+extern const affine_params_t affine_unit;       // v / 255          -> [0, 1]
+extern const affine_params_t affine_signed;     // v / 127.5 - 1    -> [-1, 1]
+extern const affine_params_t affine_unit16;     // v / 65535        -> [0, 1]
+int make_affine_params(double divisor, double mean, double std, affine_params_t *params);
+extern void imgCvtGrayU8toFloat_Affine_AVX2_into(int n, uint8_t *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayU8toFloat_Affine_AVX512_into(int n, uint8_t *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayU8toFloat_Affine_C_into(int n, uint8_t *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayU16toFloat_Affine_AVX2_into(int n, uint16_t *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayU16toFloat_Affine_AVX512_into(int n, uint16_t *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayU16toFloat_Affine_C_into(int n, uint16_t *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayInttoFloat_Affine_AVX2_into(int n, int *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayInttoFloat_Affine_AVX512_into(int n, int *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayInttoFloat_Affine_C_into(int n, int *a, float *out, const affine_params_t *params);
+extern void imgCvtGrayU8toHalf_Affine_AVX2_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU8toHalf_Affine_AVX512_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU8toHalf_Affine_C_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU8toBF16_Affine_AVX2_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU8toBF16_Affine_AVX512_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU8toBF16_Affine_C_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU16toHalf_Affine_AVX2_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU16toHalf_Affine_AVX512_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU16toHalf_Affine_C_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU16toBF16_Affine_AVX2_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU16toBF16_Affine_AVX512_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayU16toBF16_Affine_C_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayInttoHalf_Affine_AVX2_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayInttoHalf_Affine_AVX512_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayInttoHalf_Affine_C_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayInttoBF16_Affine_AVX2_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayInttoBF16_Affine_AVX512_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+extern void imgCvtGrayInttoBF16_Affine_C_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+
+// 16-bit output kernels: (float)v / 255.0f rounded to nearest even IEEE
+// half (F16C vcvtps2ph) or bfloat16, stored as the raw bit pattern in a
+// uint16_t (asmgrayscale_half.asm, imgCvtGrayHalf_C.c). Half the output
+// bytes of float32; all 256 8-bit levels stay distinct in either format.
+extern void imgCvtGrayInttoHalf_AVX2_into(int n, int *a, uint16_t *out);
+extern void imgCvtGrayInttoHalf_AVX512_into(int n, int *a, uint16_t *out);
+extern void imgCvtGrayInttoHalf_C_into(int n, int *a, uint16_t *out);
+extern void imgCvtGrayU8toHalf_AVX2_into(int n, uint8_t *a, uint16_t *out);
+extern void imgCvtGrayU8toHalf_AVX512_into(int n, uint8_t *a, uint16_t *out);
+extern void imgCvtGrayU8toHalf_C_into(int n, uint8_t *a, uint16_t *out);
+extern void imgCvtGrayInttoBF16_AVX2_into(int n, int *a, uint16_t *out);
+extern void imgCvtGrayInttoBF16_AVX512_into(int n, int *a, uint16_t *out);
+extern void imgCvtGrayInttoBF16_C_into(int n, int *a, uint16_t *out);
+extern void imgCvtGrayU8toBF16_AVX2_into(int n, uint8_t *a, uint16_t *out);
+extern void imgCvtGrayU8toBF16_AVX512_into(int n, uint8_t *a, uint16_t *out);
+extern void imgCvtGrayU8toBF16_C_into(int n, uint8_t *a, uint16_t *out);
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+uint16_t float_to_bf16(float value);
+float bf16_to_float(uint16_t bf16);
+
+// Inverse kernels: float pixel values (0.0-1.0) back to 8-bit levels as
+// uint8_t or int, scaled by 255, clamped to 0-255 and rounded to nearest
+// even; NaN becomes 0 (asmgrayscale_inverse.asm, imgCvtGrayFloattoInt_C.c).
+// Every level v comes back from (float)v / 255.0f unchanged.
+extern void imgCvtGrayFloattoU8_SSE41_into(int n, float *a, uint8_t *out);
+extern void imgCvtGrayFloattoU8_AVX2_into(int n, float *a, uint8_t *out);
+extern void imgCvtGrayFloattoU8_AVX512_into(int n, float *a, uint8_t *out);
+extern void imgCvtGrayFloattoU8_C_into(int n, float *a, uint8_t *out);
+extern void imgCvtGrayFloattoInt_SSE41_into(int n, float *a, int *out);
+extern void imgCvtGrayFloattoInt_AVX2_into(int n, float *a, int *out);
+extern void imgCvtGrayFloattoInt_AVX512_into(int n, float *a, int *out);
+extern void imgCvtGrayFloattoInt_C_into(int n, float *a, int *out);
+
+// In-place kernels: f_inplace(n, a) overwrites the n ints at a with their
+// floats, bit-identical to f_into, so a frame needs one buffer instead of
+// two. The assembly versions run the _into routine with out = a
+// (asmgrayscale.inc INPLACE_ENTRY); the C versions go through
+// gray_pixel_t, so the compiler knows the int and the float share memory.
+typedef union {
+    int i;
+    float f;
+} gray_pixel_t;
+extern void imgCvtGrayInttoFloat_inplace(int n, int *a);
+extern void imgCvtGrayInttoFloat_SSE2_inplace(int n, int *a);
+extern void imgCvtGrayInttoFloat_AVX2_inplace(int n, int *a);
+extern void imgCvtGrayInttoFloat_AVX512_inplace(int n, int *a);
+extern void imgCvtGrayInttoFloat_LUT_inplace(int n, int *a);
+extern void imgCvtGrayInttoFloat_LUT_AVX2_inplace(int n, int *a);
+extern void imgCvtGrayInttoFloat_C_inplace(int n, int *a);
+extern void imgCvtGrayInttoFloat_LUT_C_inplace(int n, int *a);
+
+// The C loop shared by every affine instantiation, the plain /255 C
+// kernels included. Passing literal constants lets the compiler drop the
+// steps they make exact no-ops (x - 0.0f, x * 1.0f). AFFINE_LOOP_TO
+// passes each float result through convert (float_to_half, float_to_bf16)
+// for the 16-bit outputs; AFFINE_LOOP is the float instantiation.
+#define AFFINE_LOOP_TO(n, a, out, convert, divisor, mean, inv_std) \
+    for (int i = 0; i < (n); i++) { \
+        (out)[i] = convert(((float)(a)[i] / (divisor) - (mean)) * (inv_std)); \
+    }
+#define AFFINE_FLOAT(x) (x)
+#define AFFINE_LOOP(n, a, out, divisor, mean, inv_std) \
+    AFFINE_LOOP_TO(n, a, out, AFFINE_FLOAT, divisor, mean, inv_std)
+
+// Streaming-store variants of the SIMD kernels (asmgrayscale_nt.asm):
+// same results, but the output is written with movntps/vmovntps and
+// bypasses the cache. Used automatically for frames of at least
+// nt_threshold_pixels(input bytes) pixels, about the frames whose input
+// and output overflow the last-level cache; out needs only float alignment.
+extern void imgCvtGrayInttoFloat_SSE2_NT_into(int n, int *a, float *out);
+extern void imgCvtGrayInttoFloat_AVX2_NT_into(int n, int *a, float *out);
+extern void imgCvtGrayInttoFloat_AVX512_NT_into(int n, int *a, float *out);
+extern void imgCvtGrayU8toFloat_SSE41_NT_into(int n, uint8_t *a, float *out);
+extern void imgCvtGrayU8toFloat_AVX2_NT_into(int n, uint8_t *a, float *out);
+extern void imgCvtGrayU8toFloat_AVX512_NT_into(int n, uint8_t *a, float *out);
+
+// Aligned output buffers (imgCvtGrayAlloc.c)
+#define BUFFER_ALIGNMENT 64
+float* alloc_float_buffer(int n);
+float* alloc_float_buffer_large(size_t n);
+void free_float_buffer(float *buffer);
+
+// Output buffer pool (imgCvtGrayAlloc.c): power-of-two size classes of
+// aligned, pre-faulted buffers that are reused instead of going back to
+// the heap, so a steady stream of frames stops paying for malloc, free
+// and page faults. Buffers from pool_alloc_float are released with
+// pool_free_float. Without pool_init nothing is cached. huge_pages: 1 to
+// back blocks of 2 MB or more with huge pages, -1 not to, 0 for
+// IMGCVT_HUGE_PAGES.
+typedef struct {
+    long long hits;             // Requests served from a cached buffer
+    long long misses;           // Requests that needed a new buffer
+    long long cached_bytes;     // Held in the free lists now
+} pool_stats_t;
+int pool_init(long long max_cached_bytes, int huge_pages);
+void pool_shutdown(void);
+void pool_trim(void);
+void pool_get_stats(pool_stats_t *stats);
+float* pool_alloc_float(int n);
+void pool_free_float(float *buffer);
+
+// Exact verification (imgCvtGrayVerify.c): compares every value of out
+// with its reference bit for bit, without stopping at the first mismatch,
+// and reports the distance in units in the last place (ULP). The
+// reference is (float)v / 255.0f for pixel input, or a second float
+// array. Return the mismatch count; result may be NULL.
+typedef struct {
+    long long checked;          // Values compared
+    long long mismatches;       // Values whose bits differ
+    long long first_mismatch;   // Index of the first, -1 if none
+    float expected, actual;     // Values at first_mismatch
+    unsigned int max_ulp;       // Largest distance; +0 and -0 are 1 apart
+} verify_result_t;
+long long verify_int_to_float(int n, const int *a, const float *out, verify_result_t *result);
+long long verify_u8_to_float(int n, const uint8_t *a, const float *out, verify_result_t *result);
+long long verify_floats(int n, const float *expected, const float *out, verify_result_t *result);
+unsigned int float_ulp_distance(float x, float y);
+
+// Hardware performance counters (imgCvtGrayPerf.c, Linux perf_event_open):
+// user-space counts for the calling thread only, so work done by the
+// thread pool's workers is not included. perf_open returns a mask of
+// 1 << PERF_* for the events this host allows; 0 off Linux, in a container
+// without access, or with IMGCVT_PERF=0. perf_stop fills counts->valid
+// with the events that actually counted.
+#define PERF_CYCLES        0
+#define PERF_INSTRUCTIONS  1
+#define PERF_L1D_MISSES    2
+#define PERF_LLC_MISSES    3
+#define PERF_DTLB_MISSES   4
+#define PERF_PAGE_FAULTS   5
+#define PERF_NUM_EVENTS    6
+typedef struct {
+    int valid;                          // Bit 1 << PERF_* per counted event
+    long long count[PERF_NUM_EVENTS];   // Scaled for multiplexing
+} perf_counts_t;
+int perf_open(void);
+void perf_close(void);
+void perf_start(void);
+void perf_stop(perf_counts_t *counts);
+const char *perf_event_name(int event);
+
+// CPU features used to decide which kernels can run
+#define CPU_SSE2     0x01
+#define CPU_AVX2     0x02
+#define CPU_FMA      0x04
+#define CPU_AVX512F  0x08
+#define CPU_SSE41    0x10
+#define CPU_F16C     0x20
+
+// Name and requirements of a registered kernel (first member of every
+// kernel table entry)
+typedef struct {
+    const char *name;       // Short name, also accepted by IMGCVT_KERNEL
+    const char *label;      // Display name for reports
+    int required_features;  // CPU_* bits the kernel needs
+} kernel_info_t;
+
+// A registered int -> float conversion kernel
+typedef struct {
+    kernel_info_t info;
+    float* (*convert)(int n, int *a);
+    void (*convert_into)(int n, int *a, float *out);
+    void (*convert_into_nt)(int n, int *a, float *out);    // Streaming stores, NULL if none
+    void (*convert_inplace)(int n, int *a);                 // Floats over the ints
+} kernel_t;
+
+// A registered uint8_t -> float conversion kernel
+typedef struct {
+    kernel_info_t info;
+    float* (*convert)(int n, uint8_t *a);
+    void (*convert_into)(int n, uint8_t *a, float *out);
+    void (*convert_into_nt)(int n, uint8_t *a, float *out);  // Streaming stores, NULL if none
+} u8_kernel_t;
+
+// A registered fused color -> float luma kernel
+typedef struct {
+    kernel_info_t info;
+    void (*rgb_into)(int n, uint8_t *rgb, float *out, const luma_weights_t *weights);
+    void (*rgba_into)(int n, uint8_t *rgba, float *out, const luma_weights_t *weights);
+} rgb_kernel_t;
+
+// A registered affine transform kernel, one entry point per input and
+// output type
+typedef struct {
+    kernel_info_t info;
+    void (*u8_into)(int n, uint8_t *a, float *out, const affine_params_t *params);
+    void (*u16_into)(int n, uint16_t *a, float *out, const affine_params_t *params);
+    void (*int_into)(int n, int *a, float *out, const affine_params_t *params);
+    void (*u8_to_half)(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+    void (*u16_to_half)(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+    void (*int_to_half)(int n, int *a, uint16_t *out, const affine_params_t *params);
+    void (*u8_to_bf16)(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+    void (*u16_to_bf16)(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+    void (*int_to_bf16)(int n, int *a, uint16_t *out, const affine_params_t *params);
+} affine_kernel_t;
+
+// A registered 16-bit output kernel: half and bfloat16 from int or uint8_t
+typedef struct {
+    kernel_info_t info;
+    void (*int_to_half)(int n, int *a, uint16_t *out);
+    void (*u8_to_half)(int n, uint8_t *a, uint16_t *out);
+    void (*int_to_bf16)(int n, int *a, uint16_t *out);
+    void (*u8_to_bf16)(int n, uint8_t *a, uint16_t *out);
+} half_kernel_t;
+
+// A registered float -> 8-bit level kernel
+typedef struct {
+    kernel_info_t info;
+    void (*to_u8)(int n, float *a, uint8_t *out);
+    void (*to_int)(int n, float *a, int *out);
+} inverse_kernel_t;
+
+// Kernel tables, ordered from least to most preferred
+extern const kernel_t kernels[];
+extern const int num_kernels;
+extern const u8_kernel_t u8_kernels[];
+extern const int num_u8_kernels;
+extern const rgb_kernel_t rgb_kernels[];
+extern const int num_rgb_kernels;
+extern const affine_kernel_t affine_kernels[];
+extern const int num_affine_kernels;
+extern const half_kernel_t half_kernels[];
+extern const int num_half_kernels;
+extern const inverse_kernel_t inverse_kernels[];
+extern const int num_inverse_kernels;
+
+// Runtime dispatch (imgCvtGrayDispatch.c)
+int detect_cpu_features(void);
+const char *cpu_brand_string(void);
+long long cache_llc_bytes(void);
+long long nt_threshold_pixels(int in_bytes);
+int use_streaming_stores(long long n, int in_bytes);
+int kernel_supported(const kernel_info_t *info);
+const kernel_t *find_kernel(const char *name);
+const kernel_t *selected_kernel(void);
+const u8_kernel_t *selected_u8_kernel(void);
+const rgb_kernel_t *selected_rgb_kernel(void);
+const affine_kernel_t *selected_affine_kernel(void);
+const half_kernel_t *selected_half_kernel(void);
+const inverse_kernel_t *selected_inverse_kernel(void);
+float* imgCvtGrayInttoFloat_Auto(int n, int *a);
+void imgCvtGrayInttoFloat_Auto_into(int n, int *a, float *out);
+float* imgCvtGrayU8toFloat_Auto(int n, uint8_t *a);
+void imgCvtGrayU8toFloat_Auto_into(int n, uint8_t *a, float *out);
+float* imgCvtGrayInttoFloat_Pooled(int n, int *a);     // Release with pool_free_float
+float* imgCvtGrayInttoFloat_InPlace(int n, int *a);    // Returns a, now holding floats
+float* imgCvtGrayU8toFloat_Pooled(int n, uint8_t *a);
+float* imgCvtGrayRGBtoFloat_Auto(int n, uint8_t *rgb, const luma_weights_t *weights);
+void imgCvtGrayRGBtoFloat_Auto_into(int n, uint8_t *rgb, float *out, const luma_weights_t *weights);
+float* imgCvtGrayRGBAtoFloat_Auto(int n, uint8_t *rgba, const luma_weights_t *weights);
+void imgCvtGrayRGBAtoFloat_Auto_into(int n, uint8_t *rgba, float *out, const luma_weights_t *weights);
+float* imgCvtGrayU8toFloat_Affine_Auto(int n, uint8_t *a, const affine_params_t *params);
+void imgCvtGrayU8toFloat_Affine_Auto_into(int n, uint8_t *a, float *out, const affine_params_t *params);
+float* imgCvtGrayU16toFloat_Affine_Auto(int n, uint16_t *a, const affine_params_t *params);
+void imgCvtGrayU16toFloat_Affine_Auto_into(int n, uint16_t *a, float *out, const affine_params_t *params);
+float* imgCvtGrayInttoFloat_Affine_Auto(int n, int *a, const affine_params_t *params);
+void imgCvtGrayInttoFloat_Affine_Auto_into(int n, int *a, float *out, const affine_params_t *params);
+uint16_t* imgCvtGrayU8toHalf_Affine_Auto(int n, uint8_t *a, const affine_params_t *params);
+void imgCvtGrayU8toHalf_Affine_Auto_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+uint16_t* imgCvtGrayU8toBF16_Affine_Auto(int n, uint8_t *a, const affine_params_t *params);
+void imgCvtGrayU8toBF16_Affine_Auto_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params);
+uint16_t* imgCvtGrayU16toHalf_Affine_Auto(int n, uint16_t *a, const affine_params_t *params);
+void imgCvtGrayU16toHalf_Affine_Auto_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+uint16_t* imgCvtGrayU16toBF16_Affine_Auto(int n, uint16_t *a, const affine_params_t *params);
+void imgCvtGrayU16toBF16_Affine_Auto_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params);
+uint16_t* imgCvtGrayInttoHalf_Affine_Auto(int n, int *a, const affine_params_t *params);
+void imgCvtGrayInttoHalf_Affine_Auto_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+uint16_t* imgCvtGrayInttoBF16_Affine_Auto(int n, int *a, const affine_params_t *params);
+void imgCvtGrayInttoBF16_Affine_Auto_into(int n, int *a, uint16_t *out, const affine_params_t *params);
+uint16_t* imgCvtGrayInttoHalf_Auto(int n, int *a);
+void imgCvtGrayInttoHalf_Auto_into(int n, int *a, uint16_t *out);
+uint16_t* imgCvtGrayU8toHalf_Auto(int n, uint8_t *a);
+void imgCvtGrayU8toHalf_Auto_into(int n, uint8_t *a, uint16_t *out);
+uint16_t* imgCvtGrayInttoBF16_Auto(int n, int *a);
+void imgCvtGrayInttoBF16_Auto_into(int n, int *a, uint16_t *out);
+uint16_t* imgCvtGrayU8toBF16_Auto(int n, uint8_t *a);
+void imgCvtGrayU8toBF16_Auto_into(int n, uint8_t *a, uint16_t *out);
+uint8_t* imgCvtGrayFloattoU8_Auto(int n, float *a);
+void imgCvtGrayFloattoU8_Auto_into(int n, float *a, uint8_t *out);
+int* imgCvtGrayFloattoInt_Auto(int n, float *a);
+void imgCvtGrayFloattoInt_Auto_into(int n, float *a, int *out);
+
+// Multi-threaded conversion (imgCvtGrayParallel.c)
+// Frames are split into bands of PARALLEL_BAND_PIXELS pixels (64 KB of
+// float output, a multiple of 16 pixels so bands never share a cache line)
+// and run on a persistent thread pool. parallel_init(0) uses IMGCVT_THREADS
+// or one thread per CPU; without parallel_init everything runs serially.
+#define PARALLEL_BAND_PIXELS  16384
+#define PARALLEL_MAX_THREADS  64
+typedef void (*band_fn_t)(void *ctx, long long start, long long count);
+int parallel_init(int num_threads);
+void parallel_shutdown(void);
+int parallel_num_threads(void);
+int parallel_cpu_count(void);
+void parallel_for(long long n, long long band, band_fn_t fn, void *ctx);
+void imgCvtGrayInttoFloat_Parallel_into(const kernel_t *kernel, int n, int *a, float *out);
+void imgCvtGrayU8toFloat_Parallel_into(const u8_kernel_t *kernel, int n, uint8_t *a, float *out);
+float* imgCvtGrayInttoFloat_Parallel_inplace(const kernel_t *kernel, int n, int *a);
+
+// Large frames (imgCvtGrayLarge.c): size_t pixel counts for frames of
+// 2^31 pixels and more, which the int n of the kernels cannot describe.
+// A frame is converted in pieces of at most LARGE_PIECE_PIXELS by the
+// dispatched kernel, across the thread pool after parallel_init. The
+// _into forms return 0, or -1 without converting anything for a NULL
+// array or a byte count that overflows size_t; the allocating forms
+// return NULL then, and their result is released with free_float_buffer.
+#define LARGE_PIECE_PIXELS  (1 << 30)
+int size_mul_checked(size_t a, size_t b, size_t *product);
+int image_pixel_count(long long height, long long width, size_t *n);
+float* imgCvtGrayInttoFloat_Large(size_t n, int *a);
+int imgCvtGrayInttoFloat_Large_into(size_t n, int *a, float *out);
+float* imgCvtGrayU8toFloat_Large(size_t n, uint8_t *a);
+int imgCvtGrayU8toFloat_Large_into(size_t n, uint8_t *a, float *out);
+int imgCvtGrayInttoFloat_Large_inplace(size_t n, int *a);
+int imgCvtGrayRGBtoFloat_Large_into(size_t n, uint8_t *rgb, float *out, const luma_weights_t *weights);
+int imgCvtGrayRGBAtoFloat_Large_into(size_t n, uint8_t *rgba, float *out, const luma_weights_t *weights);
+int imgCvtGrayU8toFloat_Affine_Large_into(size_t n, uint8_t *a, float *out, const affine_params_t *params);
+int imgCvtGrayU16toFloat_Affine_Large_into(size_t n, uint16_t *a, float *out, const affine_params_t *params);
+int imgCvtGrayInttoFloat_Affine_Large_into(size_t n, int *a, float *out, const affine_params_t *params);
+int imgCvtGrayInttoHalf_Large_into(size_t n, int *a, uint16_t *out);
+int imgCvtGrayU8toHalf_Large_into(size_t n, uint8_t *a, uint16_t *out);
+int imgCvtGrayInttoBF16_Large_into(size_t n, int *a, uint16_t *out);
+int imgCvtGrayU8toBF16_Large_into(size_t n, uint8_t *a, uint16_t *out);
+int imgCvtGrayFloattoU8_Large_into(size_t n, float *a, uint8_t *out);
+int imgCvtGrayFloattoInt_Large_into(size_t n, float *a, int *out);
+
+// Strided and region-of-interest conversion (imgCvtGrayStrided.c): a
+// width x height frame whose rows are in_stride input pixels and
+// out_stride output floats apart, as in a crop or a padded capture
+// buffer. Each row runs the dispatched kernel; after parallel_init the
+// rows are shared out across the pool. The _into forms return 0, or -1
+// without converting anything for bad sizes or strides; the ROI forms
+// also reject a rectangle that is not inside the frame.
+typedef struct {
+    int x, y;               // Top-left corner in the frame
+    int width, height;
+} gray_roi_t;
+int imgCvtGrayInttoFloat_2D_into(int width, int height, int *in, int in_stride, float *out, int out_stride);
+int imgCvtGrayU8toFloat_2D_into(int width, int height, uint8_t *in, int in_stride, float *out, int out_stride);
+int imgCvtGrayInttoFloat_ROI_into(int *in, int frame_width, int frame_height, int in_stride,
+                                  const gray_roi_t *roi, float *out, int out_stride);
+int imgCvtGrayU8toFloat_ROI_into(uint8_t *in, int frame_width, int frame_height, int in_stride,
+                                 const gray_roi_t *roi, float *out, int out_stride);
+float* imgCvtGrayInttoFloat_ROI(int *in, int frame_width, int frame_height, int in_stride, const gray_roi_t *roi);
+float* imgCvtGrayU8toFloat_ROI(uint8_t *in, int frame_width, int frame_height, int in_stride, const gray_roi_t *roi);
+
+// Conversion with fused statistics (imgCvtGrayStats.c): the histogram,
+// min, max, sum and sum of squares of the converted frame, gathered while
+// converting instead of by scanning the output afterwards. Bin v counts
+// the pixels converted to v / 255 (input level v); int inputs below 0 or
+// above 255 are counted in the first or last bin. After parallel_init the
+// frame is converted and counted across the pool. gray_stats_scan gives
+// the same statistics for a frame that is already converted. All return
+// 0, or -1 for n < 0 or a NULL array.
+#define GRAY_HIST_BINS 256
+typedef struct {
+    long long count;
+    long long histogram[GRAY_HIST_BINS];
+    float min, max;                 // 0 for an empty frame
+    double sum, sum_sq;
+} gray_stats_t;
+int imgCvtGrayInttoFloat_Stats_into(int n, int *a, float *out, gray_stats_t *stats);
+int imgCvtGrayU8toFloat_Stats_into(int n, uint8_t *a, float *out, gray_stats_t *stats);
+int gray_stats_scan(int n, const float *a, gray_stats_t *stats);
+double gray_stats_mean(const gray_stats_t *stats);
+double gray_stats_variance(const gray_stats_t *stats);
+
+// Monotonic timer in seconds (imgCvtGrayTime.c)
+double get_time(void);
+
+// Output writers (imgCvtGrayWrite.c). Return 0 on success, -1 on a write
+// error. The text writers match fprintf("%.2f ") / fprintf("%d ") output,
+// one row per line; the binary writer stores "GRF1", height and width
+// (uint32 little-endian) followed by the raw float32 pixels.
+#define GRAY_BINARY_MAGIC "GRF1"
+int write_float_text(FILE *file, const float *data, int height, int width);
+int write_int_text(FILE *file, const int *data, int height, int width);
+int write_float_binary(FILE *file, const float *data, int height, int width);
+int write_float_binary_header(FILE *file, int height, int width);
+int write_float_pfm(FILE *file, const float *data, int height, int width, int channels);
+
+// Binary PGM (P5) / PPM (P6) input (imgCvtGrayImage.c). The file is
+// memory-mapped and pixels points into the mapping: num_samples bytes,
+// row-major, channels samples per pixel (1 for P5, 3 interleaved RGB for
+// P6). Only maxval <= 255 is supported.
+typedef struct {
+    int width, height;
+    int channels;
+    int maxval;
+    const uint8_t *pixels;
+    int num_samples;        // width * height * channels
+    void *map_base;         // Mapping to release
+    size_t map_size;
+} pnm_image_t;
+int load_pnm(const char *path, pnm_image_t *image);
+void unload_pnm(pnm_image_t *image);
+int read_pnm_header(FILE *file, pnm_image_t *image);  // Leaves file at the samples
+
+// Streaming conversion (imgCvtGrayStream.c): converts input of any length
+// through a ring of STREAM_BUFFERS chunks with reading, conversion and
+// writing overlapped, so memory stays at
+// STREAM_BUFFERS * chunk_pixels * (input bytes + 4).
+#define STREAM_BUFFERS       3
+#define STREAM_CHUNK_PIXELS  (1 << 20)
+typedef struct {
+    long long pixels;           // Samples converted
+    long long buffer_bytes;     // Memory held by the ring, 0 if it could not be allocated
+    double read_seconds;        // Time spent in each stage
+    double convert_seconds;
+    double write_seconds;
+    double total_seconds;       // Wall time of the whole stream
+} stream_stats_t;
+int stream_convert(FILE *in_file, FILE *out_file, long long num_pixels,
+                   int input_bytes, int chunk_pixels, stream_stats_t *stats);
+
+// Batch conversion (imgCvtGrayBatch.c): many small frames in one call.
+// The kernel is resolved once for the batch and, after parallel_init,
+// frames are shared out across the pool in groups of about
+// PARALLEL_BAND_PIXELS pixels. input_bytes is 1 (uint8_t) or 4 (int).
+// convert_batch carves every output from one 64-byte aligned allocation;
+// convert_packed_into takes frames packed back to back, frame i spanning
+// offsets[i] to offsets[i + 1] in both input and output.
+typedef struct {
+    void *pixels;           // n samples of input_bytes each
+    int n;
+    float *out;             // n floats; set by convert_batch
+} gray_frame_t;
+float* convert_batch(gray_frame_t *frames, int num_frames, int input_bytes);
+int convert_batch_into(const gray_frame_t *frames, int num_frames, int input_bytes);
+int convert_packed_into(void *pixels, const int *offsets, int num_frames,
+                        int input_bytes, float *out);
+
+#endif
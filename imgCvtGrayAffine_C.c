@@ -0,0 +1,58 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// C implementation of the affine pixel transform
+//   out = ((float)v / divisor - mean) * inv_std
+// for uint8_t, uint16_t and int input, to float, IEEE half or bfloat16.
+// One function per input and output type is generated from
+// AFFINE_LOOP_TO; each checks the parameters against the common presets
+// and runs a copy of the loop with those values as literal constants, so
+// the compiler can fold the subtract and multiply away. The result is the
+// same either way, only the work differs.
+
+const affine_params_t affine_unit = {255.0f, 0.0f, 1.0f};
+const affine_params_t affine_signed = {127.5f, 1.0f, 1.0f};
+const affine_params_t affine_unit16 = {65535.0f, 0.0f, 1.0f};
+
+// Build parameters for out = (v / divisor - mean) / std, e.g. divisor 255
+// with a dataset mean and standard deviation measured on 0-1 values.
+// Returns 0, or -1 if divisor or std is not positive.
+int make_affine_params(double divisor, double mean, double std, affine_params_t *params) {
+    if (!(divisor > 0.0) || !(std > 0.0)) {
+        return -1;
+    }
+    params->divisor = (float)divisor;
+    params->mean = (float)mean;
+    params->inv_std = (float)(1.0 / std);
+    return 0;
+}
+
+#define DEFINE_AFFINE_C(name, in_type, out_type, convert)                       \
+void name(int n, in_type *a, out_type *out, const affine_params_t *params) {    \
+    float divisor = params->divisor, mean = params->mean, inv_std = params->inv_std; \
+    if (mean == 0.0f && inv_std == 1.0f) {                                      \
+        if (divisor == 255.0f) {                                                \
+            AFFINE_LOOP_TO(n, a, out, convert, 255.0f, 0.0f, 1.0f)              \
+        } else if (divisor == 65535.0f) {                                       \
+            AFFINE_LOOP_TO(n, a, out, convert, 65535.0f, 0.0f, 1.0f)            \
+        } else {                                                                \
+            AFFINE_LOOP_TO(n, a, out, convert, divisor, 0.0f, 1.0f)             \
+        }                                                                       \
+    } else if (divisor == 127.5f && mean == 1.0f && inv_std == 1.0f) {          \
+        AFFINE_LOOP_TO(n, a, out, convert, 127.5f, 1.0f, 1.0f)                  \
+    } else {                                                                    \
+        AFFINE_LOOP_TO(n, a, out, convert, divisor, mean, inv_std)              \
+    }                                                                           \
+}
+
+DEFINE_AFFINE_C(imgCvtGrayU8toFloat_Affine_C_into, uint8_t, float, AFFINE_FLOAT)
+DEFINE_AFFINE_C(imgCvtGrayU16toFloat_Affine_C_into, uint16_t, float, AFFINE_FLOAT)
+DEFINE_AFFINE_C(imgCvtGrayInttoFloat_Affine_C_into, int, float, AFFINE_FLOAT)
+DEFINE_AFFINE_C(imgCvtGrayU8toHalf_Affine_C_into, uint8_t, uint16_t, float_to_half)
+DEFINE_AFFINE_C(imgCvtGrayU16toHalf_Affine_C_into, uint16_t, uint16_t, float_to_half)
+DEFINE_AFFINE_C(imgCvtGrayInttoHalf_Affine_C_into, int, uint16_t, float_to_half)
+DEFINE_AFFINE_C(imgCvtGrayU8toBF16_Affine_C_into, uint8_t, uint16_t, float_to_bf16)
+DEFINE_AFFINE_C(imgCvtGrayU16toBF16_Affine_C_into, uint16_t, uint16_t, float_to_bf16)
+DEFINE_AFFINE_C(imgCvtGrayInttoBF16_Affine_C_into, int, uint16_t, float_to_bf16)
@@ -0,0 +1,314 @@
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "imgCvtGray.h"
+#include "imgCvtGrayThread.h"
+
+// Output buffers for the _into kernels. 64-byte alignment keeps every
+// vector store inside one cache line.
+
+// Allocate an aligned array of n floats (NULL on failure or n <= 0)
+float* alloc_float_buffer(int n) {
+    return n > 0 ? alloc_float_buffer_large((size_t)n) : NULL;
+}
+
+// Same for any size_t count (NULL on failure, n == 0 or a byte count that
+// does not fit in a size_t)
+float* alloc_float_buffer_large(size_t n) {
+    size_t size;
+    if (n == 0 || size_mul_checked(n, sizeof(float), &size) != 0) {
+        return NULL;
+    }
+#ifdef _WIN32
+    return (float *)_aligned_malloc(size, BUFFER_ALIGNMENT);
+#else
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, BUFFER_ALIGNMENT, size) != 0) {
+        return NULL;
+    }
+    return (float *)buffer;
+#endif
+}
+
+// Free an array returned by alloc_float_buffer
+void free_float_buffer(float *buffer) {
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+}
+
+// Buffer pool
+// Blocks come in power-of-two size classes from 4 KB up, and every page
+// is touched when the block is created. Released blocks go onto a free
+// list for their class and are handed out again without a trip to the
+// heap or a page fault, up to max_cached_bytes in total. Each block's
+// header lives in a table keyed by the address of its float data, not in
+// front of it, so a block is exactly its class size and the data starts
+// at the block's first byte. With huge pages, blocks of 2 MB and more are
+// 2 MB aligned and marked MADV_HUGEPAGE (Linux) or allocated with
+// MEM_LARGE_PAGES (Windows, needs SeLockMemoryPrivilege; falls back to
+// ordinary pages without it), and fill their huge pages exactly.
+
+#define POOL_MIN_SHIFT      12                  // Smallest class: 4 KB
+#define POOL_NUM_CLASSES    20                  // Largest class: 2 GB
+#define POOL_PAGE_BYTES     4096
+#define POOL_HUGE_BYTES     (2 << 20)
+#define POOL_DEFAULT_BYTES  (256LL << 20)
+#define POOL_TABLE_BUCKETS  256
+
+typedef struct pool_block {
+    struct pool_block *next;    // Free list link while cached
+    struct pool_block *chain;   // Next block in the same table bucket
+    float *data;                // The buffer handed out
+    size_t size;                // Bytes of float data
+    int size_class;             // -1 = too large for any class, never cached
+    int large_pages;            // VirtualAlloc'd with MEM_LARGE_PAGES
+} pool_block_t;
+
+static struct {
+    int started;
+    int huge_pages;
+    long long max_cached_bytes;
+    pool_block_t *free_lists[POOL_NUM_CLASSES];
+    pool_block_t *table[POOL_TABLE_BUCKETS];    // Every live block, in use or cached
+    mutex_t lock;                               // Set up once, used even when stopped
+    pool_stats_t stats;
+} buffers;
+static once_t buffers_once = ONCE_INIT;
+
+static void init_buffers_lock(void) {
+    mutex_init(&buffers.lock);
+}
+
+// Blocks are at least 4 KB apart (2 MB for huge pages), so the address
+// is mixed before it picks a bucket
+static pool_block_t **table_bucket(const float *data) {
+    uint64_t h = (uint64_t)(uintptr_t)data * 0x9E3779B97F4A7C15ULL;
+    return &buffers.table[h >> 56];
+}
+
+// The table link that points at the block holding data, or NULL if data
+// did not come from pool_alloc_float. Called with the lock held.
+static pool_block_t **table_find(const float *data) {
+    pool_block_t **link = table_bucket(data);
+    while (*link != NULL && (*link)->data != data) {
+        link = &(*link)->chain;
+    }
+    return *link != NULL ? link : NULL;
+}
+
+static void release_block(pool_block_t *block) {
+#ifdef _WIN32
+    if (block->large_pages) {
+        VirtualFree(block->data, 0, MEM_RELEASE);
+    } else {
+        _aligned_free(block->data);
+    }
+#else
+    free(block->data);
+#endif
+    free(block);
+}
+
+static pool_block_t *new_block(size_t size, int size_class, int huge_pages) {
+    pool_block_t *block = (pool_block_t *)malloc(sizeof(pool_block_t));
+    if (block == NULL) {
+        return NULL;
+    }
+    void *memory = NULL;
+    int large_pages = 0;
+#ifdef _WIN32
+    size_t large_page = huge_pages ? GetLargePageMinimum() : 0;
+    if (large_page > 0 && size >= large_page) {
+        // Class sizes from 2 MB up are already whole large pages
+        size_t total = (size + large_page - 1) & ~(large_page - 1);
+        memory = VirtualAlloc(NULL, total, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+        large_pages = memory != NULL;
+    }
+    if (memory == NULL) {
+        memory = _aligned_malloc(size, BUFFER_ALIGNMENT);
+    }
+#else
+    size_t alignment = huge_pages && size >= POOL_HUGE_BYTES ? POOL_HUGE_BYTES : BUFFER_ALIGNMENT;
+    if (posix_memalign(&memory, alignment, size) != 0) {
+        memory = NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (memory != NULL && alignment == POOL_HUGE_BYTES) {
+        madvise(memory, size, MADV_HUGEPAGE);   // A hint; ignored if THP is off
+    }
+#endif
+#endif
+    if (memory == NULL) {
+        free(block);
+        return NULL;
+    }
+    // Pre-fault every page now rather than in the first conversion
+    for (size_t offset = 0; offset < size; offset += POOL_PAGE_BYTES) {
+        ((volatile char *)memory)[offset] = 0;
+    }
+    block->next = NULL;
+    block->chain = NULL;
+    block->data = (float *)memory;
+    block->size = size;
+    block->size_class = size_class;
+    block->large_pages = large_pages;
+    return block;
+}
+
+// Start the pool, caching up to max_cached_bytes of released buffers (0 =
+// IMGCVT_POOL_BYTES or 256 MB). huge_pages 0 reads IMGCVT_HUGE_PAGES.
+// Restarts the pool if it is already running. Returns 0.
+int pool_init(long long max_cached_bytes, int huge_pages) {
+    pool_shutdown();
+
+    if (max_cached_bytes <= 0) {
+        const char *env = getenv("IMGCVT_POOL_BYTES");
+        max_cached_bytes = env != NULL ? atoll(env) : 0;
+    }
+    if (max_cached_bytes <= 0) {
+        max_cached_bytes = POOL_DEFAULT_BYTES;
+    }
+    if (huge_pages == 0) {
+        const char *env = getenv("IMGCVT_HUGE_PAGES");
+        huge_pages = env != NULL && atoi(env) > 0;
+    }
+
+    run_once(&buffers_once, init_buffers_lock);
+    mutex_lock(&buffers.lock);
+    buffers.huge_pages = huge_pages > 0;
+    buffers.max_cached_bytes = max_cached_bytes;
+    for (int c = 0; c < POOL_NUM_CLASSES; c++) {
+        buffers.free_lists[c] = NULL;
+    }
+    buffers.stats.hits = 0;
+    buffers.stats.misses = 0;
+    buffers.stats.cached_bytes = 0;
+    buffers.started = 1;
+    mutex_unlock(&buffers.lock);
+    return 0;
+}
+
+// Release every cached buffer to the system. Buffers still in use can be
+// passed to pool_free_float afterwards as usual.
+void pool_trim(void) {
+    if (!buffers.started) {
+        return;
+    }
+    mutex_lock(&buffers.lock);
+    for (int c = 0; c < POOL_NUM_CLASSES; c++) {
+        while (buffers.free_lists[c] != NULL) {
+            pool_block_t *block = buffers.free_lists[c];
+            buffers.free_lists[c] = block->next;
+            pool_block_t **link = table_find(block->data);
+            *link = block->chain;
+            release_block(block);
+        }
+    }
+    buffers.stats.cached_bytes = 0;
+    mutex_unlock(&buffers.lock);
+}
+
+// Trim and stop the pool; pool_alloc_float then allocates every buffer
+void pool_shutdown(void) {
+    if (!buffers.started) {
+        return;
+    }
+    pool_trim();
+    mutex_lock(&buffers.lock);
+    buffers.started = 0;
+    mutex_unlock(&buffers.lock);
+}
+
+void pool_get_stats(pool_stats_t *stats) {
+    if (!buffers.started) {
+        stats->hits = 0;
+        stats->misses = 0;
+        stats->cached_bytes = 0;
+        return;
+    }
+    mutex_lock(&buffers.lock);
+    *stats = buffers.stats;
+    mutex_unlock(&buffers.lock);
+}
+
+// Get an aligned, pre-faulted array of n floats (NULL on failure or
+// n <= 0), from the pool if it holds one of the right class
+float* pool_alloc_float(int n) {
+    if (n <= 0) {
+        return NULL;
+    }
+    size_t bytes = (size_t)n * sizeof(float);
+    int size_class = 0;
+    while (size_class < POOL_NUM_CLASSES && ((size_t)1 << (POOL_MIN_SHIFT + size_class)) < bytes) {
+        size_class++;
+    }
+    size_t size;
+    if (size_class < POOL_NUM_CLASSES) {
+        size = (size_t)1 << (POOL_MIN_SHIFT + size_class);
+    } else {
+        size_class = -1;
+        size = (bytes + BUFFER_ALIGNMENT - 1) & ~(size_t)(BUFFER_ALIGNMENT - 1);
+    }
+
+    run_once(&buffers_once, init_buffers_lock);
+    pool_block_t *block = NULL;
+    mutex_lock(&buffers.lock);
+    int huge_pages = buffers.started && buffers.huge_pages;
+    if (buffers.started) {
+        if (size_class >= 0 && buffers.free_lists[size_class] != NULL) {
+            block = buffers.free_lists[size_class];
+            buffers.free_lists[size_class] = block->next;
+            buffers.stats.cached_bytes -= (long long)block->size;
+            buffers.stats.hits++;
+        } else {
+            buffers.stats.misses++;
+        }
+    }
+    mutex_unlock(&buffers.lock);
+    if (block == NULL) {
+        // Created outside the lock: pre-faulting a large block takes a while
+        block = new_block(size, size_class, huge_pages);
+        if (block == NULL) {
+            return NULL;
+        }
+        mutex_lock(&buffers.lock);
+        pool_block_t **bucket = table_bucket(block->data);
+        block->chain = *bucket;
+        *bucket = block;
+        mutex_unlock(&buffers.lock);
+    }
+    return block->data;
+}
+
+// Return an array from pool_alloc_float to the pool, or to the system if
+// the pool is stopped or already holds max_cached_bytes
+void pool_free_float(float *buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+    run_once(&buffers_once, init_buffers_lock);
+    mutex_lock(&buffers.lock);
+    pool_block_t **link = table_find(buffer);
+    pool_block_t *block = link != NULL ? *link : NULL;
+    if (block != NULL && buffers.started && block->size_class >= 0 &&
+        buffers.stats.cached_bytes + (long long)block->size <= buffers.max_cached_bytes) {
+        block->next = buffers.free_lists[block->size_class];
+        buffers.free_lists[block->size_class] = block;
+        buffers.stats.cached_bytes += (long long)block->size;
+        block = NULL;
+    } else if (block != NULL) {
+        *link = block->chain;
+    }
+    mutex_unlock(&buffers.lock);
+    if (block != NULL) {
+        release_block(block);
+    }
+}
@@ -0,0 +1,146 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// Batch conversion for many small frames (thumbnails, tiles, patches).
+// Calling an _Auto function once per frame pays the dispatch check, a
+// malloc and the kernel's setup for every few hundred pixels. Here the
+// kernel is resolved once for the whole batch, all outputs come from one
+// allocation, and with parallel_init the frames are spread across the
+// thread pool in groups of about PARALLEL_BAND_PIXELS pixels.
+
+typedef struct {
+    const gray_frame_t *frames;
+    int input_bytes;
+    void (*int_into)(int n, int *a, float *out);
+    void (*u8_into)(int n, uint8_t *a, float *out);
+} batch_job_t;
+
+// Frame views start on a BUFFER_ALIGNMENT boundary
+#define FRAME_ALIGN_FLOATS  (BUFFER_ALIGNMENT / (int)sizeof(float))
+
+static long long aligned_frame_floats(int n) {
+    return ((long long)n + FRAME_ALIGN_FLOATS - 1) & ~(long long)(FRAME_ALIGN_FLOATS - 1);
+}
+
+// Convert frames [start, start + count)
+static void frame_band(void *ctx, long long start, long long count) {
+    batch_job_t *job = (batch_job_t *)ctx;
+    for (long long i = start; i < start + count; i++) {
+        const gray_frame_t *frame = &job->frames[i];
+        if (frame->n <= 0) {
+            continue;
+        }
+        if (job->input_bytes == 1) {
+            job->u8_into(frame->n, (uint8_t *)frame->pixels, frame->out);
+        } else {
+            job->int_into(frame->n, (int *)frame->pixels, frame->out);
+        }
+    }
+}
+
+// Convert every frame into its out array. input_bytes is 1 for uint8_t
+// pixels or 4 for int. Returns 0, or -1 on bad arguments (nothing is
+// converted then).
+int convert_batch_into(const gray_frame_t *frames, int num_frames, int input_bytes) {
+    if (num_frames < 0 || (num_frames > 0 && frames == NULL)) {
+        return -1;
+    }
+    if (input_bytes != 1 && input_bytes != 4) {
+        return -1;
+    }
+    long long total = 0;
+    for (int i = 0; i < num_frames; i++) {
+        if (frames[i].n < 0 || (frames[i].n > 0 && (frames[i].pixels == NULL || frames[i].out == NULL))) {
+            return -1;
+        }
+        total += frames[i].n;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // Small frames stay in cache, so the plain kernels are used throughout
+    batch_job_t job = {frames, input_bytes, selected_kernel()->convert_into,
+                       selected_u8_kernel()->convert_into};
+
+    // Group frames so each band holds about PARALLEL_BAND_PIXELS pixels
+    long long average = total / num_frames;
+    long long band_frames = average > 0 ? PARALLEL_BAND_PIXELS / average : PARALLEL_BAND_PIXELS;
+    if (band_frames < 1) {
+        band_frames = 1;
+    }
+    parallel_for(num_frames, band_frames, frame_band, &job);
+    return 0;
+}
+
+// Allocate one output buffer for the whole batch, point each frame's out
+// at its view (64-byte aligned) and convert. Returns the buffer, to be
+// released with free_float_buffer, or NULL on failure or an empty batch.
+float* convert_batch(gray_frame_t *frames, int num_frames, int input_bytes) {
+    if (num_frames <= 0 || frames == NULL || (input_bytes != 1 && input_bytes != 4)) {
+        return NULL;
+    }
+    long long total = 0;
+    for (int i = 0; i < num_frames; i++) {
+        if (frames[i].n < 0) {
+            return NULL;
+        }
+        total += aligned_frame_floats(frames[i].n);
+    }
+    if (total == 0 || total > INT_MAX) {
+        return NULL;
+    }
+    float *buffer = alloc_float_buffer((int)total);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    long long offset = 0;
+    for (int i = 0; i < num_frames; i++) {
+        frames[i].out = buffer + offset;
+        offset += aligned_frame_floats(frames[i].n);
+    }
+    if (convert_batch_into(frames, num_frames, input_bytes) != 0) {
+        free_float_buffer(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+// Packed batch: frame i is pixels[offsets[i] .. offsets[i + 1]) and lands
+// at the same offsets in out. Conversion is per pixel, so the whole range
+// goes through one (parallel) kernel call however many frames it holds.
+// Returns 0, or -1 on bad arguments.
+int convert_packed_into(void *pixels, const int *offsets, int num_frames,
+                        int input_bytes, float *out) {
+    if (num_frames < 0 || (num_frames > 0 && offsets == NULL)) {
+        return -1;
+    }
+    if (input_bytes != 1 && input_bytes != 4) {
+        return -1;
+    }
+    if (num_frames == 0) {
+        return 0;
+    }
+    for (int i = 0; i < num_frames; i++) {
+        if (offsets[i] < 0 || offsets[i + 1] < offsets[i]) {
+            return -1;
+        }
+    }
+    int start = offsets[0];
+    int count = offsets[num_frames] - start;
+    if (count == 0) {
+        return 0;
+    }
+    if (pixels == NULL || out == NULL) {
+        return -1;
+    }
+    if (input_bytes == 1) {
+        imgCvtGrayU8toFloat_Parallel_into(selected_u8_kernel(), count, (uint8_t *)pixels + start, out + start);
+    } else {
+        imgCvtGrayInttoFloat_Parallel_into(selected_kernel(), count, (int *)pixels + start, out + start);
+    }
+    return 0;
+}
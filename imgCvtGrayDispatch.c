@@ -0,0 +1,700 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "imgCvtGray.h"
+#include "imgCvtGrayThread.h"
+
+// Runtime CPU-feature dispatch for the grayscale conversion kernels.
+// CPUID runs once, on the first call to imgCvtGrayInttoFloat_Auto (or
+// selected_kernel or any other dispatcher query), and every choice is
+// cached from then on.
+// Set IMGCVT_KERNEL to a kernel name to override the choice; the name
+// applies to every table that has a kernel by that name (e.g. avx2).
+// The lookup-table kernels sit below C in the table: they clamp out-of-range
+// inputs, so CPU dispatch only uses them when asked to by name.
+// Frames of at least nt_threshold_pixels(input bytes) pixels go to the
+// kernel's streaming-store variant, if it has one.
+
+const kernel_t kernels[] = {
+    {{"scalar",   "Assembly", 0},                  imgCvtGrayInttoFloat,          imgCvtGrayInttoFloat_into,          NULL,                                imgCvtGrayInttoFloat_inplace},
+    {{"lut_c",    "LUT C",    0},                  imgCvtGrayInttoFloat_LUT_C,    imgCvtGrayInttoFloat_LUT_C_into,    NULL,                                imgCvtGrayInttoFloat_LUT_C_inplace},
+    {{"lut",      "LUT Asm",  0},                  imgCvtGrayInttoFloat_LUT,      imgCvtGrayInttoFloat_LUT_into,      NULL,                                imgCvtGrayInttoFloat_LUT_inplace},
+    {{"lut_avx2", "LUT AVX2", CPU_AVX2},           imgCvtGrayInttoFloat_LUT_AVX2, imgCvtGrayInttoFloat_LUT_AVX2_into, NULL,                                imgCvtGrayInttoFloat_LUT_AVX2_inplace},
+    {{"c",        "C",        0},                  imgCvtGrayInttoFloat_C,        imgCvtGrayInttoFloat_C_into,        NULL,                                imgCvtGrayInttoFloat_C_inplace},
+    {{"sse2",     "SSE2",     CPU_SSE2},           imgCvtGrayInttoFloat_SSE2,     imgCvtGrayInttoFloat_SSE2_into,     imgCvtGrayInttoFloat_SSE2_NT_into,   imgCvtGrayInttoFloat_SSE2_inplace},
+    {{"avx2",     "AVX2",     CPU_AVX2 | CPU_FMA}, imgCvtGrayInttoFloat_AVX2,     imgCvtGrayInttoFloat_AVX2_into,     imgCvtGrayInttoFloat_AVX2_NT_into,   imgCvtGrayInttoFloat_AVX2_inplace},
+    {{"avx512",   "AVX-512",  CPU_AVX512F},        imgCvtGrayInttoFloat_AVX512,   imgCvtGrayInttoFloat_AVX512_into,   imgCvtGrayInttoFloat_AVX512_NT_into, imgCvtGrayInttoFloat_AVX512_inplace},
+};
+const int num_kernels = (int)(sizeof(kernels) / sizeof(kernels[0]));
+
+const u8_kernel_t u8_kernels[] = {
+    {{"c",      "C",          0},                  imgCvtGrayU8toFloat_C,      imgCvtGrayU8toFloat_C_into,      NULL},
+    {{"sse41",  "SSE4.1",     CPU_SSE41},          imgCvtGrayU8toFloat_SSE41,  imgCvtGrayU8toFloat_SSE41_into,  imgCvtGrayU8toFloat_SSE41_NT_into},
+    {{"avx2",   "AVX2",       CPU_AVX2 | CPU_FMA}, imgCvtGrayU8toFloat_AVX2,   imgCvtGrayU8toFloat_AVX2_into,   imgCvtGrayU8toFloat_AVX2_NT_into},
+    {{"avx512", "AVX-512",    CPU_AVX512F},        imgCvtGrayU8toFloat_AVX512, imgCvtGrayU8toFloat_AVX512_into, imgCvtGrayU8toFloat_AVX512_NT_into},
+};
+const int num_u8_kernels = (int)(sizeof(u8_kernels) / sizeof(u8_kernels[0]));
+
+const rgb_kernel_t rgb_kernels[] = {
+    {{"c",      "C",          0},                  imgCvtGrayRGBtoFloat_C_into,     imgCvtGrayRGBAtoFloat_C_into},
+    {{"sse41",  "SSE4.1",     CPU_SSE41},          imgCvtGrayRGBtoFloat_SSE41_into, imgCvtGrayRGBAtoFloat_SSE41_into},
+    {{"avx2",   "AVX2",       CPU_AVX2 | CPU_FMA}, imgCvtGrayRGBtoFloat_AVX2_into,  imgCvtGrayRGBAtoFloat_AVX2_into},
+};
+const int num_rgb_kernels = (int)(sizeof(rgb_kernels) / sizeof(rgb_kernels[0]));
+
+const affine_kernel_t affine_kernels[] = {
+    {{"c",      "C",          0},
+     imgCvtGrayU8toFloat_Affine_C_into,      imgCvtGrayU16toFloat_Affine_C_into,      imgCvtGrayInttoFloat_Affine_C_into,
+     imgCvtGrayU8toHalf_Affine_C_into,       imgCvtGrayU16toHalf_Affine_C_into,       imgCvtGrayInttoHalf_Affine_C_into,
+     imgCvtGrayU8toBF16_Affine_C_into,       imgCvtGrayU16toBF16_Affine_C_into,       imgCvtGrayInttoBF16_Affine_C_into},
+    {{"avx2",   "AVX2",       CPU_AVX2 | CPU_F16C},
+     imgCvtGrayU8toFloat_Affine_AVX2_into,   imgCvtGrayU16toFloat_Affine_AVX2_into,   imgCvtGrayInttoFloat_Affine_AVX2_into,
+     imgCvtGrayU8toHalf_Affine_AVX2_into,    imgCvtGrayU16toHalf_Affine_AVX2_into,    imgCvtGrayInttoHalf_Affine_AVX2_into,
+     imgCvtGrayU8toBF16_Affine_AVX2_into,    imgCvtGrayU16toBF16_Affine_AVX2_into,    imgCvtGrayInttoBF16_Affine_AVX2_into},
+    {{"avx512", "AVX-512",    CPU_AVX512F},
+     imgCvtGrayU8toFloat_Affine_AVX512_into, imgCvtGrayU16toFloat_Affine_AVX512_into, imgCvtGrayInttoFloat_Affine_AVX512_into,
+     imgCvtGrayU8toHalf_Affine_AVX512_into,  imgCvtGrayU16toHalf_Affine_AVX512_into,  imgCvtGrayInttoHalf_Affine_AVX512_into,
+     imgCvtGrayU8toBF16_Affine_AVX512_into,  imgCvtGrayU16toBF16_Affine_AVX512_into,  imgCvtGrayInttoBF16_Affine_AVX512_into},
+};
+const int num_affine_kernels = (int)(sizeof(affine_kernels) / sizeof(affine_kernels[0]));
+
+const half_kernel_t half_kernels[] = {
+    {{"c",      "C",          0},                             imgCvtGrayInttoHalf_C_into,      imgCvtGrayU8toHalf_C_into,      imgCvtGrayInttoBF16_C_into,      imgCvtGrayU8toBF16_C_into},
+    {{"avx2",   "AVX2",       CPU_AVX2 | CPU_FMA | CPU_F16C}, imgCvtGrayInttoHalf_AVX2_into,   imgCvtGrayU8toHalf_AVX2_into,   imgCvtGrayInttoBF16_AVX2_into,   imgCvtGrayU8toBF16_AVX2_into},
+    {{"avx512", "AVX-512",    CPU_AVX512F},                   imgCvtGrayInttoHalf_AVX512_into, imgCvtGrayU8toHalf_AVX512_into, imgCvtGrayInttoBF16_AVX512_into, imgCvtGrayU8toBF16_AVX512_into},
+};
+const int num_half_kernels = (int)(sizeof(half_kernels) / sizeof(half_kernels[0]));
+
+const inverse_kernel_t inverse_kernels[] = {
+    {{"c",      "C",          0},           imgCvtGrayFloattoU8_C_into,      imgCvtGrayFloattoInt_C_into},
+    {{"sse41",  "SSE4.1",     CPU_SSE41},   imgCvtGrayFloattoU8_SSE41_into,  imgCvtGrayFloattoInt_SSE41_into},
+    {{"avx2",   "AVX2",       CPU_AVX2},    imgCvtGrayFloattoU8_AVX2_into,   imgCvtGrayFloattoInt_AVX2_into},
+    {{"avx512", "AVX-512",    CPU_AVX512F}, imgCvtGrayFloattoU8_AVX512_into, imgCvtGrayFloattoInt_AVX512_into},
+};
+const int num_inverse_kernels = (int)(sizeof(inverse_kernels) / sizeof(inverse_kernels[0]));
+
+static void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+    __cpuidex((int *)regs, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state the OS saves on context switch (XCR0)
+static unsigned long long xgetbv0(void) {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+// The CPU_* features this host can use
+static int read_cpu_features(void) {
+    unsigned int regs[4];
+    int result = 0;
+
+    cpuid(0, 0, regs);
+    unsigned int max_leaf = regs[0];
+
+    cpuid(1, 0, regs);
+    if (regs[3] & (1u << 26)) result |= CPU_SSE2;
+    if (regs[2] & (1u << 19)) result |= CPU_SSE41;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0 bits 1-2)
+    int os_avx = 0, os_avx512 = 0;
+    if (regs[2] & (1u << 27)) {
+        unsigned long long xcr0 = xgetbv0();
+        os_avx = (xcr0 & 0x06) == 0x06;
+        os_avx512 = (xcr0 & 0xE6) == 0xE6;  // plus opmask and ZMM state
+    }
+    if (os_avx && (regs[2] & (1u << 12))) result |= CPU_FMA;
+    if (os_avx && (regs[2] & (1u << 29))) result |= CPU_F16C;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, regs);
+        if (os_avx && (regs[1] & (1u << 5))) result |= CPU_AVX2;
+        if (os_avx512 && (regs[1] & (1u << 16))) result |= CPU_AVX512F;
+    }
+
+    return result;
+}
+
+// CPU brand string from CPUID leaves 0x80000002-4 ("unknown" if absent)
+static void read_brand_string(char brand[49]) {
+    unsigned int regs[4];
+    cpuid(0x80000000, 0, regs);
+    if (regs[0] < 0x80000004) {
+        strcpy(brand, "unknown");
+        return;
+    }
+    for (int leaf = 0; leaf < 3; leaf++) {
+        cpuid(0x80000002 + leaf, 0, regs);
+        memcpy(brand + leaf * 16, regs, 16);
+    }
+    brand[48] = '\0';
+
+    // Drop the leading padding some CPUs report
+    char *start = brand;
+    while (*start == ' ') start++;
+    memmove(brand, start, strlen(start) + 1);
+}
+
+// Size in bytes of the largest cache CPUID describes (leaf 4 on Intel,
+// 0x8000001D on AMD), normally the shared last-level cache. 0 if unknown.
+static long long read_llc_bytes(void) {
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    unsigned int max_leaf = regs[0];
+    cpuid(0x80000000, 0, regs);
+    unsigned int max_ext_leaf = regs[0];
+
+    long long largest = 0;
+    unsigned int leaves[2] = {4, 0x8000001D};
+    unsigned int max_leaves[2] = {max_leaf, max_ext_leaf};
+    for (int l = 0; l < 2 && largest == 0; l++) {
+        if (max_leaves[l] < leaves[l]) {
+            continue;
+        }
+        for (int sub = 0; sub < 16; sub++) {
+            cpuid(leaves[l], sub, regs);
+            if ((regs[0] & 0x1F) == 0) {
+                break;  // No more cache levels
+            }
+            long long ways = (regs[1] >> 22) + 1;
+            long long partitions = ((regs[1] >> 12) & 0x3FF) + 1;
+            long long line = (regs[1] & 0xFFF) + 1;
+            long long sets = (long long)regs[2] + 1;
+            long long bytes = ways * partitions * line * sets;
+            if (bytes > largest) largest = bytes;
+        }
+    }
+    return largest;
+}
+
+// IMGCVT_NT_PIXELS as a pixel count (negative = never, LLONG_MAX), or 0
+// if it is not set
+static long long read_nt_override(void) {
+    const char *env = getenv("IMGCVT_NT_PIXELS");
+    if (env != NULL && env[0] != '\0') {
+        long long pixels = atoll(env);
+        return pixels < 0 ? LLONG_MAX : pixels > 0 ? pixels : 1;
+    }
+    return 0;
+}
+
+static int features_cover(int features, const kernel_info_t *info) {
+    return (features & info->required_features) == info->required_features;
+}
+
+// Entry k of a kernel table whose entries start with a kernel_info_t
+static const kernel_info_t *info_at(const void *table, size_t stride, int k) {
+    return (const kernel_info_t *)((const char *)table + (size_t)k * stride);
+}
+
+// Index of the kernel to use from a table ordered by preference: the one
+// named by IMGCVT_KERNEL if this table has it and the CPU supports it,
+// otherwise the fastest supported kernel
+static int pick_kernel(const void *table, size_t stride, int count, int features) {
+    const char *override = getenv("IMGCVT_KERNEL");
+    if (override != NULL && override[0] != '\0') {
+        for (int k = 0; k < count; k++) {
+            const kernel_info_t *info = info_at(table, stride, k);
+            if (strcmp(info->name, override) == 0) {
+                if (features_cover(features, info)) {
+                    return k;
+                }
+                fprintf(stderr, "IMGCVT_KERNEL=%s: not supported by this CPU, using CPU dispatch\n", override);
+                break;
+            }
+        }
+    }
+
+    for (int k = count - 1; k > 0; k--) {
+        if (features_cover(features, info_at(table, stride, k))) {
+            return k;
+        }
+    }
+    return 0;
+}
+
+// Look up a kernel by its short name
+const kernel_t *find_kernel(const char *name) {
+    for (int k = 0; k < num_kernels; k++) {
+        if (strcmp(kernels[k].info.name, name) == 0) {
+            return &kernels[k];
+        }
+    }
+    return NULL;
+}
+
+// Everything the dispatcher decides, resolved once. Threads that make
+// their first call at the same time all wait for the one resolution
+// (pthread_once / InitOnceExecuteOnce) and then see every field set.
+static struct {
+    int features;
+    long long llc_bytes;
+    long long nt_override;          // IMGCVT_NT_PIXELS, 0 if not set
+    char brand[49];
+    const kernel_t *kernel;
+    const u8_kernel_t *u8_kernel;
+    const rgb_kernel_t *rgb_kernel;
+    const affine_kernel_t *affine_kernel;
+    const half_kernel_t *half_kernel;
+    const inverse_kernel_t *inverse_kernel;
+    long long auto_nt_pixels;       // _Auto: streaming stores from here on
+} dispatch;
+static once_t dispatch_once = ONCE_INIT;
+
+#define PICK(table, count) &table[pick_kernel(table, sizeof(table[0]), count, dispatch.features)]
+
+// Frames of at least this many pixels are converted with streaming stores:
+// IMGCVT_NT_PIXELS if set, otherwise a frame whose input (in_bytes per
+// pixel) and float output together fill the last-level cache (8 MB if that
+// is unknown): 1M int pixels or 1.6M uint8_t pixels for 8 MB. Below that,
+// the output is likely to still be cached when the caller reads it.
+// performance_test measures the real crossover.
+static long long nt_pixels_for(int in_bytes) {
+    if (dispatch.nt_override > 0) {
+        return dispatch.nt_override;
+    }
+    long long llc = dispatch.llc_bytes > 0 ? dispatch.llc_bytes : 8LL << 20;
+    return llc / (in_bytes + (long long)sizeof(float));
+}
+
+static void resolve_dispatch(void) {
+    dispatch.features = read_cpu_features();
+    dispatch.llc_bytes = read_llc_bytes();
+    dispatch.nt_override = read_nt_override();
+    read_brand_string(dispatch.brand);
+    dispatch.kernel = PICK(kernels, num_kernels);
+    dispatch.u8_kernel = PICK(u8_kernels, num_u8_kernels);
+    dispatch.rgb_kernel = PICK(rgb_kernels, num_rgb_kernels);
+    dispatch.affine_kernel = PICK(affine_kernels, num_affine_kernels);
+    dispatch.half_kernel = PICK(half_kernels, num_half_kernels);
+    dispatch.inverse_kernel = PICK(inverse_kernels, num_inverse_kernels);
+    dispatch.auto_nt_pixels = dispatch.kernel->convert_into_nt != NULL ? nt_pixels_for(sizeof(int)) : LLONG_MAX;
+}
+
+static void resolve(void) {
+    run_once(&dispatch_once, resolve_dispatch);
+}
+
+// Detect the CPU_* features this host can use
+int detect_cpu_features(void) {
+    resolve();
+    return dispatch.features;
+}
+
+const char *cpu_brand_string(void) {
+    resolve();
+    return dispatch.brand;
+}
+
+long long cache_llc_bytes(void) {
+    resolve();
+    return dispatch.llc_bytes;
+}
+
+long long nt_threshold_pixels(int in_bytes) {
+    resolve();
+    return nt_pixels_for(in_bytes);
+}
+
+// Whether a frame of n pixels of in_bytes input each should use the
+// streaming-store variants
+int use_streaming_stores(long long n, int in_bytes) {
+    return n >= nt_threshold_pixels(in_bytes);
+}
+
+// Check whether the host CPU can run a kernel
+int kernel_supported(const kernel_info_t *info) {
+    return features_cover(detect_cpu_features(), info);
+}
+
+// Kernel used by imgCvtGrayInttoFloat_Auto
+const kernel_t *selected_kernel(void) {
+    resolve();
+    return dispatch.kernel;
+}
+
+// Kernel used by imgCvtGrayU8toFloat_Auto
+const u8_kernel_t *selected_u8_kernel(void) {
+    resolve();
+    return dispatch.u8_kernel;
+}
+
+// Kernel used by the imgCvtGrayRGB(A)toFloat_Auto functions
+const rgb_kernel_t *selected_rgb_kernel(void) {
+    resolve();
+    return dispatch.rgb_kernel;
+}
+
+// Kernel used by the imgCvtGray*toFloat_Affine_Auto functions
+const affine_kernel_t *selected_affine_kernel(void) {
+    resolve();
+    return dispatch.affine_kernel;
+}
+
+// Kernel used by the imgCvtGray*toHalf/BF16_Auto functions
+const half_kernel_t *selected_half_kernel(void) {
+    resolve();
+    return dispatch.half_kernel;
+}
+
+// Kernel used by the imgCvtGrayFloatto*_Auto functions
+const inverse_kernel_t *selected_inverse_kernel(void) {
+    resolve();
+    return dispatch.inverse_kernel;
+}
+
+// Convert with the fastest kernel available on this CPU
+float* imgCvtGrayInttoFloat_Auto(int n, int *a) {
+    resolve();
+    if (n >= dispatch.auto_nt_pixels) {
+        float *out = (float *)malloc((size_t)n * sizeof(float));
+        if (out != NULL) {
+            dispatch.kernel->convert_into_nt(n, a, out);
+        }
+        return out;
+    }
+    return dispatch.kernel->convert(n, a);
+}
+
+// Convert into a caller-owned array with the fastest kernel available
+void imgCvtGrayInttoFloat_Auto_into(int n, int *a, float *out) {
+    resolve();
+    if (n >= dispatch.auto_nt_pixels) {
+        dispatch.kernel->convert_into_nt(n, a, out);
+    } else {
+        dispatch.kernel->convert_into(n, a, out);
+    }
+}
+
+// 8-bit input: the u8 table is small, so these just go through the cache
+float* imgCvtGrayU8toFloat_Auto(int n, uint8_t *a) {
+    const u8_kernel_t *kernel = selected_u8_kernel();
+    if (kernel->convert_into_nt != NULL && use_streaming_stores(n, sizeof(uint8_t))) {
+        float *out = (float *)malloc((size_t)n * sizeof(float));
+        if (out != NULL) {
+            kernel->convert_into_nt(n, a, out);
+        }
+        return out;
+    }
+    return kernel->convert(n, a);
+}
+
+void imgCvtGrayU8toFloat_Auto_into(int n, uint8_t *a, float *out) {
+    const u8_kernel_t *kernel = selected_u8_kernel();
+    if (kernel->convert_into_nt != NULL && use_streaming_stores(n, sizeof(uint8_t))) {
+        kernel->convert_into_nt(n, a, out);
+    } else {
+        kernel->convert_into(n, a, out);
+    }
+}
+
+// Same as _Auto_into, into a buffer from the pool (pool_init). The result
+// goes back with pool_free_float, not free.
+float* imgCvtGrayInttoFloat_Pooled(int n, int *a) {
+    float *out = pool_alloc_float(n);
+    if (out != NULL) {
+        imgCvtGrayInttoFloat_Auto_into(n, a, out);
+    }
+    return out;
+}
+
+float* imgCvtGrayU8toFloat_Pooled(int n, uint8_t *a) {
+    float *out = pool_alloc_float(n);
+    if (out != NULL) {
+        imgCvtGrayU8toFloat_Auto_into(n, a, out);
+    }
+    return out;
+}
+
+// In place over the int input, with the dispatched kernel. Streaming
+// stores are never used here: the load has just brought each line into
+// the cache, so an ordinary store costs no extra read, and a streaming
+// store would only evict it.
+float* imgCvtGrayInttoFloat_InPlace(int n, int *a) {
+    selected_kernel()->convert_inplace(n, a);
+    return (float *)a;
+}
+
+// Fused color input: malloc'd result (NULL on failure or n <= 0) or a
+// caller-owned array
+float* imgCvtGrayRGBtoFloat_Auto(int n, uint8_t *rgb, const luma_weights_t *weights) {
+    if (n <= 0) {
+        return NULL;
+    }
+    float *out = (float *)malloc((size_t)n * sizeof(float));
+    if (out != NULL) {
+        selected_rgb_kernel()->rgb_into(n, rgb, out, weights);
+    }
+    return out;
+}
+
+void imgCvtGrayRGBtoFloat_Auto_into(int n, uint8_t *rgb, float *out, const luma_weights_t *weights) {
+    selected_rgb_kernel()->rgb_into(n, rgb, out, weights);
+}
+
+float* imgCvtGrayRGBAtoFloat_Auto(int n, uint8_t *rgba, const luma_weights_t *weights) {
+    if (n <= 0) {
+        return NULL;
+    }
+    float *out = (float *)malloc((size_t)n * sizeof(float));
+    if (out != NULL) {
+        selected_rgb_kernel()->rgba_into(n, rgba, out, weights);
+    }
+    return out;
+}
+
+void imgCvtGrayRGBAtoFloat_Auto_into(int n, uint8_t *rgba, float *out, const luma_weights_t *weights) {
+    selected_rgb_kernel()->rgba_into(n, rgba, out, weights);
+}
+
+// Affine transform. affine_unit on 8-bit or int input is the plain /255
+// conversion, so it goes to the faster reciprocal kernels above, which
+// give the same bits.
+static int is_affine_unit(const affine_params_t *params) {
+    return params->divisor == 255.0f && params->mean == 0.0f && params->inv_std == 1.0f;
+}
+
+float* imgCvtGrayU8toFloat_Affine_Auto(int n, uint8_t *a, const affine_params_t *params) {
+    if (n <= 0) {
+        return NULL;
+    }
+    float *out = (float *)malloc((size_t)n * sizeof(float));
+    if (out != NULL) {
+        imgCvtGrayU8toFloat_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayU8toFloat_Affine_Auto_into(int n, uint8_t *a, float *out, const affine_params_t *params) {
+    if (is_affine_unit(params)) {
+        imgCvtGrayU8toFloat_Auto_into(n, a, out);
+    } else {
+        selected_affine_kernel()->u8_into(n, a, out, params);
+    }
+}
+
+float* imgCvtGrayU16toFloat_Affine_Auto(int n, uint16_t *a, const affine_params_t *params) {
+    if (n <= 0) {
+        return NULL;
+    }
+    float *out = (float *)malloc((size_t)n * sizeof(float));
+    if (out != NULL) {
+        selected_affine_kernel()->u16_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayU16toFloat_Affine_Auto_into(int n, uint16_t *a, float *out, const affine_params_t *params) {
+    selected_affine_kernel()->u16_into(n, a, out, params);
+}
+
+float* imgCvtGrayInttoFloat_Affine_Auto(int n, int *a, const affine_params_t *params) {
+    if (n <= 0) {
+        return NULL;
+    }
+    float *out = (float *)malloc((size_t)n * sizeof(float));
+    if (out != NULL) {
+        imgCvtGrayInttoFloat_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayInttoFloat_Affine_Auto_into(int n, int *a, float *out, const affine_params_t *params) {
+    if (is_affine_unit(params)) {
+        imgCvtGrayInttoFloat_Auto_into(n, a, out);
+    } else {
+        selected_affine_kernel()->int_into(n, a, out, params);
+    }
+}
+
+// 16-bit output: malloc'd result (NULL on failure or n <= 0) or a
+// caller-owned array
+static uint16_t *alloc_half(int n) {
+    return n > 0 ? (uint16_t *)malloc((size_t)n * sizeof(uint16_t)) : NULL;
+}
+
+uint16_t* imgCvtGrayInttoHalf_Auto(int n, int *a) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        selected_half_kernel()->int_to_half(n, a, out);
+    }
+    return out;
+}
+
+void imgCvtGrayInttoHalf_Auto_into(int n, int *a, uint16_t *out) {
+    selected_half_kernel()->int_to_half(n, a, out);
+}
+
+uint16_t* imgCvtGrayU8toHalf_Auto(int n, uint8_t *a) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        selected_half_kernel()->u8_to_half(n, a, out);
+    }
+    return out;
+}
+
+void imgCvtGrayU8toHalf_Auto_into(int n, uint8_t *a, uint16_t *out) {
+    selected_half_kernel()->u8_to_half(n, a, out);
+}
+
+uint16_t* imgCvtGrayInttoBF16_Auto(int n, int *a) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        selected_half_kernel()->int_to_bf16(n, a, out);
+    }
+    return out;
+}
+
+void imgCvtGrayInttoBF16_Auto_into(int n, int *a, uint16_t *out) {
+    selected_half_kernel()->int_to_bf16(n, a, out);
+}
+
+uint16_t* imgCvtGrayU8toBF16_Auto(int n, uint8_t *a) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        selected_half_kernel()->u8_to_bf16(n, a, out);
+    }
+    return out;
+}
+
+void imgCvtGrayU8toBF16_Auto_into(int n, uint8_t *a, uint16_t *out) {
+    selected_half_kernel()->u8_to_bf16(n, a, out);
+}
+
+// Affine transform to 16-bit output. affine_unit on 8-bit or int input
+// goes to the /255 kernels above, as for float output.
+uint16_t* imgCvtGrayU8toHalf_Affine_Auto(int n, uint8_t *a, const affine_params_t *params) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        imgCvtGrayU8toHalf_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayU8toHalf_Affine_Auto_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params) {
+    if (is_affine_unit(params)) {
+        imgCvtGrayU8toHalf_Auto_into(n, a, out);
+    } else {
+        selected_affine_kernel()->u8_to_half(n, a, out, params);
+    }
+}
+
+uint16_t* imgCvtGrayU8toBF16_Affine_Auto(int n, uint8_t *a, const affine_params_t *params) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        imgCvtGrayU8toBF16_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayU8toBF16_Affine_Auto_into(int n, uint8_t *a, uint16_t *out, const affine_params_t *params) {
+    if (is_affine_unit(params)) {
+        imgCvtGrayU8toBF16_Auto_into(n, a, out);
+    } else {
+        selected_affine_kernel()->u8_to_bf16(n, a, out, params);
+    }
+}
+
+uint16_t* imgCvtGrayU16toHalf_Affine_Auto(int n, uint16_t *a, const affine_params_t *params) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        imgCvtGrayU16toHalf_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayU16toHalf_Affine_Auto_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params) {
+    selected_affine_kernel()->u16_to_half(n, a, out, params);
+}
+
+uint16_t* imgCvtGrayU16toBF16_Affine_Auto(int n, uint16_t *a, const affine_params_t *params) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        imgCvtGrayU16toBF16_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayU16toBF16_Affine_Auto_into(int n, uint16_t *a, uint16_t *out, const affine_params_t *params) {
+    selected_affine_kernel()->u16_to_bf16(n, a, out, params);
+}
+
+uint16_t* imgCvtGrayInttoHalf_Affine_Auto(int n, int *a, const affine_params_t *params) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        imgCvtGrayInttoHalf_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayInttoHalf_Affine_Auto_into(int n, int *a, uint16_t *out, const affine_params_t *params) {
+    if (is_affine_unit(params)) {
+        imgCvtGrayInttoHalf_Auto_into(n, a, out);
+    } else {
+        selected_affine_kernel()->int_to_half(n, a, out, params);
+    }
+}
+
+uint16_t* imgCvtGrayInttoBF16_Affine_Auto(int n, int *a, const affine_params_t *params) {
+    uint16_t *out = alloc_half(n);
+    if (out != NULL) {
+        imgCvtGrayInttoBF16_Affine_Auto_into(n, a, out, params);
+    }
+    return out;
+}
+
+void imgCvtGrayInttoBF16_Affine_Auto_into(int n, int *a, uint16_t *out, const affine_params_t *params) {
+    if (is_affine_unit(params)) {
+        imgCvtGrayInttoBF16_Auto_into(n, a, out);
+    } else {
+        selected_affine_kernel()->int_to_bf16(n, a, out, params);
+    }
+}
+
+// Inverse conversion: malloc'd result (NULL on failure or n <= 0) or a
+// caller-owned array
+uint8_t* imgCvtGrayFloattoU8_Auto(int n, float *a) {
+    if (n <= 0) {
+        return NULL;
+    }
+    uint8_t *out = (uint8_t *)malloc((size_t)n);
+    if (out != NULL) {
+        selected_inverse_kernel()->to_u8(n, a, out);
+    }
+    return out;
+}
+
+void imgCvtGrayFloattoU8_Auto_into(int n, float *a, uint8_t *out) {
+    selected_inverse_kernel()->to_u8(n, a, out);
+}
+
+int* imgCvtGrayFloattoInt_Auto(int n, float *a) {
+    if (n <= 0) {
+        return NULL;
+    }
+    int *out = (int *)malloc((size_t)n * sizeof(int));
+    if (out != NULL) {
+        selected_inverse_kernel()->to_int(n, a, out);
+    }
+    return out;
+}
+
+void imgCvtGrayFloattoInt_Auto_into(int n, float *a, int *out) {
+    selected_inverse_kernel()->to_int(n, a, out);
+}
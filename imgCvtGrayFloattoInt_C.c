@@ -0,0 +1,40 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// C implementation of the inverse conversion
+// Converts float pixel values (0.0-1.0) back to 8-bit levels (0-255):
+//   out = round(min(max(x * 255, 0), 255))
+// rounding to nearest even like cvtps2dq, with NaN mapped to 0. Gives the
+// same results as asmgrayscale_inverse.asm.
+
+// Scale, clamp and round one value
+static int float_to_level(float x) {
+    float v = x * 255.0f;
+    if (!(v > 0.0f)) {
+        return 0;               // Negative, zero or NaN
+    }
+    if (v >= 255.0f) {
+        return 255;
+    }
+    // v - level is exact for 0 < v < 255, so this is round to nearest even
+    int level = (int)v;
+    float frac = v - (float)level;
+    if (frac > 0.5f || (frac == 0.5f && (level & 1))) {
+        level++;
+    }
+    return level;
+}
+
+void imgCvtGrayFloattoU8_C_into(int n, float *a, uint8_t *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = (uint8_t)float_to_level(a[i]);
+    }
+}
+
+void imgCvtGrayFloattoInt_C_into(int n, float *a, int *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = float_to_level(a[i]);
+    }
+}
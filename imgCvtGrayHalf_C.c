@@ -0,0 +1,106 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "imgCvtGray.h"
+
+// C implementation of the 16-bit output kernels
+// Computes (float)v / 255.0f as the float kernels do, then rounds it to
+// nearest even IEEE half or bfloat16 and stores the 16-bit pattern. The
+// rounding matches vcvtps2ph (mode 0) for every non-NaN float, so these
+// give the same bits as asmgrayscale_half.asm.
+
+// float -> IEEE half, round to nearest even. Overflow gives infinity,
+// tiny values become half subnormals; NaN becomes the quiet NaN 0x7E00.
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= (127u + 16u) << 23) {
+        // |value| >= 65536: infinity (or NaN); 65520-65535 rounds up below
+        half = bits > 0x7F800000u ? 0x7E00 : 0x7C00;
+    } else if (bits < (127u - 14u) << 23) {
+        // Below the smallest normal half: let the float adder round the
+        // value into the subnormal range
+        const uint32_t magic_bits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+        float magic, scaled;
+        memcpy(&magic, &magic_bits, sizeof(magic));
+        memcpy(&scaled, &bits, sizeof(scaled));
+        scaled += magic;
+        uint32_t scaled_bits;
+        memcpy(&scaled_bits, &scaled, sizeof(scaled_bits));
+        half = (uint16_t)(scaled_bits - magic_bits);
+    } else {
+        // Normal: rebias the exponent and round off 13 mantissa bits
+        uint32_t odd = (bits >> 13) & 1;
+        bits += ((15u - 127u) << 23) + 0xFFFu + odd;
+        half = (uint16_t)(bits >> 13);
+    }
+    return (uint16_t)(half | (sign >> 16));
+}
+
+float half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000u | (mantissa << 13);     // Infinity or NaN
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else {
+        // Zero or subnormal: mantissa * 2^-24 is exact in float
+        float value = (float)mantissa * (1.0f / 16777216.0f);
+        memcpy(&bits, &value, sizeof(bits));
+        bits |= sign;
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// float -> bfloat16, round to nearest even: the top half of the float
+// bits after adding 0x7FFF plus the lowest kept bit. NaN stays NaN.
+uint16_t float_to_bf16(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+        return (uint16_t)((bits >> 16) | 0x40);
+    }
+    bits += 0x7FFFu + ((bits >> 16) & 1);
+    return (uint16_t)(bits >> 16);
+}
+
+float bf16_to_float(uint16_t bf16) {
+    uint32_t bits = (uint32_t)bf16 << 16;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void imgCvtGrayInttoHalf_C_into(int n, int *a, uint16_t *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = float_to_half((float)a[i] / 255.0f);
+    }
+}
+
+void imgCvtGrayU8toHalf_C_into(int n, uint8_t *a, uint16_t *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = float_to_half((float)a[i] / 255.0f);
+    }
+}
+
+void imgCvtGrayInttoBF16_C_into(int n, int *a, uint16_t *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = float_to_bf16((float)a[i] / 255.0f);
+    }
+}
+
+void imgCvtGrayU8toBF16_C_into(int n, uint8_t *a, uint16_t *out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = float_to_bf16((float)a[i] / 255.0f);
+    }
+}
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "imgCvtGray.h"
+
+// Binary PGM (P5) and PPM (P6) loader.
+// The file is memory-mapped read-only and image->pixels points straight at
+// the sample payload inside the mapping, so frames reach the uint8_t
+// kernels without a copy. Only 8-bit files (maxval 1-255) are accepted;
+// samples are passed through unscaled, so every kernel still divides by
+// 255 whatever maxval says.
+
+// Map a whole file read-only. Returns 0 on success, -1 on failure.
+static int map_file(const char *path, pnm_image_t *image) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return -1;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);  // The mapping keeps the file open
+    if (mapping == NULL) {
+        return -1;
+    }
+    void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);  // The view keeps the mapping alive
+    if (base == NULL) {
+        return -1;
+    }
+    image->map_base = base;
+    image->map_size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file open
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+    image->map_base = base;
+    image->map_size = (size_t)st.st_size;
+#endif
+    return 0;
+}
+
+// Skip whitespace and # comments in a PNM header
+static size_t skip_space(const uint8_t *data, size_t size, size_t pos) {
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n' && data[pos] != '\r') pos++;
+        } else if (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' ||
+                   data[pos] == '\r' || data[pos] == '\v' || data[pos] == '\f') {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    return pos;
+}
+
+// Read one positive decimal header field. Returns the new position, or 0
+// if there is no valid number.
+static size_t read_field(const uint8_t *data, size_t size, size_t pos, int *value) {
+    pos = skip_space(data, size, pos);
+    long long v = 0;
+    size_t start = pos;
+    while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+        v = v * 10 + (data[pos] - '0');
+        if (v > INT_MAX) return 0;
+        pos++;
+    }
+    if (pos == start) {
+        return 0;
+    }
+    *value = (int)v;
+    return pos;
+}
+
+// Load a P5 or P6 file. Returns 0 on success, -1 on failure (message on
+// stderr). Release the image with unload_pnm.
+int load_pnm(const char *path, pnm_image_t *image) {
+    memset(image, 0, sizeof(*image));
+    if (map_file(path, image) != 0) {
+        fprintf(stderr, "%s: cannot open or map file\n", path);
+        return -1;
+    }
+
+    const uint8_t *data = (const uint8_t *)image->map_base;
+    size_t size = image->map_size;
+    if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')) {
+        fprintf(stderr, "%s: not a binary PGM (P5) or PPM (P6) file\n", path);
+        unload_pnm(image);
+        return -1;
+    }
+    image->channels = data[1] == '5' ? 1 : 3;
+
+    size_t pos = 2;
+    if ((pos = read_field(data, size, pos, &image->width)) == 0 ||
+        (pos = read_field(data, size, pos, &image->height)) == 0 ||
+        (pos = read_field(data, size, pos, &image->maxval)) == 0) {
+        fprintf(stderr, "%s: malformed header\n", path);
+        unload_pnm(image);
+        return -1;
+    }
+    if (image->maxval < 1 || image->maxval > 255) {
+        fprintf(stderr, "%s: maxval %d not supported (8-bit files only)\n", path, image->maxval);
+        unload_pnm(image);
+        return -1;
+    }
+    pos++;  // Exactly one whitespace byte separates the header from the samples
+
+    long long samples = (long long)image->width * image->height * image->channels;
+    if (image->width <= 0 || image->height <= 0 || samples > INT_MAX) {
+        fprintf(stderr, "%s: unsupported dimensions %dx%d\n", path, image->width, image->height);
+        unload_pnm(image);
+        return -1;
+    }
+    if (pos > size || size - pos < (size_t)samples) {
+        fprintf(stderr, "%s: truncated (%lld of %lld sample bytes)\n",
+                path, pos > size ? 0LL : (long long)(size - pos), samples);
+        unload_pnm(image);
+        return -1;
+    }
+
+    image->pixels = data + pos;
+    image->num_samples = (int)samples;
+    return 0;
+}
+
+// Unmap a loaded image
+void unload_pnm(pnm_image_t *image) {
+    if (image->map_base != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(image->map_base);
+#else
+        munmap(image->map_base, image->map_size);
+#endif
+    }
+    memset(image, 0, sizeof(*image));
+}
+
+// Read one positive decimal header field from a stream. Returns 0, or -1
+// if there is no valid number.
+static int read_stream_field(FILE *file, int *value) {
+    int c = fgetc(file);
+    for (;;) {
+        if (c == '#') {
+            while (c != EOF && c != '\n' && c != '\r') c = fgetc(file);
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f') {
+            c = fgetc(file);
+        } else {
+            break;
+        }
+    }
+    long long v = 0;
+    int digits = 0;
+    while (c >= '0' && c <= '9') {
+        v = v * 10 + (c - '0');
+        if (v > INT_MAX) return -1;
+        digits++;
+        c = fgetc(file);
+    }
+    // c is the whitespace byte after the field (consumed, as after maxval)
+    if (digits == 0) {
+        return -1;
+    }
+    *value = (int)v;
+    return 0;
+}
+
+// Parse a P5/P6 header from a stream (file or pipe) without mapping it,
+// leaving the stream at the first sample. Fills width, height, channels,
+// maxval and num_samples (-1 if it does not fit in an int); pixels stays
+// NULL. Returns 0 on success, -1 on failure (message on stderr).
+int read_pnm_header(FILE *file, pnm_image_t *image) {
+    memset(image, 0, sizeof(*image));
+    int p = fgetc(file), kind = fgetc(file);
+    if (p != 'P' || (kind != '5' && kind != '6')) {
+        fprintf(stderr, "not a binary PGM (P5) or PPM (P6) stream\n");
+        return -1;
+    }
+    image->channels = kind == '5' ? 1 : 3;
+    if (read_stream_field(file, &image->width) != 0 ||
+        read_stream_field(file, &image->height) != 0 ||
+        read_stream_field(file, &image->maxval) != 0 ||
+        image->width <= 0 || image->height <= 0) {
+        fprintf(stderr, "malformed PGM/PPM header\n");
+        return -1;
+    }
+    if (image->maxval < 1 || image->maxval > 255) {
+        fprintf(stderr, "maxval %d not supported (8-bit files only)\n", image->maxval);
+        return -1;
+    }
+    long long samples = (long long)image->width * image->height * image->channels;
+    image->num_samples = samples > INT_MAX ? -1 : (int)samples;
+    return 0;
+}
@@ -1,8 +1,24 @@
 #include <stdlib.h>
 
+#include "imgCvtGray.h"
+
 // C implementation of the grayscale conversion function
 // Converts integer pixel values (0-255) to float pixel values (0.0-1.0)
-// by dividing each value by 255.0
+// by dividing each value by 255.0, writing into a caller-provided array
+void imgCvtGrayInttoFloat_C_into(int n, int *a, float *out) {
+    // The affine loop with affine_unit's constants: out[i] = (float)a[i] / 255.0f
+    AFFINE_LOOP(n, a, out, 255.0f, 0.0f, 1.0f)
+}
+
+// In place: each float is written over the int it comes from
+void imgCvtGrayInttoFloat_C_inplace(int n, int *a) {
+    gray_pixel_t *pixels = (gray_pixel_t *)a;
+    for (int i = 0; i < n; i++) {
+        pixels[i].f = (float)pixels[i].i / 255.0f;
+    }
+}
+
+// Allocating version: returns a malloc'd array of n floats
 float* imgCvtGrayInttoFloat_C(int n, int *a) {
     // Check for invalid input
     if (n <= 0 || a == NULL) {
@@ -15,12 +31,8 @@ float* imgCvtGrayInttoFloat_C(int n, int *a) {
         return NULL;
     }
     
-    // Convert each int value to float by dividing by 255.0
-    for (int i = 0; i < n; i++) {
-        float_array[i] = (float)a[i] / 255.0f;
-    }
+    imgCvtGrayInttoFloat_C_into(n, a, float_array);
     
     return float_array;
 }
 
-
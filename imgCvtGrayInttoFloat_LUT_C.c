@@ -0,0 +1,80 @@
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// Table-driven C implementation of the grayscale conversion function
+// Pixel values are always 0-255, so the 256 possible results of
+// (float)v / 255.0f are stored in a constant table and each pixel becomes
+// a lookup. Inputs outside 0-255 are clamped first, like manual_mode() does.
+
+// gray_lut[v] == (float)v / 255.0f, bit for bit (9 significant digits
+// round-trip every float)
+static const float gray_lut[256] = {
+    0.0f, 0.00392156886f, 0.00784313772f, 0.0117647061f, 0.0156862754f, 0.0196078438f, 0.0235294122f, 0.0274509806f,
+    0.0313725509f, 0.0352941193f, 0.0392156877f, 0.0431372561f, 0.0470588244f, 0.0509803928f, 0.0549019612f, 0.0588235296f,
+    0.0627451017f, 0.0666666701f, 0.0705882385f, 0.0745098069f, 0.0784313753f, 0.0823529437f, 0.0862745121f, 0.0901960805f,
+    0.0941176489f, 0.0980392173f, 0.101960786f, 0.105882354f, 0.109803922f, 0.113725491f, 0.117647059f, 0.121568628f,
+    0.125490203f, 0.129411772f, 0.13333334f, 0.137254909f, 0.141176477f, 0.145098045f, 0.149019614f, 0.152941182f,
+    0.156862751f, 0.160784319f, 0.164705887f, 0.168627456f, 0.172549024f, 0.176470593f, 0.180392161f, 0.184313729f,
+    0.188235298f, 0.192156866f, 0.196078435f, 0.200000003f, 0.203921571f, 0.20784314f, 0.211764708f, 0.215686277f,
+    0.219607845f, 0.223529413f, 0.227450982f, 0.23137255f, 0.235294119f, 0.239215687f, 0.243137255f, 0.247058824f,
+    0.250980407f, 0.254901975f, 0.258823544f, 0.262745112f, 0.266666681f, 0.270588249f, 0.274509817f, 0.278431386f,
+    0.282352954f, 0.286274523f, 0.290196091f, 0.294117659f, 0.298039228f, 0.301960796f, 0.305882365f, 0.309803933f,
+    0.313725501f, 0.31764707f, 0.321568638f, 0.325490206f, 0.329411775f, 0.333333343f, 0.337254912f, 0.34117648f,
+    0.345098048f, 0.349019617f, 0.352941185f, 0.356862754f, 0.360784322f, 0.36470589f, 0.368627459f, 0.372549027f,
+    0.376470596f, 0.380392164f, 0.384313732f, 0.388235301f, 0.392156869f, 0.396078438f, 0.400000006f, 0.403921574f,
+    0.407843143f, 0.411764711f, 0.41568628f, 0.419607848f, 0.423529416f, 0.427450985f, 0.431372553f, 0.435294122f,
+    0.43921569f, 0.443137258f, 0.447058827f, 0.450980395f, 0.454901963f, 0.458823532f, 0.4627451f, 0.466666669f,
+    0.470588237f, 0.474509805f, 0.478431374f, 0.482352942f, 0.486274511f, 0.490196079f, 0.494117647f, 0.498039216f,
+    0.501960814f, 0.505882382f, 0.509803951f, 0.513725519f, 0.517647088f, 0.521568656f, 0.525490224f, 0.529411793f,
+    0.533333361f, 0.53725493f, 0.541176498f, 0.545098066f, 0.549019635f, 0.552941203f, 0.556862772f, 0.56078434f,
+    0.564705908f, 0.568627477f, 0.572549045f, 0.576470613f, 0.580392182f, 0.58431375f, 0.588235319f, 0.592156887f,
+    0.596078455f, 0.600000024f, 0.603921592f, 0.607843161f, 0.611764729f, 0.615686297f, 0.619607866f, 0.623529434f,
+    0.627451003f, 0.631372571f, 0.635294139f, 0.639215708f, 0.643137276f, 0.647058845f, 0.650980413f, 0.654901981f,
+    0.65882355f, 0.662745118f, 0.666666687f, 0.670588255f, 0.674509823f, 0.678431392f, 0.68235296f, 0.686274529f,
+    0.690196097f, 0.694117665f, 0.698039234f, 0.701960802f, 0.70588237f, 0.709803939f, 0.713725507f, 0.717647076f,
+    0.721568644f, 0.725490212f, 0.729411781f, 0.733333349f, 0.737254918f, 0.741176486f, 0.745098054f, 0.749019623f,
+    0.752941191f, 0.75686276f, 0.760784328f, 0.764705896f, 0.768627465f, 0.772549033f, 0.776470602f, 0.78039217f,
+    0.784313738f, 0.788235307f, 0.792156875f, 0.796078444f, 0.800000012f, 0.80392158f, 0.807843149f, 0.811764717f,
+    0.815686285f, 0.819607854f, 0.823529422f, 0.827450991f, 0.831372559f, 0.835294127f, 0.839215696f, 0.843137264f,
+    0.847058833f, 0.850980401f, 0.854901969f, 0.858823538f, 0.862745106f, 0.866666675f, 0.870588243f, 0.874509811f,
+    0.87843138f, 0.882352948f, 0.886274517f, 0.890196085f, 0.894117653f, 0.898039222f, 0.90196079f, 0.905882359f,
+    0.909803927f, 0.913725495f, 0.917647064f, 0.921568632f, 0.925490201f, 0.929411769f, 0.933333337f, 0.937254906f,
+    0.941176474f, 0.945098042f, 0.949019611f, 0.952941179f, 0.956862748f, 0.960784316f, 0.964705884f, 0.968627453f,
+    0.972549021f, 0.97647059f, 0.980392158f, 0.984313726f, 0.988235295f, 0.992156863f, 0.996078432f, 1.0f
+};
+
+void imgCvtGrayInttoFloat_LUT_C_into(int n, int *a, float *out) {
+    for (int i = 0; i < n; i++) {
+        int v = a[i];
+        if (v < 0) v = 0;
+        if (v > 255) v = 255;
+        out[i] = gray_lut[v];
+    }
+}
+
+void imgCvtGrayInttoFloat_LUT_C_inplace(int n, int *a) {
+    gray_pixel_t *pixels = (gray_pixel_t *)a;
+    for (int i = 0; i < n; i++) {
+        int v = pixels[i].i;
+        if (v < 0) v = 0;
+        if (v > 255) v = 255;
+        pixels[i].f = gray_lut[v];
+    }
+}
+
+// Allocating version: returns a malloc'd array of n floats
+float* imgCvtGrayInttoFloat_LUT_C(int n, int *a) {
+    if (n <= 0 || a == NULL) {
+        return NULL;
+    }
+    
+    float *float_array = (float *)malloc(n * sizeof(float));
+    if (float_array == NULL) {
+        return NULL;
+    }
+    
+    imgCvtGrayInttoFloat_LUT_C_into(n, a, float_array);
+    
+    return float_array;
+}
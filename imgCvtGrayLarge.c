@@ -0,0 +1,207 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// Frames with more pixels than an int can count (2^31 and up).
+// The kernels keep their int n; these drivers cut a size_t frame into
+// pieces of at most LARGE_PIECE_PIXELS and hand each piece to the
+// dispatched kernel, so every piece still runs the vector loop. With
+// parallel_init the frame is first split into PARALLEL_BAND_PIXELS bands
+// across the pool, like the _Parallel_into drivers; without it the
+// calling thread walks the pieces in order. Every byte count is checked
+// for overflow before anything is allocated or converted.
+
+typedef struct large_job large_job_t;
+struct large_job {
+    void (*piece)(const large_job_t *job, size_t start, int count);
+    void *in;
+    void *out;
+    const void *params;         // Luma weights or affine parameters
+    void (*int_into)(int n, int *a, float *out);
+    void (*u8_into)(int n, uint8_t *a, float *out);
+    void (*int_inplace)(int n, int *a);
+};
+
+// a * b, or -1 if it does not fit in a size_t
+int size_mul_checked(size_t a, size_t b, size_t *product) {
+    if (a != 0 && b > SIZE_MAX / a) {
+        return -1;
+    }
+    *product = a * b;
+    return 0;
+}
+
+// height * width, or -1 if either is negative or the product (or the
+// float output it needs) does not fit in a size_t
+int image_pixel_count(long long height, long long width, size_t *n) {
+    size_t pixels, bytes;
+    if (height < 0 || width < 0 ||
+        size_mul_checked((size_t)height, (size_t)width, &pixels) != 0 ||
+        size_mul_checked(pixels, sizeof(float), &bytes) != 0) {
+        return -1;
+    }
+    *n = pixels;
+    return 0;
+}
+
+// One call per piece; each fits in the kernels' int n
+#define DEFINE_PIECE(name, in_type, in_step, out_type, call)                 \
+static void name(const large_job_t *job, size_t start, int count) {          \
+    in_type *in = (in_type *)job->in + start * (in_step);                    \
+    out_type *out = (out_type *)job->out + start;                            \
+    call;                                                                    \
+}
+
+DEFINE_PIECE(int_piece, int, 1, float, job->int_into(count, in, out))
+DEFINE_PIECE(u8_piece, uint8_t, 1, float, job->u8_into(count, in, out))
+DEFINE_PIECE(rgb_piece, uint8_t, 3, float, imgCvtGrayRGBtoFloat_Auto_into(count, in, out, job->params))
+DEFINE_PIECE(rgba_piece, uint8_t, 4, float, imgCvtGrayRGBAtoFloat_Auto_into(count, in, out, job->params))
+DEFINE_PIECE(u8_affine_piece, uint8_t, 1, float, imgCvtGrayU8toFloat_Affine_Auto_into(count, in, out, job->params))
+DEFINE_PIECE(u16_affine_piece, uint16_t, 1, float, imgCvtGrayU16toFloat_Affine_Auto_into(count, in, out, job->params))
+DEFINE_PIECE(int_affine_piece, int, 1, float, imgCvtGrayInttoFloat_Affine_Auto_into(count, in, out, job->params))
+DEFINE_PIECE(int_half_piece, int, 1, uint16_t, imgCvtGrayInttoHalf_Auto_into(count, in, out))
+DEFINE_PIECE(u8_half_piece, uint8_t, 1, uint16_t, imgCvtGrayU8toHalf_Auto_into(count, in, out))
+DEFINE_PIECE(int_bf16_piece, int, 1, uint16_t, imgCvtGrayInttoBF16_Auto_into(count, in, out))
+DEFINE_PIECE(u8_bf16_piece, uint8_t, 1, uint16_t, imgCvtGrayU8toBF16_Auto_into(count, in, out))
+DEFINE_PIECE(to_u8_piece, float, 1, uint8_t, imgCvtGrayFloattoU8_Auto_into(count, in, out))
+DEFINE_PIECE(to_int_piece, float, 1, int, imgCvtGrayFloattoInt_Auto_into(count, in, out))
+
+static void inplace_piece(const large_job_t *job, size_t start, int count) {
+    job->int_inplace(count, (int *)job->in + start);
+}
+
+static void large_band(void *ctx, long long start, long long count) {
+    const large_job_t *job = (const large_job_t *)ctx;
+    while (count > 0) {
+        int piece = count < LARGE_PIECE_PIXELS ? (int)count : LARGE_PIECE_PIXELS;
+        job->piece(job, (size_t)start, piece);
+        start += piece;
+        count -= piece;
+    }
+}
+
+// Run a job over n pixels of in_bytes input and out_bytes output each.
+// Returns 0, or -1 (nothing converted) for NULL arrays or a size that
+// overflows.
+static int run_large(large_job_t *job, size_t n, size_t in_bytes, size_t out_bytes) {
+    size_t bytes;
+    if (n == 0) {
+        return 0;
+    }
+    if (job->in == NULL || job->out == NULL || n > (size_t)LLONG_MAX ||
+        size_mul_checked(n, in_bytes, &bytes) != 0 || size_mul_checked(n, out_bytes, &bytes) != 0) {
+        return -1;
+    }
+    parallel_for((long long)n, PARALLEL_BAND_PIXELS, large_band, job);
+    return 0;
+}
+
+// int and uint8_t input. Streaming stores are decided on the whole frame.
+int imgCvtGrayInttoFloat_Large_into(size_t n, int *a, float *out) {
+    const kernel_t *kernel = selected_kernel();
+    large_job_t job = {.piece = int_piece, .in = a, .out = out, .int_into = kernel->convert_into};
+    if (kernel->convert_into_nt != NULL && n <= (size_t)LLONG_MAX &&
+        use_streaming_stores((long long)n, sizeof(int))) {
+        job.int_into = kernel->convert_into_nt;
+    }
+    return run_large(&job, n, sizeof(int), sizeof(float));
+}
+
+int imgCvtGrayU8toFloat_Large_into(size_t n, uint8_t *a, float *out) {
+    const u8_kernel_t *kernel = selected_u8_kernel();
+    large_job_t job = {.piece = u8_piece, .in = a, .out = out, .u8_into = kernel->convert_into};
+    if (kernel->convert_into_nt != NULL && n <= (size_t)LLONG_MAX &&
+        use_streaming_stores((long long)n, sizeof(uint8_t))) {
+        job.u8_into = kernel->convert_into_nt;
+    }
+    return run_large(&job, n, sizeof(uint8_t), sizeof(float));
+}
+
+// In place over the int input: the frame needs one buffer, not two
+int imgCvtGrayInttoFloat_Large_inplace(size_t n, int *a) {
+    large_job_t job = {.piece = inplace_piece, .in = a, .out = a,
+                       .int_inplace = selected_kernel()->convert_inplace};
+    return run_large(&job, n, sizeof(int), sizeof(float));
+}
+
+// Allocating versions: the result comes from alloc_float_buffer_large and
+// is released with free_float_buffer. NULL for n == 0, a size that
+// overflows or a failed allocation.
+float* imgCvtGrayInttoFloat_Large(size_t n, int *a) {
+    float *out = alloc_float_buffer_large(n);
+    if (out != NULL && imgCvtGrayInttoFloat_Large_into(n, a, out) != 0) {
+        free_float_buffer(out);
+        out = NULL;
+    }
+    return out;
+}
+
+float* imgCvtGrayU8toFloat_Large(size_t n, uint8_t *a) {
+    float *out = alloc_float_buffer_large(n);
+    if (out != NULL && imgCvtGrayU8toFloat_Large_into(n, a, out) != 0) {
+        free_float_buffer(out);
+        out = NULL;
+    }
+    return out;
+}
+
+// Fused color input
+int imgCvtGrayRGBtoFloat_Large_into(size_t n, uint8_t *rgb, float *out, const luma_weights_t *weights) {
+    large_job_t job = {.piece = rgb_piece, .in = rgb, .out = out, .params = weights};
+    return run_large(&job, n, 3, sizeof(float));
+}
+
+int imgCvtGrayRGBAtoFloat_Large_into(size_t n, uint8_t *rgba, float *out, const luma_weights_t *weights) {
+    large_job_t job = {.piece = rgba_piece, .in = rgba, .out = out, .params = weights};
+    return run_large(&job, n, 4, sizeof(float));
+}
+
+// Affine transform
+int imgCvtGrayU8toFloat_Affine_Large_into(size_t n, uint8_t *a, float *out, const affine_params_t *params) {
+    large_job_t job = {.piece = u8_affine_piece, .in = a, .out = out, .params = params};
+    return run_large(&job, n, sizeof(uint8_t), sizeof(float));
+}
+
+int imgCvtGrayU16toFloat_Affine_Large_into(size_t n, uint16_t *a, float *out, const affine_params_t *params) {
+    large_job_t job = {.piece = u16_affine_piece, .in = a, .out = out, .params = params};
+    return run_large(&job, n, sizeof(uint16_t), sizeof(float));
+}
+
+int imgCvtGrayInttoFloat_Affine_Large_into(size_t n, int *a, float *out, const affine_params_t *params) {
+    large_job_t job = {.piece = int_affine_piece, .in = a, .out = out, .params = params};
+    return run_large(&job, n, sizeof(int), sizeof(float));
+}
+
+// 16-bit output
+int imgCvtGrayInttoHalf_Large_into(size_t n, int *a, uint16_t *out) {
+    large_job_t job = {.piece = int_half_piece, .in = a, .out = out};
+    return run_large(&job, n, sizeof(int), sizeof(uint16_t));
+}
+
+int imgCvtGrayU8toHalf_Large_into(size_t n, uint8_t *a, uint16_t *out) {
+    large_job_t job = {.piece = u8_half_piece, .in = a, .out = out};
+    return run_large(&job, n, sizeof(uint8_t), sizeof(uint16_t));
+}
+
+int imgCvtGrayInttoBF16_Large_into(size_t n, int *a, uint16_t *out) {
+    large_job_t job = {.piece = int_bf16_piece, .in = a, .out = out};
+    return run_large(&job, n, sizeof(int), sizeof(uint16_t));
+}
+
+int imgCvtGrayU8toBF16_Large_into(size_t n, uint8_t *a, uint16_t *out) {
+    large_job_t job = {.piece = u8_bf16_piece, .in = a, .out = out};
+    return run_large(&job, n, sizeof(uint8_t), sizeof(uint16_t));
+}
+
+// Inverse conversion
+int imgCvtGrayFloattoU8_Large_into(size_t n, float *a, uint8_t *out) {
+    large_job_t job = {.piece = to_u8_piece, .in = a, .out = out};
+    return run_large(&job, n, sizeof(float), sizeof(uint8_t));
+}
+
+int imgCvtGrayFloattoInt_Large_into(size_t n, float *a, int *out) {
+    large_job_t job = {.piece = to_int_piece, .in = a, .out = out};
+    return run_large(&job, n, sizeof(float), sizeof(int));
+}
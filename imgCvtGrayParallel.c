@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "imgCvtGray.h"
+#include "imgCvtGrayThread.h"
+
+// Multi-threaded driver for the conversion kernels.
+// A frame is split into bands of PARALLEL_BAND_PIXELS pixels (a multiple of
+// 16, so every band of a 64-byte aligned output starts on a cache line and
+// no two threads write the same line). Bands are handed out through an
+// atomic counter to a pool of persistent worker threads plus the calling
+// thread. The pool is created once by parallel_init and reused by every
+// call; one job runs at a time and calls from several threads are
+// serialized.
+
+static struct {
+    int num_threads;                    // Workers + the calling thread
+    int started;
+    thread_handle_t workers[PARALLEL_MAX_THREADS];
+    mutex_t lock;
+    mutex_t job_lock;                   // Serializes parallel_for callers
+    cond_t work_ready;
+    cond_t work_done;
+    int generation;                     // Bumped for every new job
+    int busy_workers;
+    int shutdown;
+
+    // Current job
+    band_fn_t fn;
+    void *ctx;
+    long long n;
+    long long band;
+    long num_bands;
+    volatile long next_band;
+} pool;
+
+// Number of logical CPUs
+int parallel_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// Run bands of the current job until none are left
+static void run_bands(void) {
+    for (;;) {
+        long b = atomic_next(&pool.next_band);
+        if (b >= pool.num_bands) {
+            break;
+        }
+        long long start = (long long)b * pool.band;
+        long long count = pool.n - start < pool.band ? pool.n - start : pool.band;
+        pool.fn(pool.ctx, start, count);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg)
+#else
+static void *worker_main(void *arg)
+#endif
+{
+    (void)arg;
+    int seen = 0;
+    mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen && !pool.shutdown) {
+            cond_wait(&pool.work_ready, &pool.lock);
+        }
+        if (pool.shutdown) {
+            break;
+        }
+        seen = pool.generation;
+        mutex_unlock(&pool.lock);
+
+        run_bands();
+
+        mutex_lock(&pool.lock);
+        if (--pool.busy_workers == 0) {
+            cond_signal(&pool.work_done);
+        }
+    }
+    mutex_unlock(&pool.lock);
+    return 0;
+}
+
+// Start the pool with num_threads threads in total (0 = IMGCVT_THREADS or
+// one per CPU). Restarts the pool if it is already running.
+// Returns the number of threads actually in use.
+int parallel_init(int num_threads) {
+    parallel_shutdown();
+
+    if (num_threads <= 0) {
+        const char *env = getenv("IMGCVT_THREADS");
+        num_threads = env != NULL ? atoi(env) : 0;
+    }
+    if (num_threads <= 0) {
+        num_threads = parallel_cpu_count();
+    }
+    if (num_threads > PARALLEL_MAX_THREADS) {
+        num_threads = PARALLEL_MAX_THREADS;
+    }
+
+    mutex_init(&pool.lock);
+    mutex_init(&pool.job_lock);
+    cond_init(&pool.work_ready);
+    cond_init(&pool.work_done);
+    pool.generation = 0;
+    pool.busy_workers = 0;
+    pool.shutdown = 0;
+    pool.num_threads = 1;
+    pool.started = 1;
+
+    // The calling thread is thread 0; start the other workers
+    for (int t = 1; t < num_threads; t++) {
+#ifdef _WIN32
+        pool.workers[t] = CreateThread(NULL, 0, worker_main, NULL, 0, NULL);
+        if (pool.workers[t] == NULL) {
+            break;
+        }
+#else
+        if (pthread_create(&pool.workers[t], NULL, worker_main, NULL) != 0) {
+            break;
+        }
+#endif
+        pool.num_threads++;
+    }
+    if (pool.num_threads < num_threads) {
+        fprintf(stderr, "parallel_init: started %d of %d threads\n", pool.num_threads, num_threads);
+    }
+    return pool.num_threads;
+}
+
+// Stop and join the worker threads
+void parallel_shutdown(void) {
+    if (!pool.started) {
+        return;
+    }
+    mutex_lock(&pool.lock);
+    pool.shutdown = 1;
+    cond_broadcast(&pool.work_ready);
+    mutex_unlock(&pool.lock);
+
+    for (int t = 1; t < pool.num_threads; t++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool.workers[t], INFINITE);
+        CloseHandle(pool.workers[t]);
+#else
+        pthread_join(pool.workers[t], NULL);
+#endif
+    }
+
+    cond_destroy(&pool.work_ready);
+    cond_destroy(&pool.work_done);
+    mutex_destroy(&pool.job_lock);
+    mutex_destroy(&pool.lock);
+    pool.started = 0;
+    pool.num_threads = 0;
+}
+
+// Threads used by parallel_for (1 if the pool has not been started)
+int parallel_num_threads(void) {
+    return pool.started ? pool.num_threads : 1;
+}
+
+// Call fn(ctx, start, count) over [0, n) in bands of band items, spread
+// across the pool. The items are whatever the caller counts (pixels,
+// frames, rows) and band is used as given: callers splitting pixels pass a
+// multiple of 16 to keep bands off each other's cache lines. Runs on the
+// calling thread alone if the pool is not started or n fits in one band.
+void parallel_for(long long n, long long band, band_fn_t fn, void *ctx) {
+    if (n <= 0) {
+        return;
+    }
+    if (band <= 0) {
+        band = 1;
+    }
+
+    if (!pool.started || pool.num_threads == 1 || n <= band) {
+        fn(ctx, 0, n);
+        return;
+    }
+
+    mutex_lock(&pool.job_lock);
+
+    mutex_lock(&pool.lock);
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.n = n;
+    pool.band = band;
+    pool.num_bands = (long)((n + band - 1) / band);
+    pool.next_band = 0;
+    pool.busy_workers = pool.num_threads - 1;
+    pool.generation++;
+    cond_broadcast(&pool.work_ready);
+    mutex_unlock(&pool.lock);
+
+    run_bands();
+
+    mutex_lock(&pool.lock);
+    while (pool.busy_workers > 0) {
+        cond_wait(&pool.work_done, &pool.lock);
+    }
+    mutex_unlock(&pool.lock);
+
+    mutex_unlock(&pool.job_lock);
+}
+
+// Band callbacks for the int and uint8_t kernels
+typedef struct {
+    void (*convert_into)(int n, int *a, float *out);
+    int *a;
+    float *out;
+} int_job_t;
+
+typedef struct {
+    void (*convert_into)(int n, uint8_t *a, float *out);
+    uint8_t *a;
+    float *out;
+} u8_job_t;
+
+typedef struct {
+    void (*convert_inplace)(int n, int *a);
+    int *a;
+} inplace_job_t;
+
+static void int_band(void *ctx, long long start, long long count) {
+    int_job_t *job = (int_job_t *)ctx;
+    job->convert_into((int)count, job->a + start, job->out + start);
+}
+
+static void u8_band(void *ctx, long long start, long long count) {
+    u8_job_t *job = (u8_job_t *)ctx;
+    job->convert_into((int)count, job->a + start, job->out + start);
+}
+
+static void inplace_band(void *ctx, long long start, long long count) {
+    inplace_job_t *job = (inplace_job_t *)ctx;
+    job->convert_inplace((int)count, job->a + start);
+}
+
+// Convert n pixels with the given kernel on the thread pool. Whether to use
+// streaming stores is decided on the whole frame, not the band size.
+void imgCvtGrayInttoFloat_Parallel_into(const kernel_t *kernel, int n, int *a, float *out) {
+    int_job_t job = {kernel->convert_into, a, out};
+    if (kernel->convert_into_nt != NULL && use_streaming_stores(n, sizeof(int))) {
+        job.convert_into = kernel->convert_into_nt;
+    }
+    parallel_for(n, PARALLEL_BAND_PIXELS, int_band, &job);
+}
+
+void imgCvtGrayU8toFloat_Parallel_into(const u8_kernel_t *kernel, int n, uint8_t *a, float *out) {
+    u8_job_t job = {kernel->convert_into, a, out};
+    if (kernel->convert_into_nt != NULL && use_streaming_stores(n, sizeof(uint8_t))) {
+        job.convert_into = kernel->convert_into_nt;
+    }
+    parallel_for(n, PARALLEL_BAND_PIXELS, u8_band, &job);
+}
+
+// In place on the thread pool. Bands never overlap, so each thread only
+// ever reads and writes its own pixels. Returns a, now holding floats.
+float* imgCvtGrayInttoFloat_Parallel_inplace(const kernel_t *kernel, int n, int *a) {
+    inplace_job_t job = {kernel->convert_inplace, a};
+    parallel_for(n, PARALLEL_BAND_PIXELS, inplace_band, &job);
+    return (float *)a;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "imgCvtGray.h"
+
+// perf_event_open counters around benchmark runs. Each event is opened
+// on its own rather than as one group, so a host that lacks some of them
+// (a VM without LLC events, a container that only allows software
+// events) still counts the rest. exclude_kernel keeps the counters usable
+// at perf_event_paranoid 2, the usual default.
+
+static const char *event_names[PERF_NUM_EVENTS] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "page_faults"
+};
+
+const char *perf_event_name(int event) {
+    return event >= 0 && event < PERF_NUM_EVENTS ? event_names[event] : "unknown";
+}
+
+#ifdef __linux__
+
+static int event_fds[PERF_NUM_EVENTS] = {-1, -1, -1, -1, -1, -1};
+static int opened = 0;
+static int available = 0;
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static int open_event(unsigned int type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Open every event this host allows, once
+int perf_open(void) {
+    if (opened) {
+        return available;
+    }
+    opened = 1;
+
+    const char *env = getenv("IMGCVT_PERF");
+    if (env != NULL && strcmp(env, "0") == 0) {
+        return available;
+    }
+
+    static const struct { unsigned int type; unsigned long long config; } events[PERF_NUM_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    };
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        event_fds[e] = open_event(events[e].type, events[e].config);
+        if (event_fds[e] >= 0) {
+            available |= 1 << e;
+        }
+    }
+    return available;
+}
+
+void perf_close(void) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (event_fds[e] >= 0) {
+            close(event_fds[e]);
+            event_fds[e] = -1;
+        }
+    }
+    available = 0;
+    opened = 0;
+}
+
+// Zero and start every open counter
+void perf_start(void) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (event_fds[e] >= 0) {
+            ioctl(event_fds[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(event_fds[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+// Stop the counters and read them. A counter the kernel had to multiplex
+// with other events is scaled up to the whole run; one that never ran is
+// left out of counts->valid.
+void perf_stop(perf_counts_t *counts) {
+    counts->valid = 0;
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        counts->count[e] = 0;
+        if (event_fds[e] < 0) {
+            continue;
+        }
+        ioctl(event_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+        unsigned long long values[3];   // value, time enabled, time running
+        if (read(event_fds[e], values, sizeof(values)) != (ssize_t)sizeof(values) || values[2] == 0) {
+            continue;
+        }
+        double scale = values[2] < values[1] ? (double)values[1] / (double)values[2] : 1.0;
+        counts->count[e] = (long long)(values[0] * scale);
+        counts->valid |= 1 << e;
+    }
+}
+
+#else
+
+int perf_open(void) {
+    return 0;
+}
+
+void perf_close(void) {
+}
+
+void perf_start(void) {
+}
+
+void perf_stop(perf_counts_t *counts) {
+    memset(counts, 0, sizeof(*counts));
+}
+
+#endif
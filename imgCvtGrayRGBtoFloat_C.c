@@ -0,0 +1,55 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// C implementation of the fused color-to-grayscale conversion
+// Reads interleaved RGB8 or RGBA8 pixels and writes normalized float luma
+// (0.0-1.0) in one pass, with no intermediate int luma frame. The weights
+// are 14-bit fixed point summing to LUMA_WEIGHT_ONE, so the weighted sum
+// is an exact integer and only the final division rounds:
+//   out = (float)(wr*R + wg*G + wb*B) / 255.0f * 2^-14
+// Alpha is ignored.
+
+// ITU-R BT.601 (0.299, 0.587, 0.114) and BT.709 (0.2126, 0.7152, 0.0722)
+const luma_weights_t luma_bt601 = {{4899, 9617, 1868, 0}};
+const luma_weights_t luma_bt709 = {{3483, 11718, 1183, 0}};
+
+// Build fixed-point weights from real ones. The weights are scaled to sum
+// to 1, rounded, and the largest absorbs the rounding error, so white
+// still maps to exactly 1.0. Returns 0, or -1 if a weight is negative or
+// all are zero.
+int make_luma_weights(double r, double g, double b, luma_weights_t *weights) {
+    double sum = r + g + b;
+    if (r < 0.0 || g < 0.0 || b < 0.0 || !(sum > 0.0)) {
+        return -1;
+    }
+    double real[3] = {r / sum, g / sum, b / sum};
+    int total = 0, largest = 0;
+    for (int c = 0; c < 3; c++) {
+        weights->w[c] = (int16_t)(real[c] * LUMA_WEIGHT_ONE + 0.5);
+        total += weights->w[c];
+        if (real[c] > real[largest]) largest = c;
+    }
+    weights->w[largest] = (int16_t)(weights->w[largest] + LUMA_WEIGHT_ONE - total);
+    weights->w[3] = 0;
+    return 0;
+}
+
+void imgCvtGrayRGBtoFloat_C_into(int n, uint8_t *rgb, float *out, const luma_weights_t *weights) {
+    int wr = weights->w[0], wg = weights->w[1], wb = weights->w[2];
+    for (int i = 0; i < n; i++) {
+        const uint8_t *p = rgb + (size_t)i * 3;
+        int y = wr * p[0] + wg * p[1] + wb * p[2];
+        out[i] = (float)y / 255.0f * (1.0f / LUMA_WEIGHT_ONE);
+    }
+}
+
+void imgCvtGrayRGBAtoFloat_C_into(int n, uint8_t *rgba, float *out, const luma_weights_t *weights) {
+    int wr = weights->w[0], wg = weights->w[1], wb = weights->w[2];
+    for (int i = 0; i < n; i++) {
+        const uint8_t *p = rgba + (size_t)i * 4;
+        int y = wr * p[0] + wg * p[1] + wb * p[2];
+        out[i] = (float)y / 255.0f * (1.0f / LUMA_WEIGHT_ONE);
+    }
+}
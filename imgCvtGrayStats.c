@@ -0,0 +1,257 @@
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "imgCvtGray.h"
+#include "imgCvtGrayThread.h"
+
+// Conversion with fused frame statistics. Scanning a converted frame for
+// its histogram and moments reads the whole float output back from
+// memory right after it was written. Here the frame is converted in
+// blocks of STATS_BLOCK_PIXELS by the dispatched kernel, and each block's
+// input is counted into the histogram while it is still in L1, so the
+// frame crosses the memory bus once.
+//
+// Inputs 0-255 convert to exactly (float)v / 255.0f, so counting input
+// levels is enough: min, max, sum and sum of squares all follow from the
+// 256 counts at the end. Counts go to STATS_LANES sub-histograms in turn,
+// so runs of equal pixels do not wait on each other's increments. A block
+// holding int values outside 0-255 takes a per-pixel path that uses the
+// converted floats for those pixels. Each band of the thread pool counts
+// into its own sub-histograms and merges them into the frame total once.
+
+#define STATS_BLOCK_PIXELS  2048    // 8 KB of int input, 8 KB of output
+#define STATS_BAND_PIXELS   (4 * PARALLEL_BAND_PIXELS)
+#define STATS_LANES         4
+
+typedef struct {
+    long long levels[GRAY_HIST_BINS];   // Pixels of each input level 0-255
+    long long below, above;             // int pixels under 0 / over 255
+    double extra_sum, extra_sum_sq;     // Their converted values
+    float extra_min, extra_max;
+} stats_acc_t;
+
+typedef struct {
+    void (*int_into)(int n, int *a, float *out);
+    void (*u8_into)(int n, uint8_t *a, float *out);
+    int *a;
+    uint8_t *a8;
+    float *out;
+    mutex_t lock;
+    stats_acc_t total;
+} stats_job_t;
+
+static void acc_clear(stats_acc_t *acc) {
+    memset(acc, 0, sizeof(*acc));
+    acc->extra_min = FLT_MAX;
+    acc->extra_max = -FLT_MAX;
+}
+
+// Nonzero if every value is 0-255 (no early exit, so the loop vectorizes)
+static int levels_in_range(const int *a, int n) {
+    unsigned int outside = 0;
+    for (int i = 0; i < n; i++) {
+        outside |= (unsigned int)a[i] > 255;
+    }
+    return !outside;
+}
+
+#define DEFINE_COUNT_LEVELS(name, in_type)                                      \
+static void name(uint32_t lanes[STATS_LANES][GRAY_HIST_BINS], const in_type *a, int n) { \
+    int i = 0;                                                                  \
+    for (; i + STATS_LANES <= n; i += STATS_LANES) {                            \
+        lanes[0][a[i]]++;                                                       \
+        lanes[1][a[i + 1]]++;                                                   \
+        lanes[2][a[i + 2]]++;                                                   \
+        lanes[3][a[i + 3]]++;                                                   \
+    }                                                                           \
+    for (; i < n; i++) {                                                        \
+        lanes[0][a[i]]++;                                                       \
+    }                                                                           \
+}
+
+DEFINE_COUNT_LEVELS(count_levels_int, int)
+DEFINE_COUNT_LEVELS(count_levels_u8, uint8_t)
+
+// A block with int values outside 0-255: those pixels are taken from out
+static void count_mixed(uint32_t lanes[STATS_LANES][GRAY_HIST_BINS], stats_acc_t *acc,
+                        const int *a, const float *out, int n) {
+    for (int i = 0; i < n; i++) {
+        if ((unsigned int)a[i] <= 255) {
+            lanes[0][a[i]]++;
+            continue;
+        }
+        float v = out[i];
+        if (a[i] < 0) acc->below++; else acc->above++;
+        acc->extra_sum += v;
+        acc->extra_sum_sq += (double)v * v;
+        if (v < acc->extra_min) acc->extra_min = v;
+        if (v > acc->extra_max) acc->extra_max = v;
+    }
+}
+
+static void stats_band(void *ctx, long long start, long long count) {
+    stats_job_t *job = (stats_job_t *)ctx;
+    uint32_t lanes[STATS_LANES][GRAY_HIST_BINS];
+    stats_acc_t acc;
+    memset(lanes, 0, sizeof(lanes));
+    acc_clear(&acc);
+
+    for (long long i = start; i < start + count; i += STATS_BLOCK_PIXELS) {
+        int m = start + count - i < STATS_BLOCK_PIXELS ? (int)(start + count - i) : STATS_BLOCK_PIXELS;
+        float *out = job->out + i;
+        if (job->a8 != NULL) {
+            job->u8_into(m, job->a8 + i, out);
+            count_levels_u8(lanes, job->a8 + i, m);
+        } else {
+            job->int_into(m, job->a + i, out);
+            if (levels_in_range(job->a + i, m)) {
+                count_levels_int(lanes, job->a + i, m);
+            } else {
+                count_mixed(lanes, &acc, job->a + i, out, m);
+            }
+        }
+    }
+
+    mutex_lock(&job->lock);
+    stats_acc_t *total = &job->total;
+    for (int v = 0; v < GRAY_HIST_BINS; v++) {
+        total->levels[v] += (long long)lanes[0][v] + lanes[1][v] + lanes[2][v] + lanes[3][v];
+    }
+    total->below += acc.below;
+    total->above += acc.above;
+    total->extra_sum += acc.extra_sum;
+    total->extra_sum_sq += acc.extra_sum_sq;
+    if (acc.extra_min < total->extra_min) total->extra_min = acc.extra_min;
+    if (acc.extra_max > total->extra_max) total->extra_max = acc.extra_max;
+    mutex_unlock(&job->lock);
+}
+
+// Frame statistics from the level counts and the out-of-range pixels
+static void stats_finish(const stats_acc_t *acc, long long n, gray_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->count = n;
+    if (n == 0) {
+        return;
+    }
+    float min = FLT_MAX, max = -FLT_MAX;
+    for (int v = 0; v < GRAY_HIST_BINS; v++) {
+        long long h = acc->levels[v];
+        if (h == 0) {
+            continue;
+        }
+        float value = (float)v / 255.0f;
+        if (value < min) min = value;
+        if (value > max) max = value;
+        stats->histogram[v] = h;
+        stats->sum += (double)h * value;
+        stats->sum_sq += (double)h * value * value;
+    }
+    stats->histogram[0] += acc->below;
+    stats->histogram[GRAY_HIST_BINS - 1] += acc->above;
+    if (acc->below + acc->above > 0) {
+        stats->sum += acc->extra_sum;
+        stats->sum_sq += acc->extra_sum_sq;
+        if (acc->extra_min < min) min = acc->extra_min;
+        if (acc->extra_max > max) max = acc->extra_max;
+    }
+    stats->min = min;
+    stats->max = max;
+}
+
+// Streaming stores are decided on the whole frame: the fused pass only
+// re-reads the input, never the output.
+static int run_stats(stats_job_t *job, int n, gray_stats_t *stats) {
+    if (n < 0 || stats == NULL || (n > 0 && (job->out == NULL || (job->a == NULL && job->a8 == NULL)))) {
+        return -1;
+    }
+    acc_clear(&job->total);
+    if (n > 0) {
+        mutex_init(&job->lock);
+        parallel_for(n, STATS_BAND_PIXELS, stats_band, job);
+        mutex_destroy(&job->lock);
+    }
+    stats_finish(&job->total, n, stats);
+    return 0;
+}
+
+// Convert like _Auto_into and fill stats. Returns 0, or -1 (nothing
+// converted) for n < 0 or a NULL array.
+int imgCvtGrayInttoFloat_Stats_into(int n, int *a, float *out, gray_stats_t *stats) {
+    const kernel_t *kernel = selected_kernel();
+    stats_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.int_into = kernel->convert_into_nt != NULL && use_streaming_stores(n, sizeof(int))
+                   ? kernel->convert_into_nt : kernel->convert_into;
+    job.a = a;
+    job.out = out;
+    return run_stats(&job, n, stats);
+}
+
+int imgCvtGrayU8toFloat_Stats_into(int n, uint8_t *a, float *out, gray_stats_t *stats) {
+    const u8_kernel_t *kernel = selected_u8_kernel();
+    stats_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.u8_into = kernel->convert_into_nt != NULL && use_streaming_stores(n, sizeof(uint8_t))
+                  ? kernel->convert_into_nt : kernel->convert_into;
+    job.a8 = a;
+    job.out = out;
+    return run_stats(&job, n, stats);
+}
+
+// Statistics of an already converted frame, in one scan of the floats.
+// A value goes to the bin of its nearest level, v * 255 rounded, with
+// values below 0 or above 1 in the first or last bin: for converted
+// frames this is the same histogram the fused versions count.
+int gray_stats_scan(int n, const float *a, gray_stats_t *stats) {
+    if (n < 0 || stats == NULL || (n > 0 && a == NULL)) {
+        return -1;
+    }
+    uint32_t lanes[STATS_LANES][GRAY_HIST_BINS];
+    long long totals[GRAY_HIST_BINS];
+    float min = FLT_MAX, max = -FLT_MAX;
+    double sum = 0.0, sum_sq = 0.0;
+    memset(totals, 0, sizeof(totals));
+    memset(stats, 0, sizeof(*stats));
+    stats->count = n;
+    if (n == 0) {
+        return 0;
+    }
+    for (int start = 0; start < n; start += STATS_BAND_PIXELS) {
+        int m = n - start < STATS_BAND_PIXELS ? n - start : STATS_BAND_PIXELS;
+        memset(lanes, 0, sizeof(lanes));
+        for (int i = start; i < start + m; i++) {
+            float v = a[i];
+            float level = v * 255.0f + 0.5f;
+            int bin = level < 0.0f ? 0 : level >= (float)GRAY_HIST_BINS ? GRAY_HIST_BINS - 1 : (int)level;
+            lanes[i & (STATS_LANES - 1)][bin]++;
+            if (v < min) min = v;
+            if (v > max) max = v;
+            sum += v;
+            sum_sq += (double)v * v;
+        }
+        for (int v = 0; v < GRAY_HIST_BINS; v++) {
+            totals[v] += (long long)lanes[0][v] + lanes[1][v] + lanes[2][v] + lanes[3][v];
+        }
+    }
+    memcpy(stats->histogram, totals, sizeof(totals));
+    stats->min = min;
+    stats->max = max;
+    stats->sum = sum;
+    stats->sum_sq = sum_sq;
+    return 0;
+}
+
+double gray_stats_mean(const gray_stats_t *stats) {
+    return stats->count > 0 ? stats->sum / stats->count : 0.0;
+}
+
+// Population variance
+double gray_stats_variance(const gray_stats_t *stats) {
+    if (stats->count <= 0) {
+        return 0.0;
+    }
+    double mean = stats->sum / stats->count;
+    double variance = stats->sum_sq / stats->count - mean * mean;
+    return variance > 0.0 ? variance : 0.0;
+}
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "imgCvtGray.h"
+#include "imgCvtGrayThread.h"
+
+// Streaming conversion for frames larger than memory.
+// Input is read in chunks of chunk_pixels samples into a ring of
+// STREAM_BUFFERS slots, each with its own input and float output buffer.
+// Three stages run concurrently on the ring:
+//   reader thread   fread a chunk into a free slot
+//   calling thread  convert a filled slot with the dispatched kernel (on
+//                   the thread pool if parallel_init was called)
+//   writer thread   fwrite a converted slot and hand it back to the reader
+// so reading chunk i+1, converting chunk i and writing chunk i-1 overlap.
+// Peak memory is STREAM_BUFFERS * chunk_pixels * (input bytes + 4),
+// whatever the size of the image.
+
+enum { SLOT_FREE, SLOT_FILLED, SLOT_CONVERTED };
+
+typedef struct {
+    void *in;
+    float *out;
+    int count;          // Samples in this chunk; 0 marks the end of input
+    int state;
+} stream_slot_t;
+
+typedef struct {
+    FILE *in_file;
+    FILE *out_file;
+    long long remaining;    // Samples still to read, -1 = until EOF
+    int input_bytes;
+    int chunk_pixels;
+    stream_slot_t slots[STREAM_BUFFERS];
+    mutex_t lock;
+    cond_t changed;         // Any slot changed state, or an error occurred
+    int error;
+    stream_stats_t *stats;
+} stream_t;
+
+// Wait until slot reaches state. Returns 0, or -1 if the stream failed.
+static int wait_slot(stream_t *s, stream_slot_t *slot, int state) {
+    mutex_lock(&s->lock);
+    while (slot->state != state && !s->error) {
+        cond_wait(&s->changed, &s->lock);
+    }
+    int failed = s->error;
+    mutex_unlock(&s->lock);
+    return failed ? -1 : 0;
+}
+
+static void set_slot(stream_t *s, stream_slot_t *slot, int count, int state) {
+    mutex_lock(&s->lock);
+    slot->count = count;
+    slot->state = state;
+    cond_broadcast(&s->changed);
+    mutex_unlock(&s->lock);
+}
+
+static void fail(stream_t *s, const char *message) {
+    mutex_lock(&s->lock);
+    if (!s->error) {
+        fprintf(stderr, "stream_convert: %s\n", message);
+        s->error = 1;
+    }
+    cond_broadcast(&s->changed);
+    mutex_unlock(&s->lock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI reader_main(LPVOID arg)
+#else
+static void *reader_main(void *arg)
+#endif
+{
+    stream_t *s = (stream_t *)arg;
+    for (long long seq = 0; ; seq++) {
+        stream_slot_t *slot = &s->slots[seq % STREAM_BUFFERS];
+        if (wait_slot(s, slot, SLOT_FREE) != 0) {
+            break;
+        }
+
+        int want = s->chunk_pixels;
+        if (s->remaining >= 0 && s->remaining < want) {
+            want = (int)s->remaining;
+        }
+        // Read bytes rather than samples, so a partial sample at the end
+        // of the input is seen instead of silently dropped
+        double start_time = get_time();
+        size_t bytes = want > 0 ? fread(slot->in, 1, (size_t)want * s->input_bytes, s->in_file) : 0;
+        s->stats->read_seconds += get_time() - start_time;
+        int count = (int)(bytes / (size_t)s->input_bytes);
+
+        if (bytes % (size_t)s->input_bytes != 0 && !ferror(s->in_file)) {
+            fail(s, "input ends partway through a sample");
+            break;
+        }
+        if (count < want && (ferror(s->in_file) || s->remaining >= 0)) {
+            fail(s, ferror(s->in_file) ? "read error" : "input ended early");
+            break;
+        }
+        if (s->remaining >= 0) {
+            s->remaining -= count;
+        }
+        set_slot(s, slot, count, SLOT_FILLED);
+        if (count == 0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI writer_main(LPVOID arg)
+#else
+static void *writer_main(void *arg)
+#endif
+{
+    stream_t *s = (stream_t *)arg;
+    for (long long seq = 0; ; seq++) {
+        stream_slot_t *slot = &s->slots[seq % STREAM_BUFFERS];
+        if (wait_slot(s, slot, SLOT_CONVERTED) != 0 || slot->count == 0) {
+            break;
+        }
+
+        double start_time = get_time();
+        size_t written = fwrite(slot->out, sizeof(float), (size_t)slot->count, s->out_file);
+        s->stats->write_seconds += get_time() - start_time;
+        if (written != (size_t)slot->count) {
+            fail(s, "write error");
+            break;
+        }
+        s->stats->pixels += slot->count;
+        set_slot(s, slot, 0, SLOT_FREE);
+    }
+    return 0;
+}
+
+static int start_thread(thread_handle_t *thread,
+#ifdef _WIN32
+                        DWORD (WINAPI *fn)(LPVOID),
+#else
+                        void *(*fn)(void *),
+#endif
+                        void *arg) {
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    return *thread != NULL ? 0 : -1;
+#else
+    return pthread_create(thread, NULL, fn, arg) == 0 ? 0 : -1;
+#endif
+}
+
+static void join_thread(thread_handle_t thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+// Convert num_pixels samples (-1 = until end of input) from in_file to
+// float32 samples in out_file. input_bytes is 1 for uint8_t samples or 4
+// for native-order int samples. chunk_pixels <= 0 selects
+// STREAM_CHUNK_PIXELS. Statistics go to stats (may be NULL).
+// Returns 0 on success, -1 on a read/write error, short input, input
+// that ends partway through an int sample or allocation failure (then
+// stats->buffer_bytes is 0).
+int stream_convert(FILE *in_file, FILE *out_file, long long num_pixels,
+                   int input_bytes, int chunk_pixels, stream_stats_t *stats) {
+    stream_stats_t local_stats;
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (input_bytes != 1 && input_bytes != 4) {
+        return -1;
+    }
+    if (chunk_pixels <= 0) {
+        chunk_pixels = STREAM_CHUNK_PIXELS;
+    }
+    chunk_pixels = (chunk_pixels + 15) & ~15;  // Whole cache lines of output
+
+    stream_t s;
+    memset(&s, 0, sizeof(s));
+    s.in_file = in_file;
+    s.out_file = out_file;
+    s.remaining = num_pixels;
+    s.input_bytes = input_bytes;
+    s.chunk_pixels = chunk_pixels;
+    s.stats = stats;
+
+    int result = 0;
+    for (int k = 0; k < STREAM_BUFFERS; k++) {
+        s.slots[k].in = malloc((size_t)chunk_pixels * input_bytes);
+        s.slots[k].out = alloc_float_buffer(chunk_pixels);
+        if (s.slots[k].in == NULL || s.slots[k].out == NULL) {
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        stats->buffer_bytes = (long long)STREAM_BUFFERS * chunk_pixels * (input_bytes + (int)sizeof(float));
+    }
+
+    const kernel_t *kernel = selected_kernel();
+    const u8_kernel_t *u8_kernel = selected_u8_kernel();
+    double start_time = get_time();
+
+    thread_handle_t reader, writer;
+    int have_reader = 0, have_writer = 0;
+    if (result == 0) {
+        mutex_init(&s.lock);
+        cond_init(&s.changed);
+        have_reader = start_thread(&reader, reader_main, &s) == 0;
+        have_writer = have_reader && start_thread(&writer, writer_main, &s) == 0;
+        if (!have_reader || !have_writer) {
+            fail(&s, "cannot start threads");
+        }
+
+        // Convert stage
+        for (long long seq = 0; have_writer; seq++) {
+            stream_slot_t *slot = &s.slots[seq % STREAM_BUFFERS];
+            if (wait_slot(&s, slot, SLOT_FILLED) != 0) {
+                break;
+            }
+            // Once the slot is handed to the writer it may be freed and
+            // refilled at any time, so only the local count is used after
+            int count = slot->count;
+            if (count > 0) {
+                double convert_start = get_time();
+                if (input_bytes == 1) {
+                    imgCvtGrayU8toFloat_Parallel_into(u8_kernel, count, (uint8_t *)slot->in, slot->out);
+                } else {
+                    imgCvtGrayInttoFloat_Parallel_into(kernel, count, (int *)slot->in, slot->out);
+                }
+                stats->convert_seconds += get_time() - convert_start;
+            }
+            set_slot(&s, slot, count, SLOT_CONVERTED);
+            if (count == 0) {
+                break;  // End of input passed on to the writer
+            }
+        }
+
+        if (have_reader) join_thread(reader);
+        if (have_writer) join_thread(writer);
+        cond_destroy(&s.changed);
+        mutex_destroy(&s.lock);
+        result = s.error ? -1 : 0;
+    }
+    stats->total_seconds = get_time() - start_time;
+
+    for (int k = 0; k < STREAM_BUFFERS; k++) {
+        free(s.slots[k].in);
+        free_float_buffer(s.slots[k].out);
+    }
+    return result;
+}
@@ -0,0 +1,167 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// 2D conversion with a row stride on each side, for crops and for frames
+// in padded capture buffers, without first copying them into a dense
+// array. Each row is one call to the dispatched kernel, so the vector loop
+// runs along the row; with parallel_init the rows are shared out across
+// the pool in groups of about PARALLEL_BAND_PIXELS pixels. When both
+// strides equal the width the rows are back to back, and the frame goes
+// through the _Parallel_into drivers as one dense array instead.
+
+typedef struct {
+    int width;
+    const uint8_t *in;          // First pixel of the first row
+    float *out;
+    size_t in_pitch;            // Bytes from one row to the next
+    size_t out_stride;          // Floats from one row to the next
+    void (*int_into)(int n, int *a, float *out);
+    void (*u8_into)(int n, uint8_t *a, float *out);
+} rows_job_t;
+
+// Convert rows [start, start + count)
+static void rows_band(void *ctx, long long start, long long count) {
+    const rows_job_t *job = (const rows_job_t *)ctx;
+    for (long long y = start; y < start + count; y++) {
+        const uint8_t *in = job->in + (size_t)y * job->in_pitch;
+        float *out = job->out + (size_t)y * job->out_stride;
+        if (job->int_into != NULL) {
+            job->int_into(job->width, (int *)in, out);
+        } else {
+            job->u8_into(job->width, (uint8_t *)in, out);
+        }
+    }
+}
+
+// Both strides hold a whole row, and every row is addressable
+static int rows_valid(int width, int height, const void *in, int in_stride, size_t in_bytes,
+                      const float *out, int out_stride) {
+    size_t extent;
+    if (width < 0 || height < 0 || in_stride < width || out_stride < width) {
+        return 0;
+    }
+    if (width == 0 || height == 0) {
+        return 1;
+    }
+    return in != NULL && out != NULL &&
+           size_mul_checked((size_t)height, (size_t)in_stride, &extent) == 0 &&
+           size_mul_checked(extent, in_bytes, &extent) == 0 &&
+           size_mul_checked((size_t)height, (size_t)out_stride, &extent) == 0 &&
+           size_mul_checked(extent, sizeof(float), &extent) == 0;
+}
+
+// Rows on the pool, about PARALLEL_BAND_PIXELS pixels per band. The band
+// is a row count (a row wider than a band gets one to itself); rows start
+// wherever the strides put them, so it is not rounded to cache lines.
+static void run_rows(rows_job_t *job, int height, int in_stride, int out_stride, size_t in_bytes) {
+    job->in_pitch = (size_t)in_stride * in_bytes;
+    job->out_stride = (size_t)out_stride;
+    long long band_rows = PARALLEL_BAND_PIXELS / job->width;
+    parallel_for(height, band_rows > 0 ? band_rows : 1, rows_band, job);
+}
+
+// in_stride and out_stride count pixels, not bytes. Streaming stores are
+// decided on the pixels written, as for a dense frame. Returns 0, or -1
+// (nothing converted) for a negative size, a stride shorter than a row,
+// a NULL array or a frame whose extent overflows.
+int imgCvtGrayInttoFloat_2D_into(int width, int height, int *in, int in_stride, float *out, int out_stride) {
+    if (!rows_valid(width, height, in, in_stride, sizeof(int), out, out_stride)) {
+        return -1;
+    }
+    if (width == 0 || height == 0) {
+        return 0;
+    }
+    const kernel_t *kernel = selected_kernel();
+    long long pixels = (long long)width * height;
+    if (in_stride == width && out_stride == width && pixels <= INT_MAX) {
+        imgCvtGrayInttoFloat_Parallel_into(kernel, (int)pixels, in, out);
+        return 0;
+    }
+    rows_job_t job = {.width = width, .in = (const uint8_t *)in, .out = out, .int_into = kernel->convert_into};
+    if (kernel->convert_into_nt != NULL && use_streaming_stores(pixels, sizeof(int))) {
+        job.int_into = kernel->convert_into_nt;
+    }
+    run_rows(&job, height, in_stride, out_stride, sizeof(int));
+    return 0;
+}
+
+int imgCvtGrayU8toFloat_2D_into(int width, int height, uint8_t *in, int in_stride, float *out, int out_stride) {
+    if (!rows_valid(width, height, in, in_stride, sizeof(uint8_t), out, out_stride)) {
+        return -1;
+    }
+    if (width == 0 || height == 0) {
+        return 0;
+    }
+    const u8_kernel_t *kernel = selected_u8_kernel();
+    long long pixels = (long long)width * height;
+    if (in_stride == width && out_stride == width && pixels <= INT_MAX) {
+        imgCvtGrayU8toFloat_Parallel_into(kernel, (int)pixels, in, out);
+        return 0;
+    }
+    rows_job_t job = {.width = width, .in = in, .out = out, .u8_into = kernel->convert_into};
+    if (kernel->convert_into_nt != NULL && use_streaming_stores(pixels, sizeof(uint8_t))) {
+        job.u8_into = kernel->convert_into_nt;
+    }
+    run_rows(&job, height, in_stride, out_stride, sizeof(uint8_t));
+    return 0;
+}
+
+// The rectangle lies inside a frame_width x frame_height image
+static int roi_inside(const gray_roi_t *roi, int frame_width, int frame_height) {
+    return roi != NULL && roi->x >= 0 && roi->y >= 0 && roi->width >= 0 && roi->height >= 0 &&
+           roi->x <= frame_width - roi->width && roi->y <= frame_height - roi->height;
+}
+
+// The roi rectangle of a frame_width x frame_height image (in_stride
+// pixels per row), converted into out: roi->width floats per row,
+// out_stride apart. -1 if the rectangle is not inside the image, or for
+// the same reasons as _2D_into.
+int imgCvtGrayInttoFloat_ROI_into(int *in, int frame_width, int frame_height, int in_stride,
+                                  const gray_roi_t *roi, float *out, int out_stride) {
+    if (!roi_inside(roi, frame_width, frame_height) || in_stride < frame_width || in == NULL) {
+        return -1;
+    }
+    return imgCvtGrayInttoFloat_2D_into(roi->width, roi->height,
+                                        in + (size_t)roi->y * in_stride + roi->x, in_stride, out, out_stride);
+}
+
+int imgCvtGrayU8toFloat_ROI_into(uint8_t *in, int frame_width, int frame_height, int in_stride,
+                                 const gray_roi_t *roi, float *out, int out_stride) {
+    if (!roi_inside(roi, frame_width, frame_height) || in_stride < frame_width || in == NULL) {
+        return -1;
+    }
+    return imgCvtGrayU8toFloat_2D_into(roi->width, roi->height,
+                                       in + (size_t)roi->y * in_stride + roi->x, in_stride, out, out_stride);
+}
+
+// Allocating ROI versions: a dense roi->width x roi->height result from
+// alloc_float_buffer, released with free_float_buffer. NULL for an empty
+// or invalid rectangle or a failed allocation.
+float* imgCvtGrayInttoFloat_ROI(int *in, int frame_width, int frame_height, int in_stride, const gray_roi_t *roi) {
+    if (!roi_inside(roi, frame_width, frame_height) || (long long)roi->width * roi->height > INT_MAX) {
+        return NULL;
+    }
+    float *out = alloc_float_buffer(roi->width * roi->height);
+    if (out != NULL && imgCvtGrayInttoFloat_ROI_into(in, frame_width, frame_height, in_stride,
+                                                     roi, out, roi->width) != 0) {
+        free_float_buffer(out);
+        out = NULL;
+    }
+    return out;
+}
+
+float* imgCvtGrayU8toFloat_ROI(uint8_t *in, int frame_width, int frame_height, int in_stride, const gray_roi_t *roi) {
+    if (!roi_inside(roi, frame_width, frame_height) || (long long)roi->width * roi->height > INT_MAX) {
+        return NULL;
+    }
+    float *out = alloc_float_buffer(roi->width * roi->height);
+    if (out != NULL && imgCvtGrayU8toFloat_ROI_into(in, frame_width, frame_height, in_stride,
+                                                    roi, out, roi->width) != 0) {
+        free_float_buffer(out);
+        out = NULL;
+    }
+    return out;
+}
@@ -0,0 +1,58 @@
+#ifndef IMGCVTGRAYTHREAD_H
+#define IMGCVTGRAYTHREAD_H
+
+// Thin wrappers over Win32 threads and pthreads, shared by the thread pool
+// (imgCvtGrayParallel.c), the streaming pipeline (imgCvtGrayStream.c) and
+// the one-time kernel dispatch (imgCvtGrayDispatch.c).
+// Internal to the library; not part of the imgCvtGray.h API.
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE thread_handle_t;
+typedef CRITICAL_SECTION mutex_t;
+typedef CONDITION_VARIABLE cond_t;
+#define mutex_init(m)       InitializeCriticalSection(m)
+#define mutex_destroy(m)    DeleteCriticalSection(m)
+#define mutex_lock(m)       EnterCriticalSection(m)
+#define mutex_unlock(m)     LeaveCriticalSection(m)
+#define cond_init(c)        InitializeConditionVariable(c)
+#define cond_destroy(c)     ((void)0)
+#define cond_wait(c, m)     SleepConditionVariableCS(c, m, INFINITE)
+#define cond_broadcast(c)   WakeAllConditionVariable(c)
+#define cond_signal(c)      WakeConditionVariable(c)
+#define atomic_next(p)      (InterlockedIncrement(p) - 1)
+
+// run_once(once, fn): fn() runs exactly once; every caller returns after it
+typedef INIT_ONCE once_t;
+#define ONCE_INIT           INIT_ONCE_STATIC_INIT
+static inline BOOL CALLBACK once_call(PINIT_ONCE once, PVOID fn, PVOID *context) {
+    (void)once;
+    (void)context;
+    ((void (*)(void))fn)();
+    return TRUE;
+}
+#define run_once(o, fn)     InitOnceExecuteOnce(o, once_call, (PVOID)(fn), NULL)
+#else
+#include <pthread.h>
+
+typedef pthread_t thread_handle_t;
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t cond_t;
+#define mutex_init(m)       pthread_mutex_init(m, NULL)
+#define mutex_destroy(m)    pthread_mutex_destroy(m)
+#define mutex_lock(m)       pthread_mutex_lock(m)
+#define mutex_unlock(m)     pthread_mutex_unlock(m)
+#define cond_init(c)        pthread_cond_init(c, NULL)
+#define cond_destroy(c)     pthread_cond_destroy(c)
+#define cond_wait(c, m)     pthread_cond_wait(c, m)
+#define cond_broadcast(c)   pthread_cond_broadcast(c)
+#define cond_signal(c)      pthread_cond_signal(c)
+#define atomic_next(p)      __atomic_fetch_add(p, 1, __ATOMIC_RELAXED)
+
+typedef pthread_once_t once_t;
+#define ONCE_INIT           PTHREAD_ONCE_INIT
+#define run_once(o, fn)     pthread_once(o, fn)
+#endif
+
+#endif
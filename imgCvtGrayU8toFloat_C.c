@@ -0,0 +1,27 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "imgCvtGray.h"
+
+// C implementation of the grayscale conversion for 8-bit input
+// Reads uint8_t pixel values (0-255), one byte per pixel, and writes
+// float pixel values (0.0-1.0) by dividing each value by 255.0
+void imgCvtGrayU8toFloat_C_into(int n, uint8_t *a, float *out) {
+    AFFINE_LOOP(n, a, out, 255.0f, 0.0f, 1.0f)
+}
+
+// Allocating version: returns a malloc'd array of n floats
+float* imgCvtGrayU8toFloat_C(int n, uint8_t *a) {
+    if (n <= 0 || a == NULL) {
+        return NULL;
+    }
+    
+    float *float_array = (float *)malloc(n * sizeof(float));
+    if (float_array == NULL) {
+        return NULL;
+    }
+    
+    imgCvtGrayU8toFloat_C_into(n, a, float_array);
+    
+    return float_array;
+}
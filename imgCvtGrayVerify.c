@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <string.h>
+#include <emmintrin.h>
+
+#include "imgCvtGray.h"
+
+// Exact verification of converted frames.
+// Every value is compared with its reference by bit pattern, and the
+// difference is measured in units in the last place: float bit patterns
+// are mapped to integers that count up through adjacent floats (negative
+// values flipped, -0 just below +0), so the distance is one subtraction.
+// The reference for integer input is (float)v / 255.0f, computed with
+// divps, which rounds exactly as the C division does.
+//
+// The loop is SSE2 (the x86-64 baseline, so it needs no dispatch) and has
+// no early exit: every value is checked and counted. Differences are
+// OR-ed together per block of VERIFY_BLOCK values, and only a block that
+// holds the first mismatch is scanned again to find its index.
+
+#define VERIFY_BLOCK 64
+
+// Integer that orders float bit patterns
+static inline __m128i ordered_bits4(__m128 x) {
+    __m128i bits = _mm_castps_si128(x);
+    __m128i sign = _mm_srai_epi32(bits, 31);
+    return _mm_xor_si128(bits, _mm_srli_epi32(sign, 1));
+}
+
+static inline int32_t ordered_bits(float x) {
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits ^ (int32_t)((uint32_t)(bits >> 31) >> 1);
+}
+
+// |x - y| in ULP, as an unsigned 32-bit count per lane
+static inline __m128i ulp_distance4(__m128 x, __m128 y) {
+    __m128i a = ordered_bits4(x);
+    __m128i b = ordered_bits4(y);
+    __m128i swap = _mm_cmpgt_epi32(b, a);
+    __m128i diff = _mm_sub_epi32(a, b);
+    return _mm_sub_epi32(_mm_xor_si128(diff, swap), swap);
+}
+
+unsigned int float_ulp_distance(float x, float y) {
+    int32_t a = ordered_bits(x), b = ordered_bits(y);
+    return a > b ? (uint32_t)a - (uint32_t)b : (uint32_t)b - (uint32_t)a;
+}
+
+// Unsigned per-lane maximum (SSE2 only has signed compares)
+static inline __m128i max_epu32(__m128i x, __m128i y) {
+    __m128i bias = _mm_set1_epi32((int)0x80000000u);
+    __m128i greater = _mm_cmpgt_epi32(_mm_xor_si128(x, bias), _mm_xor_si128(y, bias));
+    return _mm_or_si128(_mm_and_si128(greater, x), _mm_andnot_si128(greater, y));
+}
+
+// Reference values, 4 at a time and one at a time
+static inline __m128 expected_int4(const int *a) {
+    __m128i v = _mm_loadu_si128((const __m128i *)a);
+    return _mm_div_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(255.0f));
+}
+
+static inline __m128 expected_u84(const uint8_t *a) {
+    int32_t packed;
+    memcpy(&packed, a, sizeof(packed));
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+    return _mm_div_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(255.0f));
+}
+
+static inline __m128 expected_float4(const float *a) {
+    return _mm_loadu_ps(a);
+}
+
+static inline float expected_int(const int *a) {
+    return (float)*a / 255.0f;
+}
+
+static inline float expected_u8(const uint8_t *a) {
+    return (float)*a / 255.0f;
+}
+
+static inline float expected_float(const float *a) {
+    return *a;
+}
+
+static void store_result(verify_result_t *result, int n, long long equal, __m128i max4,
+                         unsigned int tail_max, long long first, float expected, float actual) {
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, max4);
+    unsigned int max_ulp = tail_max;
+    for (int l = 0; l < 4; l++) {
+        if (lanes[l] > max_ulp) max_ulp = lanes[l];
+    }
+    result->checked = n;
+    result->mismatches = n - equal;
+    result->first_mismatch = first;
+    result->expected = first >= 0 ? expected : 0.0f;
+    result->actual = first >= 0 ? actual : 0.0f;
+    result->max_ulp = max_ulp;
+}
+
+// One verifier per reference type. ref points at the input pixels (or the
+// expected floats); out is the array under test.
+#define DEFINE_VERIFY(name, ref_type, expected4, expected1)                     \
+long long name(int n, const ref_type *ref, const float *out, verify_result_t *result) { \
+    verify_result_t local;                                                      \
+    __m128i max4 = _mm_setzero_si128();                                         \
+    __m128i equal4 = _mm_setzero_si128();                                       \
+    long long equal = 0, first = -1;                                            \
+    unsigned int tail_max = 0;                                                  \
+    float first_expected = 0.0f, first_actual = 0.0f;                           \
+    if (n < 0) n = 0;                                                           \
+    int i = 0;                                                                  \
+    for (; i + VERIFY_BLOCK <= n; i += VERIFY_BLOCK) {                          \
+        __m128i block = _mm_setzero_si128();                                    \
+        for (int j = i; j < i + VERIFY_BLOCK; j += 4) {                         \
+            __m128i d = ulp_distance4(expected4(ref + j), _mm_loadu_ps(out + j)); \
+            max4 = max_epu32(max4, d);                                          \
+            equal4 = _mm_sub_epi32(equal4, _mm_cmpeq_epi32(d, _mm_setzero_si128())); \
+            block = _mm_or_si128(block, d);                                     \
+        }                                                                       \
+        if (first < 0 && _mm_movemask_epi8(_mm_cmpeq_epi32(block, _mm_setzero_si128())) != 0xFFFF) { \
+            for (int j = i; j < i + VERIFY_BLOCK; j++) {                        \
+                float e = expected1(ref + j);                                   \
+                if (float_ulp_distance(e, out[j]) != 0) {                       \
+                    first = j;                                                  \
+                    first_expected = e;                                         \
+                    first_actual = out[j];                                      \
+                    break;                                                      \
+                }                                                               \
+            }                                                                   \
+        }                                                                       \
+    }                                                                           \
+    for (; i < n; i++) {                                                        \
+        float e = expected1(ref + i);                                           \
+        unsigned int d = float_ulp_distance(e, out[i]);                         \
+        if (d > tail_max) tail_max = d;                                         \
+        if (d == 0) {                                                           \
+            equal++;                                                            \
+        } else if (first < 0) {                                                 \
+            first = i;                                                          \
+            first_expected = e;                                                 \
+            first_actual = out[i];                                              \
+        }                                                                       \
+    }                                                                           \
+    int32_t lanes[4];                                                           \
+    _mm_storeu_si128((__m128i *)lanes, equal4);                                 \
+    equal += (long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];              \
+    if (result == NULL) result = &local;                                        \
+    store_result(result, n, equal, max4, tail_max, first, first_expected, first_actual); \
+    return result->mismatches;                                                  \
+}
+
+DEFINE_VERIFY(verify_int_to_float, int, expected_int4, expected_int)
+DEFINE_VERIFY(verify_u8_to_float, uint8_t, expected_u84, expected_u8)
+DEFINE_VERIFY(verify_floats, float, expected_float4, expected_float)
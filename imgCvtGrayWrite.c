@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "imgCvtGray.h"
+
+// Output writers for converted frames.
+// The text writers produce the same text as the per-pixel
+// fprintf("%.2f ") / fprintf("%d ") loops they replace, but format into a
+// local buffer and hand it to stdio in large blocks. The binary writer
+// stores the raw float32 values behind a 12-byte header:
+//   bytes 0-3   magic "GRF1"
+//   bytes 4-7   height, uint32 little-endian
+//   bytes 8-11  width, uint32 little-endian
+//   bytes 12-   height * width float32 values, little-endian, row-major
+// write_float_pfm writes the standard Portable Float Map format instead.
+
+#define WRITE_BUFFER_SIZE  65536
+#define MAX_FIELD          48       // Longest formatted value plus separator
+
+typedef struct {
+    FILE *file;
+    size_t len;
+    int failed;
+    char buf[WRITE_BUFFER_SIZE];
+} text_buffer_t;
+
+static void flush_buffer(text_buffer_t *out) {
+    if (out->len > 0 && fwrite(out->buf, 1, out->len, out->file) != out->len) {
+        out->failed = 1;
+    }
+    out->len = 0;
+}
+
+// Make room for one more field
+static char *reserve(text_buffer_t *out) {
+    if (out->len + MAX_FIELD > WRITE_BUFFER_SIZE) {
+        flush_buffer(out);
+    }
+    return out->buf + out->len;
+}
+
+// Unsigned decimal digits of v, written backwards ending at end.
+// Returns a pointer to the first digit.
+static char *put_digits(char *end, unsigned long long v) {
+    do {
+        *--end = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    return end;
+}
+
+// Append "%d " for v
+static void put_int(text_buffer_t *out, int v) {
+    char digits[16];
+    char *dst = reserve(out);
+    unsigned long long magnitude = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    char *first = put_digits(digits + sizeof(digits), magnitude);
+    size_t count = (size_t)(digits + sizeof(digits) - first);
+
+    size_t len = 0;
+    if (v < 0) dst[len++] = '-';
+    memcpy(dst + len, first, count);
+    len += count;
+    dst[len++] = ' ';
+    out->len += len;
+}
+
+// Append "%.2f " for v. f * 100 is exact in double (24 + 7 bits), so
+// rounding it to the nearest integer, ties to even, gives the same digits
+// as printf. Values too large for the fast path, infinities and NaN go
+// through snprintf.
+static void put_fixed2(text_buffer_t *out, float v) {
+    char *dst = reserve(out);
+    double scaled = fabs((double)v * 100.0);
+    if (!(scaled < 1e15)) {
+        out->len += (size_t)snprintf(dst, MAX_FIELD, "%.2f ", v);
+        return;
+    }
+
+    unsigned long long q = (unsigned long long)scaled;
+    double frac = scaled - (double)q;
+    if (frac > 0.5 || (frac == 0.5 && (q & 1))) {
+        q++;
+    }
+
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *first = put_digits(end - 2, q / 100);
+    end[-2] = (char)('0' + q / 10 % 10);
+    end[-1] = (char)('0' + q % 10);
+
+    size_t len = 0;
+    if (signbit(v)) dst[len++] = '-';       // printf keeps the sign of -0.00
+    size_t count = (size_t)(end - 2 - first);
+    memcpy(dst + len, first, count);
+    len += count;
+    dst[len++] = '.';
+    dst[len++] = end[-2];
+    dst[len++] = end[-1];
+    dst[len++] = ' ';
+    out->len += len;
+}
+
+static void put_newline(text_buffer_t *out) {
+    *reserve(out) = '\n';
+    out->len++;
+}
+
+// Write height rows of width "%.2f " values, one row per line.
+// Returns 0 on success, -1 if a write failed.
+int write_float_text(FILE *file, const float *data, int height, int width) {
+    text_buffer_t out;
+    out.file = file;
+    out.len = 0;
+    out.failed = 0;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            put_fixed2(&out, data[(size_t)i * width + j]);
+        }
+        put_newline(&out);
+    }
+    flush_buffer(&out);
+    return out.failed ? -1 : 0;
+}
+
+// Write height rows of width "%d " values, one row per line.
+// Returns 0 on success, -1 if a write failed.
+int write_int_text(FILE *file, const int *data, int height, int width) {
+    text_buffer_t out;
+    out.file = file;
+    out.len = 0;
+    out.failed = 0;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            put_int(&out, data[(size_t)i * width + j]);
+        }
+        put_newline(&out);
+    }
+    flush_buffer(&out);
+    return out.failed ? -1 : 0;
+}
+
+static void put_u32_le(unsigned char *dst, uint32_t v) {
+    dst[0] = (unsigned char)v;
+    dst[1] = (unsigned char)(v >> 8);
+    dst[2] = (unsigned char)(v >> 16);
+    dst[3] = (unsigned char)(v >> 24);
+}
+
+// Write just the 12-byte GRF1 header; the caller streams the pixels.
+// Returns 0 on success, -1 if the write failed.
+int write_float_binary_header(FILE *file, int height, int width) {
+    unsigned char header[12];
+    memcpy(header, GRAY_BINARY_MAGIC, 4);
+    put_u32_le(header + 4, (uint32_t)height);
+    put_u32_le(header + 8, (uint32_t)width);
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header) ? 0 : -1;
+}
+
+// Write a frame in the GRF1 binary format. The file must be opened in
+// binary mode ("wb"). Returns 0 on success, -1 if a write failed.
+int write_float_binary(FILE *file, const float *data, int height, int width) {
+    if (write_float_binary_header(file, height, width) != 0) {
+        return -1;
+    }
+
+    size_t count = (size_t)height * (size_t)width;
+    const uint32_t one = 1;
+    if (*(const unsigned char *)&one == 1) {
+        // Little-endian host: the floats are already in file order
+        return fwrite(data, sizeof(float), count, file) == count ? 0 : -1;
+    }
+
+    // Big-endian host: byte-swap through a small buffer
+    unsigned char buf[4096];
+    size_t done = 0;
+    while (done < count) {
+        size_t chunk = count - done < sizeof(buf) / 4 ? count - done : sizeof(buf) / 4;
+        for (size_t i = 0; i < chunk; i++) {
+            uint32_t bits;
+            memcpy(&bits, &data[done + i], 4);
+            put_u32_le(buf + i * 4, bits);
+        }
+        if (fwrite(buf, 4, chunk, file) != chunk) {
+            return -1;
+        }
+        done += chunk;
+    }
+    return 0;
+}
+
+// Write a Portable Float Map: "Pf" (1 channel) or "PF" (3 channels,
+// interleaved RGB), then native-order float32 rows from bottom to top as
+// the format requires. The negative scale marks little-endian data.
+// The file must be opened in binary mode. Returns 0 on success, -1 if a
+// write failed or channels is not 1 or 3.
+int write_float_pfm(FILE *file, const float *data, int height, int width, int channels) {
+    if (channels != 1 && channels != 3) {
+        return -1;
+    }
+    const uint32_t one = 1;
+    int little_endian = *(const unsigned char *)&one == 1;
+    if (fprintf(file, "%s\n%d %d\n%s\n", channels == 1 ? "Pf" : "PF", width, height,
+                little_endian ? "-1.0" : "1.0") < 0) {
+        return -1;
+    }
+
+    size_t row = (size_t)width * channels;
+    for (int i = height - 1; i >= 0; i--) {
+        if (fwrite(data + (size_t)i * row, sizeof(float), row, file) != row) {
+            return -1;
+        }
+    }
+    return 0;
+}
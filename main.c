@@ -1,45 +1,35 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
+#include <fcntl.h>
 #endif
 
-extern float* imgCvtGrayInttoFloat(int n, int *a);
+#include "imgCvtGray.h"
 
-// High-resolution timer function
-double get_time() {
-#ifdef _WIN32
-    LARGE_INTEGER frequency, counter;
-    QueryPerformanceFrequency(&frequency);
-    QueryPerformanceCounter(&counter);
-    return (double)counter.QuadPart / (double)frequency.QuadPart;
-#else
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
-#endif
-}
+// Kernel selected at startup (CPU dispatch by default)
+float* (*convert_kernel)(int n, int *a) = imgCvtGrayInttoFloat_Auto;
+const char *kernel_name = "Auto";
 
-// Check correctness of conversion
+// Check correctness of conversion (every kernel is bit-exact)
 int check_correctness(int *int_array, float *float_array, int n) {
-    for (int i = 0; i < n; i++) {
-        float expected = (float)int_array[i] / 255.0f;
-        float diff = float_array[i] - expected;
-        if (diff < 0) diff = -diff; // absolute value
-        if (diff > 0.001f) { // Allow small floating point error
-            printf("Error at index %d: expected %.6f, got %.6f\n", 
-                   i, expected, float_array[i]);
-            return 0;
-        }
+    verify_result_t result;
+    if (verify_int_to_float(n, int_array, float_array, &result) == 0) {
+        return 1;
     }
-    return 1;
+    printf("Error at index %lld: expected %.6f, got %.6f (%lld mismatches, max %u ulp)\n",
+           result.first_mismatch, result.expected, result.actual, result.mismatches, result.max_ulp);
+    return 0;
 }
 
 // Manual input mode
 void manual_mode() {
-    int height, width;
+    int height = 0, width = 0;
     
     // Collect input - height and width
     printf("Enter height: ");
@@ -47,10 +37,17 @@ void manual_mode() {
     printf("Enter width: ");
     scanf("%d", &width);
     
-    int total_elements = height * width;
+    // The product is checked before it is used: the kernels count pixels
+    // in an int (imgCvtGray*_Large take a size_t)
+    size_t pixels;
+    if (height <= 0 || width <= 0 || image_pixel_count(height, width, &pixels) != 0 || pixels > INT_MAX) {
+        printf("Invalid dimensions: %d x %d\n", height, width);
+        return;
+    }
+    int total_elements = (int)pixels;
     
     // Allocate memory for 2D array (flattened as 1D)
-    int *array = (int *)malloc(total_elements * sizeof(int));
+    int *array = (int *)malloc((size_t)total_elements * sizeof(int));
     
     if (array == NULL) {
         printf("Memory allocation failed\n");
@@ -69,7 +66,7 @@ void manual_mode() {
     
     // Time the assembly function
     double start_time = get_time();
-    float *float_array = imgCvtGrayInttoFloat(total_elements, array);
+    float *float_array = convert_kernel(total_elements, array);
     double end_time = get_time();
     
     if (float_array == NULL) {
@@ -92,14 +89,14 @@ void manual_mode() {
     
     // Print outputs
     printf("\n+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
-    printf("Conversion Results\n");
+    printf("Conversion Results (%s)\n", kernel_name);
     printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     printf("Correctness check: PASSED\n");
-    printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+    printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
     printf("\nConverted grayscale values (2D array):\n");
     for (int i = 0; i < height; i++) {
         for (int j = 0; j < width; j++) {
-            printf("%.2f ", float_array[i * width + j]);
+            printf("%.2f ", float_array[(size_t)i * width + j]);
         }
         printf("\n");
     }
@@ -115,7 +112,7 @@ void automated_mode() {
     int height, width;
     
     printf("\n+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
-    printf("Automated Grayscale Image Conversion Test\n");
+    printf("Automated Grayscale Image Conversion Test (%s)\n", kernel_name);
     printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     printf("Choose image size:\n");
     printf("1. 10x10\n");
@@ -168,14 +165,14 @@ void automated_mode() {
     printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     for (int i = 0; i < height; i++) {
         for (int j = 0; j < width; j++) {
-            printf("%d ", array[i * width + j]);
+            printf("%d ", array[(size_t)i * width + j]);
         }
         printf("\n");
     }
     
     // Time the assembly function
     double start_time = get_time();
-    float *float_array = imgCvtGrayInttoFloat(total_elements, array);
+    float *float_array = convert_kernel(total_elements, array);
     double end_time = get_time();
     
     if (float_array == NULL) {
@@ -198,34 +195,37 @@ void automated_mode() {
     
     // For 1000x1000, output to text file
     if (height == 1000 && width == 1000) {
+        double output_start = get_time();
         FILE *file = fopen("output_1000x1000.txt", "w");
         if (file != NULL) {
             fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
-            fprintf(file, "Grayscale Conversion Results (1000x1000)\n");
+            fprintf(file, "Grayscale Conversion Results (1000x1000) - %s\n", kernel_name);
             fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             fprintf(file, "Correctness check: PASSED\n");
-            fprintf(file, "Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            fprintf(file, "Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
             fprintf(file, "\nGenerated Input (Integer Pixel Values):\n");
-            for (int i = 0; i < height; i++) {
-                for (int j = 0; j < width; j++) {
-                    fprintf(file, "%d ", array[i * width + j]);
-                }
-                fprintf(file, "\n");
-            }
+            write_int_text(file, array, height, width);
             fprintf(file, "\nConverted Output (Float Pixel Values):\n");
-            for (int i = 0; i < height; i++) {
-                for (int j = 0; j < width; j++) {
-                    fprintf(file, "%.2f ", float_array[i * width + j]);
-                }
-                fprintf(file, "\n");
-            }
+            write_float_text(file, float_array, height, width);
             fclose(file);
+            double text_time = get_time() - output_start;
+            
+            // Same frame as raw float32 (GRF1 header + pixels)
+            output_start = get_time();
+            FILE *bin_file = fopen("output_1000x1000.bin", "wb");
+            int bin_ok = bin_file != NULL && write_float_binary(bin_file, float_array, height, width) == 0;
+            if (bin_file != NULL) fclose(bin_file);
+            double binary_time = get_time() - output_start;
             printf("\n+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             printf("Results for %dx%d\n", height, width);
             printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             printf("Correctness check: PASSED\n");
-            printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            printf("Output time: %.6f ms (text), %.6f ms (binary)\n", text_time * 1000.0, binary_time * 1000.0);
             printf("Full output saved to: output_1000x1000.txt\n");
+            if (bin_ok) {
+                printf("Binary output saved to: output_1000x1000.bin\n");
+            }
         } else {
             printf("Error: Could not create output file\n");
             // Fall back to console output
@@ -233,11 +233,11 @@ void automated_mode() {
             printf("Results for %dx%d\n", height, width);
             printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
             printf("Correctness check: PASSED\n");
-            printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+            printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
             printf("\nSample output (first 5x5 pixels):\n");
             for (int i = 0; i < 5; i++) {
                 for (int j = 0; j < 5; j++) {
-                    printf("%.2f ", float_array[i * width + j]);
+                    printf("%.2f ", float_array[(size_t)i * width + j]);
                 }
                 printf("\n");
             }
@@ -248,13 +248,13 @@ void automated_mode() {
         printf("Results for %dx%d\n", height, width);
         printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
         printf("Correctness check: PASSED\n");
-        printf("Execution time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
+        printf("Conversion time: %.6f ms (%.9f seconds)\n", elapsed_ms, elapsed);
         
         // Display full output for smaller sizes
         printf("\nConverted Output (Float Pixel Values):\n");
         for (int i = 0; i < height; i++) {
             for (int j = 0; j < width; j++) {
-                printf("%.2f ", float_array[i * width + j]);
+                printf("%.2f ", float_array[(size_t)i * width + j]);
             }
             printf("\n");
         }
@@ -269,15 +269,198 @@ void automated_mode() {
     printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
 }
 
-int main() {
+// Convert a PGM/PPM image to a PFM float image. The file is memory-mapped
+// and fed straight to the uint8_t kernels (CPU dispatch); P6 samples are
+// converted channel by channel, or to one luma channel with the fused
+// color kernel if luma is not NULL. Returns 1 on success, 0 on failure.
+int convert_image_file(const char *input_path, const char *output_path, const luma_weights_t *luma) {
+    double start_time = get_time();
+    pnm_image_t image;
+    if (load_pnm(input_path, &image) != 0) {
+        return 0;
+    }
+    double load_time = get_time() - start_time;
+    
+    int fused = luma != NULL && image.channels == 3;
+    int out_channels = fused ? 1 : image.channels;
+    int out_samples = image.width * image.height * out_channels;
+    float *float_array = alloc_float_buffer(out_samples);
+    if (float_array == NULL) {
+        printf("Memory allocation failed for %dx%d image\n", image.width, image.height);
+        unload_pnm(&image);
+        return 0;
+    }
+    
+    // The kernels only read their input, so the read-only mapping is safe
+    start_time = get_time();
+    if (fused) {
+        imgCvtGrayRGBtoFloat_Auto_into(out_samples, (uint8_t *)image.pixels, float_array, luma);
+    } else {
+        imgCvtGrayU8toFloat_Auto_into(image.num_samples, (uint8_t *)image.pixels, float_array);
+    }
+    double convert_time = get_time() - start_time;
+    
+    start_time = get_time();
+    FILE *file = fopen(output_path, "wb");
+    int ok = file != NULL &&
+             write_float_pfm(file, float_array, image.height, image.width, out_channels) == 0;
+    if (file != NULL && fclose(file) != 0) ok = 0;
+    double write_time = get_time() - start_time;
+    
+    printf("%s: %dx%d, %d channel%s -> %s%s\n", input_path, image.width, image.height,
+           image.channels, image.channels == 1 ? "" : "s", ok ? output_path : "FAILED to write output",
+           fused ? " (luma)" : "");
+    printf("  Map: %.3f ms, Convert (%s): %.3f ms (%.2f GB/s), Write: %.3f ms\n",
+           load_time * 1000.0, fused ? selected_rgb_kernel()->info.label : selected_u8_kernel()->info.label,
+           convert_time * 1000.0,
+           convert_time > 0.0 ? (image.num_samples + 4.0 * out_samples) / convert_time / 1e9 : 0.0,
+           write_time * 1000.0);
+    
+    free_float_buffer(float_array);
+    unload_pnm(&image);
+    return ok;
+}
+
+// Stream a P5 image of any size from input_path to a GRF1 file at
+// output_path ("-" for stdin/stdout) with bounded memory. Rows go out top
+// to bottom as they arrive, which is why the output is GRF1 and not PFM.
+// Returns 1 on success, 0 on failure.
+int stream_image_file(const char *input_path, const char *output_path) {
+    FILE *in = strcmp(input_path, "-") == 0 ? stdin : fopen(input_path, "rb");
+    FILE *out = strcmp(output_path, "-") == 0 ? stdout : fopen(output_path, "wb");
+#ifdef _WIN32
+    if (in == stdin) _setmode(_fileno(stdin), _O_BINARY);
+    if (out == stdout) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    int ok = 0;
+    pnm_image_t header;
+    stream_stats_t stats;
+    
+    if (in == NULL || out == NULL) {
+        fprintf(stderr, "Error: Could not open %s\n", in == NULL ? input_path : output_path);
+    } else if (read_pnm_header(in, &header) != 0) {
+        fprintf(stderr, "%s: cannot stream this file\n", input_path);
+    } else if (header.channels != 1) {
+        fprintf(stderr, "%s: streaming supports P5 (grayscale) input only\n", input_path);
+    } else if (write_float_binary_header(out, header.height, header.width) != 0) {
+        fprintf(stderr, "Error: Could not write %s\n", output_path);
+    } else {
+        long long pixels = (long long)header.width * header.height;
+        ok = stream_convert(in, out, pixels, 1, 0, &stats) == 0;
+        
+        // Report on stderr so stdout can carry the image
+        fprintf(stderr, "%s: %dx%d -> %s%s\n", input_path, header.width, header.height,
+                output_path, ok ? "" : " (FAILED)");
+        fprintf(stderr, "  Buffers: %.1f MB for %lld pixels, total %.3f ms (%.2f Mpixel/s)\n",
+                stats.buffer_bytes / 1e6, stats.pixels, stats.total_seconds * 1000.0,
+                stats.total_seconds > 0.0 ? stats.pixels / stats.total_seconds / 1e6 : 0.0);
+        fprintf(stderr, "  Read:    %10.3f ms  %8.1f MB/s\n", stats.read_seconds * 1000.0,
+                stats.read_seconds > 0.0 ? stats.pixels / stats.read_seconds / 1e6 : 0.0);
+        fprintf(stderr, "  Convert: %10.3f ms  %8.1f MB/s in (%s)\n", stats.convert_seconds * 1000.0,
+                stats.convert_seconds > 0.0 ? stats.pixels / stats.convert_seconds / 1e6 : 0.0,
+                selected_u8_kernel()->info.label);
+        fprintf(stderr, "  Write:   %10.3f ms  %8.1f MB/s\n", stats.write_seconds * 1000.0,
+                stats.write_seconds > 0.0 ? 4.0 * stats.pixels / stats.write_seconds / 1e6 : 0.0);
+    }
+    
+    if (in != NULL && in != stdin) fclose(in);
+    if (out != NULL && out != stdout && fclose(out) != 0) ok = 0;
+    return ok;
+}
+
+// Image file mode
+void image_mode() {
+    char input_path[1024], output_path[1024];
+    
+    printf("Input image (binary PGM/PPM): ");
+    if (scanf("%1023s", input_path) != 1) {
+        return;
+    }
+    printf("Output image (PFM): ");
+    if (scanf("%1023s", output_path) != 1) {
+        return;
+    }
+    printf("\n");
+    convert_image_file(input_path, output_path, NULL);
+}
+
+// Choose which kernel to run
+int choose_kernel() {
+    int kernel_choice;
+    
+    printf("Choose kernel:\n");
+    printf("0. Auto (CPU dispatch: %s)\n", selected_kernel()->info.label);
+    for (int k = 0; k < num_kernels; k++) {
+        printf("%d. %s%s\n", k + 1, kernels[k].info.label,
+               kernel_supported(&kernels[k].info) ? "" : " (not supported by this CPU)");
+    }
+    printf("Enter your choice (0-%d): ", num_kernels);
+    scanf("%d", &kernel_choice);
+    
+    if (kernel_choice == 0) {
+        convert_kernel = imgCvtGrayInttoFloat_Auto;
+        kernel_name = selected_kernel()->info.label;
+    } else if (kernel_choice >= 1 && kernel_choice <= num_kernels
+               && kernel_supported(&kernels[kernel_choice - 1].info)) {
+        convert_kernel = kernels[kernel_choice - 1].convert;
+        kernel_name = kernels[kernel_choice - 1].info.label;
+    } else {
+        printf("Invalid choice. Exiting.\n");
+        return 0;
+    }
+    printf("\n");
+    return 1;
+}
+
+// Usage: main                              interactive menu
+//        main input.pgm output.pfm [...]      convert image files, one pair at a time
+//        main --luma601|--luma709 in.ppm out.pfm [...]
+//                                             same, but P6 files become one luma channel
+//        main --stream input.pgm output.grf   stream a P5 image of any size ("-" = stdin/stdout)
+int main(int argc, char **argv) {
     int choice;
+    const luma_weights_t *luma = NULL;
+    
+    if (argc > 1 && (strcmp(argv[1], "--luma601") == 0 || strcmp(argv[1], "--luma709") == 0)) {
+        if (argc < 4) {
+            printf("Usage: %s --luma601|--luma709 input.ppm output.pfm [...]\n", argv[0]);
+            return 1;
+        }
+        luma = strcmp(argv[1], "--luma601") == 0 ? &luma_bt601 : &luma_bt709;
+        argv++;
+        argc--;
+    }
+    if (argc > 1 && strcmp(argv[1], "--stream") == 0) {
+        if (argc != 4) {
+            printf("Usage: %s --stream input.pgm|- output.grf|-\n", argv[0]);
+            return 1;
+        }
+        return stream_image_file(argv[2], argv[3]) ? 0 : 1;
+    }
+    if (argc > 1) {
+        if (argc % 2 == 0) {
+            printf("Usage: %s [input.pgm|ppm output.pfm ...]\n", argv[0]);
+            return 1;
+        }
+        int failures = 0;
+        for (int i = 1; i + 1 < argc; i += 2) {
+            if (!convert_image_file(argv[i], argv[i + 1], luma)) {
+                failures++;
+            }
+        }
+        return failures > 0 ? 1 : 0;
+    }
     
     printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     printf("Grayscale Image Conversion Program\n");
     printf("+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    if (!choose_kernel()) {
+        return 1;
+    }
     printf("1. Manual input mode\n");
     printf("2. Automated mode (10x10, 100x100, 1000x1000)\n");
-    printf("Enter your choice (1 or 2): ");
+    printf("3. Convert an image file (PGM/PPM to PFM)\n");
+    printf("Enter your choice (1, 2, or 3): ");
     scanf("%d", &choice);
     
     if (choice == 1) {
@@ -285,6 +468,9 @@ int main() {
         manual_mode();
     } else if (choice == 2) {
         automated_mode();
+    } else if (choice == 3) {
+        printf("\n");
+        image_mode();
     } else {
         printf("Invalid choice. Exiting.\n");
         return 1;
@@ -1,61 +1,2471 @@
+#include <float.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
 #include <time.h>
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
 #endif
 
-extern float* imgCvtGrayInttoFloat(int n, int *a);  // Assembly version
-extern float* imgCvtGrayInttoFloat_C(int n, int *a);  // C version
+#include "imgCvtGray.h"
+
+// Check correctness of conversion: every kernel is bit-exact
+int check_correctness(int *int_array, float *float_array, int n) {
+    return verify_int_to_float(n, int_array, float_array, NULL) == 0;
+}
+
+// Check 16-bit output against the exact value: round to nearest keeps the
+// relative error within half a unit in the last place (2^-11 for IEEE
+// half, 2^-8 for bfloat16). Inputs 0-255 must also read back as the
+// same 8-bit level.
+int check_half_correctness(int *int_array, uint16_t *out, int n, int bf16) {
+    double unit_roundoff = bf16 ? 1.0 / 256.0 : 1.0 / 2048.0;
+    for (int i = 0; i < n; i++) {
+        double exact = int_array[i] / 255.0;
+        double value = bf16 ? bf16_to_float(out[i]) : half_to_float(out[i]);
+        if (fabs(value - exact) > fabs(exact) * unit_roundoff) {
+            return 0;
+        }
+        if (int_array[i] >= 0 && int_array[i] <= 255 && (int)floor(value * 255.0 + 0.5) != int_array[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Check if two float arrays produce the same output (bit for bit)
+int check_outputs_match(float *array1, float *array2, int n) {
+    return memcmp(array1, array2, n * sizeof(float)) == 0;
+}
+
+#define MAX_KERNELS 16  // Room for per-kernel statistics
+
+// Statistical benchmark harness
+// Every measurement starts with BENCH_WARMUP untimed calls (caches, TLB,
+// branch predictors, AVX frequency transition). Small frames are then run
+// in batches of `reps` back-to-back calls, doubling reps until one batch
+// takes at least BENCH_MIN_BATCH_SECONDS, so timer resolution stops
+// dominating. BENCH_SAMPLES batches are timed and the per-call times are
+// summarised by their distribution rather than a single mean.
+#define BENCH_WARMUP            3
+#define BENCH_SAMPLES           51
+#define BENCH_MIN_BATCH_SECONDS 200e-6
+#define BENCH_MAX_REPS          (1 << 20)
+
+typedef struct {
+    double min, median, p90, p99, mean, stddev;  // Seconds per call
+    double cycles_per_pixel;    // Median TSC cycles per pixel
+    double gbps;                // Input + output bytes / median time
+    int reps;                   // Calls per timed batch
+    int samples;                // Timed batches
+    // Hardware counters over all timed batches (perf_open), per call.
+    // Bit 1 << PERF_* is set in counters for each event that counted.
+    int counters;
+    double core_cycles_per_pixel;   // Core cycles, unlike cycles_per_pixel
+    double ipc;                     // Instructions per core cycle
+    double l1d_misses_per_kpx;      // Misses per 1000 pixels
+    double llc_misses_per_kpx;
+    double dtlb_misses_per_kpx;
+    double page_faults_per_call;
+} bench_stats_t;
+
+// One kernel call to benchmark: call runs it once, on the fields it uses.
+// There is one call_* function per kind of job, below.
+typedef struct bench_job {
+    void (*call)(const struct bench_job *job);
+    int threaded;                   // Runs on the thread pool (no hardware counts)
+    const kernel_t *kernel;         // int kernels
+    const u8_kernel_t *u8_kernel;   // uint8_t kernels
+    int n;
+    int *a;
+    uint8_t *a8;
+    float *out;                     // Holds uint16_t for 16-bit output
+    const rgb_kernel_t *rgb_kernel; // Pixels in a8, BT.601
+    const affine_kernel_t *affine_kernel;
+    const affine_params_t *affine;
+    const half_kernel_t *half_kernel;
+    const inverse_kernel_t *inverse_kernel; // Reads out, writes a or a8
+    gray_frame_t *frames;           // Batches: num_frames int frames in a, n pixels in all
+    int num_frames;
+    const int *offsets;             // Frame offsets for call_batch_packed
+    int rows;                       // Strided: n pixels in rows rows, in_stride pixels apart
+    int in_stride;
+    void *scratch;                  // Dense copy of the rows for call_copy_*
+    gray_stats_t *frame_stats;      // Filled by call_stats_* and call_scan_*
+} bench_job_t;
+
+static void call_int(const bench_job_t *job) {
+    job->kernel->convert_into(job->n, job->a, job->out);
+}
+
+static void call_u8(const bench_job_t *job) {
+    job->u8_kernel->convert_into(job->n, job->a8, job->out);
+}
+
+static void call_int_nt(const bench_job_t *job) {
+    job->kernel->convert_into_nt(job->n, job->a, job->out);
+}
+
+static void call_u8_nt(const bench_job_t *job) {
+    job->u8_kernel->convert_into_nt(job->n, job->a8, job->out);
+}
+
+static void call_int_parallel(const bench_job_t *job) {
+    imgCvtGrayInttoFloat_Parallel_into(job->kernel, job->n, job->a, job->out);
+}
+
+static void call_int_inplace(const bench_job_t *job) {
+    job->kernel->convert_inplace(job->n, job->a);
+}
+
+static void call_int_inplace_parallel(const bench_job_t *job) {
+    imgCvtGrayInttoFloat_Parallel_inplace(job->kernel, job->n, job->a);
+}
+
+static void call_rgb(const bench_job_t *job) {
+    job->rgb_kernel->rgb_into(job->n, job->a8, job->out, &luma_bt601);
+}
+
+static void call_rgba(const bench_job_t *job) {
+    job->rgb_kernel->rgba_into(job->n, job->a8, job->out, &luma_bt601);
+}
+
+static void call_affine_int(const bench_job_t *job) {
+    job->affine_kernel->int_into(job->n, job->a, job->out, job->affine);
+}
+
+static void call_affine_u8(const bench_job_t *job) {
+    job->affine_kernel->u8_into(job->n, job->a8, job->out, job->affine);
+}
+
+static void call_affine_half_int(const bench_job_t *job) {
+    job->affine_kernel->int_to_half(job->n, job->a, (uint16_t *)job->out, job->affine);
+}
+
+static void call_affine_half_u8(const bench_job_t *job) {
+    job->affine_kernel->u8_to_half(job->n, job->a8, (uint16_t *)job->out, job->affine);
+}
+
+static void call_affine_bf16_int(const bench_job_t *job) {
+    job->affine_kernel->int_to_bf16(job->n, job->a, (uint16_t *)job->out, job->affine);
+}
+
+static void call_affine_bf16_u8(const bench_job_t *job) {
+    job->affine_kernel->u8_to_bf16(job->n, job->a8, (uint16_t *)job->out, job->affine);
+}
+
+static void call_half_int(const bench_job_t *job) {
+    job->half_kernel->int_to_half(job->n, job->a, (uint16_t *)job->out);
+}
+
+static void call_half_u8(const bench_job_t *job) {
+    job->half_kernel->u8_to_half(job->n, job->a8, (uint16_t *)job->out);
+}
+
+static void call_bf16_int(const bench_job_t *job) {
+    job->half_kernel->int_to_bf16(job->n, job->a, (uint16_t *)job->out);
+}
+
+static void call_bf16_u8(const bench_job_t *job) {
+    job->half_kernel->u8_to_bf16(job->n, job->a8, (uint16_t *)job->out);
+}
+
+static void call_inverse_int(const bench_job_t *job) {
+    job->inverse_kernel->to_int(job->n, job->out, job->a);
+}
+
+static void call_inverse_u8(const bench_job_t *job) {
+    job->inverse_kernel->to_u8(job->n, job->out, job->a8);
+}
+
+// Strided frames: through the 2D entry points, or copied into the dense
+// scratch array first
+static void call_2d_int(const bench_job_t *job) {
+    imgCvtGrayInttoFloat_2D_into(job->n / job->rows, job->rows, job->a, job->in_stride, job->out, job->n / job->rows);
+}
+
+static void call_2d_u8(const bench_job_t *job) {
+    imgCvtGrayU8toFloat_2D_into(job->n / job->rows, job->rows, job->a8, job->in_stride, job->out, job->n / job->rows);
+}
+
+static void copy_rows(const bench_job_t *job, const void *in, size_t sample) {
+    int width = job->n / job->rows;
+    for (int y = 0; y < job->rows; y++) {
+        memcpy((uint8_t *)job->scratch + (size_t)y * width * sample,
+               (const uint8_t *)in + (size_t)y * job->in_stride * sample, width * sample);
+    }
+}
+
+static void call_copy_int(const bench_job_t *job) {
+    copy_rows(job, job->a, sizeof(int));
+    imgCvtGrayInttoFloat_Auto_into(job->n, (int *)job->scratch, job->out);
+}
+
+static void call_copy_u8(const bench_job_t *job) {
+    copy_rows(job, job->a8, sizeof(uint8_t));
+    imgCvtGrayU8toFloat_Auto_into(job->n, (uint8_t *)job->scratch, job->out);
+}
+
+// Frame statistics gathered while converting, or by scanning the output
+static void call_stats_int(const bench_job_t *job) {
+    imgCvtGrayInttoFloat_Stats_into(job->n, job->a, job->out, job->frame_stats);
+}
+
+static void call_stats_u8(const bench_job_t *job) {
+    imgCvtGrayU8toFloat_Stats_into(job->n, job->a8, job->out, job->frame_stats);
+}
+
+static void call_scan_int(const bench_job_t *job) {
+    imgCvtGrayInttoFloat_Parallel_into(selected_kernel(), job->n, job->a, job->out);
+    gray_stats_scan(job->n, job->out, job->frame_stats);
+}
+
+static void call_scan_u8(const bench_job_t *job) {
+    imgCvtGrayU8toFloat_Parallel_into(selected_u8_kernel(), job->n, job->a8, job->out);
+    gray_stats_scan(job->n, job->out, job->frame_stats);
+}
+
+// Output allocated, converted into and released per call
+static void call_alloc_malloc(const bench_job_t *job) {
+    free(imgCvtGrayInttoFloat_Auto(job->n, job->a));
+}
+
+static void call_alloc_pool(const bench_job_t *job) {
+    pool_free_float(imgCvtGrayInttoFloat_Pooled(job->n, job->a));
+}
+
+// Ways of converting a batch of small frames
+static void call_batch_loop_alloc(const bench_job_t *job) {
+    // Every result is kept until the batch is done, as a caller would
+    for (int f = 0; f < job->num_frames; f++) {
+        job->frames[f].out = imgCvtGrayInttoFloat_Auto(job->frames[f].n, (int *)job->frames[f].pixels);
+    }
+    for (int f = 0; f < job->num_frames; f++) {
+        free(job->frames[f].out);
+    }
+}
+
+static void call_batch_loop_into(const bench_job_t *job) {
+    for (int f = 0; f < job->num_frames; f++) {
+        imgCvtGrayInttoFloat_Auto_into(job->frames[f].n, (int *)job->frames[f].pixels, job->frames[f].out);
+    }
+}
+
+static void call_batch_into(const bench_job_t *job) {
+    convert_batch_into(job->frames, job->num_frames, 4);
+}
+
+static void call_batch_alloc(const bench_job_t *job) {
+    free_float_buffer(convert_batch(job->frames, job->num_frames, 4));
+}
+
+static void call_batch_packed(const bench_job_t *job) {
+    convert_packed_into(job->a, job->offsets, job->num_frames, 4, job->out);
+}
+
+// Time-stamp counter. lfence keeps earlier instructions from drifting
+// past the start read; rdtscp waits for the timed work to finish.
+static unsigned long long tsc_start(void) {
+    _mm_lfence();
+    return __rdtsc();
+}
+
+static unsigned long long tsc_stop(void) {
+    unsigned int aux;
+    return __rdtscp(&aux);
+}
+
+static int compare_doubles(const void *x, const void *y) {
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a > b) - (a < b);
+}
+
+// p-th quantile (0-1) of a sorted array, linear interpolation
+static double percentile(const double *sorted, int count, double p) {
+    double pos = p * (count - 1);
+    int lo = (int)pos;
+    int hi = lo + 1 < count ? lo + 1 : lo;
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+// Hardware counts per call. Counters follow only the calling thread, so
+// jobs that run on the thread pool get none rather than a partial count.
+static void bench_counters(const bench_job_t *job, const perf_counts_t *counts, long long calls,
+                           bench_stats_t *stats) {
+    stats->counters = job->threaded || calls <= 0 || job->n <= 0 ? 0 : counts->valid;
+    double per_call[PERF_NUM_EVENTS];
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        per_call[e] = stats->counters & (1 << e) ? (double)counts->count[e] / calls : 0.0;
+    }
+    if (!(stats->counters & (1 << PERF_CYCLES)) || per_call[PERF_CYCLES] <= 0.0) {
+        stats->counters &= ~(1 << PERF_INSTRUCTIONS);   // No IPC without cycles
+    }
+    
+    double pixels = job->n > 0 ? job->n : 1;
+    stats->core_cycles_per_pixel = per_call[PERF_CYCLES] / pixels;
+    stats->ipc = per_call[PERF_CYCLES] > 0.0 ? per_call[PERF_INSTRUCTIONS] / per_call[PERF_CYCLES] : 0.0;
+    stats->l1d_misses_per_kpx = per_call[PERF_L1D_MISSES] * 1000.0 / pixels;
+    stats->llc_misses_per_kpx = per_call[PERF_LLC_MISSES] * 1000.0 / pixels;
+    stats->dtlb_misses_per_kpx = per_call[PERF_DTLB_MISSES] * 1000.0 / pixels;
+    stats->page_faults_per_call = per_call[PERF_PAGE_FAULTS];
+}
+
+// Measure one kernel call. bytes_per_pixel is input + output traffic.
+// Hardware counters run across all timed batches, outside the timers.
+void bench_kernel(const bench_job_t *job, double bytes_per_pixel, bench_stats_t *stats) {
+    double times[BENCH_SAMPLES];
+    double cycles[BENCH_SAMPLES];
+    perf_counts_t counts;
+    
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        job->call(job);
+    }
+    
+    // Calibrate the batch size
+    int reps = 1;
+    for (;;) {
+        double start_time = get_time();
+        for (int r = 0; r < reps; r++) job->call(job);
+        double elapsed = get_time() - start_time;
+        if (elapsed >= BENCH_MIN_BATCH_SECONDS || reps >= BENCH_MAX_REPS) break;
+        reps *= 2;
+    }
+    
+    double sum = 0.0, sum_sq = 0.0;
+    perf_start();
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        double start_time = get_time();
+        unsigned long long start_tsc = tsc_start();
+        for (int r = 0; r < reps; r++) job->call(job);
+        unsigned long long end_tsc = tsc_stop();
+        double end_time = get_time();
+        
+        times[s] = (end_time - start_time) / reps;
+        cycles[s] = (double)(end_tsc - start_tsc) / reps;
+        sum += times[s];
+        sum_sq += times[s] * times[s];
+    }
+    perf_stop(&counts);
+    qsort(times, BENCH_SAMPLES, sizeof(double), compare_doubles);
+    qsort(cycles, BENCH_SAMPLES, sizeof(double), compare_doubles);
+    
+    stats->min = times[0];
+    stats->median = percentile(times, BENCH_SAMPLES, 0.50);
+    stats->p90 = percentile(times, BENCH_SAMPLES, 0.90);
+    stats->p99 = percentile(times, BENCH_SAMPLES, 0.99);
+    stats->mean = sum / BENCH_SAMPLES;
+    double variance = sum_sq / BENCH_SAMPLES - stats->mean * stats->mean;
+    stats->stddev = variance > 0.0 ? sqrt(variance) : 0.0;
+    stats->cycles_per_pixel = job->n > 0 ? percentile(cycles, BENCH_SAMPLES, 0.50) / job->n : 0.0;
+    stats->gbps = stats->median > 0.0 ? bytes_per_pixel * job->n / stats->median / 1e9 : 0.0;
+    stats->reps = reps;
+    stats->samples = BENCH_SAMPLES;
+    bench_counters(job, &counts, (long long)BENCH_SAMPLES * reps, stats);
+}
+
+// Machine-readable results
+// Every measurement is also written as one record to
+// performance_test_results.csv and performance_test_results.json. The CSV
+// starts with a "# host:" comment line, then a header row; compare mode
+// (--compare) reads two CSV files back. The hardware counter columns come
+// last and are empty (null in JSON) when the event was not counted.
+#define CSV_COLUMNS "suite,input,kernel,height,width,pixels,threads,samples,reps," \
+                    "min_ms,median_ms,p90_ms,p99_ms,mean_ms,stddev_ms,cycles_per_pixel,gbps," \
+                    "core_cycles_per_pixel,ipc,l1d_misses_per_kpx,llc_misses_per_kpx," \
+                    "dtlb_misses_per_kpx,page_faults_per_call"
+
+static FILE *csv_file = NULL;
+static FILE *json_file = NULL;
+static int json_records = 0;
+
+// Open both record files and write the host description
+void open_records(void) {
+    csv_file = fopen("performance_test_results.csv", "w");
+    json_file = fopen("performance_test_results.json", "w");
+    
+    if (csv_file != NULL) {
+        fprintf(csv_file, "# host: cpu=%s; features=0x%02x; logical_cpus=%d\n",
+                cpu_brand_string(), detect_cpu_features(), parallel_cpu_count());
+        fprintf(csv_file, "%s\n", CSV_COLUMNS);
+    }
+    if (json_file != NULL) {
+        fprintf(json_file, "{\n  \"host\": {\"cpu\": \"%s\", \"features\": %d, \"logical_cpus\": %d},\n",
+                cpu_brand_string(), detect_cpu_features(), parallel_cpu_count());
+        fprintf(json_file, "  \"dispatch\": \"%s\",\n  \"results\": [", selected_kernel()->info.name);
+    }
+    json_records = 0;
+}
+
+// One hardware counter field: the value, or `missing` if not counted
+static void write_counter(FILE *out, const char *separator, const char *name, const bench_stats_t *stats,
+                          int event, double value, const char *missing) {
+    fprintf(out, "%s", separator);
+    if (name != NULL) {
+        fprintf(out, "\"%s\": ", name);
+    }
+    if (stats->counters & (1 << event)) {
+        fprintf(out, "%.4f", value);
+    } else {
+        fprintf(out, "%s", missing);
+    }
+}
+
+static void write_counters(FILE *out, int json, const bench_stats_t *stats) {
+    const char *separator = json ? ", " : ",";
+    const char *missing = json ? "null" : "";
+    write_counter(out, separator, json ? "core_cycles_per_pixel" : NULL, stats, PERF_CYCLES,
+                  stats->core_cycles_per_pixel, missing);
+    write_counter(out, separator, json ? "ipc" : NULL, stats, PERF_INSTRUCTIONS, stats->ipc, missing);
+    write_counter(out, separator, json ? "l1d_misses_per_kpx" : NULL, stats, PERF_L1D_MISSES,
+                  stats->l1d_misses_per_kpx, missing);
+    write_counter(out, separator, json ? "llc_misses_per_kpx" : NULL, stats, PERF_LLC_MISSES,
+                  stats->llc_misses_per_kpx, missing);
+    write_counter(out, separator, json ? "dtlb_misses_per_kpx" : NULL, stats, PERF_DTLB_MISSES,
+                  stats->dtlb_misses_per_kpx, missing);
+    write_counter(out, separator, json ? "page_faults_per_call" : NULL, stats, PERF_PAGE_FAULTS,
+                  stats->page_faults_per_call, missing);
+}
+
+// Append one measurement. suite names the test section, input is "int32"
+// or "uint8", kernel is the kernel's short name.
+void record_result(const char *suite, const char *input, const char *kernel,
+                   int height, int width, int threads, const bench_stats_t *stats) {
+    if (csv_file != NULL) {
+        fprintf(csv_file, "%s,%s,%s,%d,%d,%lld,%d,%d,%d,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.4f,%.4f",
+                suite, input, kernel, height, width, (long long)height * width, threads,
+                stats->samples, stats->reps, stats->min * 1000.0, stats->median * 1000.0,
+                stats->p90 * 1000.0, stats->p99 * 1000.0, stats->mean * 1000.0,
+                stats->stddev * 1000.0, stats->cycles_per_pixel, stats->gbps);
+        write_counters(csv_file, 0, stats);
+        fprintf(csv_file, "\n");
+    }
+    if (json_file != NULL) {
+        fprintf(json_file, "%s\n    {\"suite\": \"%s\", \"input\": \"%s\", \"kernel\": \"%s\", "
+                "\"height\": %d, \"width\": %d, \"pixels\": %lld, \"threads\": %d, "
+                "\"samples\": %d, \"reps\": %d, \"min_ms\": %.9f, \"median_ms\": %.9f, "
+                "\"p90_ms\": %.9f, \"p99_ms\": %.9f, \"mean_ms\": %.9f, \"stddev_ms\": %.9f, "
+                "\"cycles_per_pixel\": %.4f, \"gbps\": %.4f",
+                json_records > 0 ? "," : "", suite, input, kernel, height, width,
+                (long long)height * width, threads, stats->samples, stats->reps,
+                stats->min * 1000.0, stats->median * 1000.0, stats->p90 * 1000.0,
+                stats->p99 * 1000.0, stats->mean * 1000.0, stats->stddev * 1000.0,
+                stats->cycles_per_pixel, stats->gbps);
+        write_counters(json_file, 1, stats);
+        fprintf(json_file, "}");
+        json_records++;
+    }
+}
+
+void close_records(void) {
+    if (csv_file != NULL) {
+        fclose(csv_file);
+        csv_file = NULL;
+    }
+    if (json_file != NULL) {
+        fprintf(json_file, "\n  ]\n}\n");
+        fclose(json_file);
+        json_file = NULL;
+    }
+}
+
+// Compare mode
+// A kernel/size counts as a regression when its median slowed down by more
+// than the threshold AND the change in mean is statistically significant
+// (Welch's t over the timed samples above COMPARE_MIN_T, about p < 0.001
+// for 51 + 51 samples). Both conditions are needed: small but real changes
+// are not worth failing on, and large changes within the noise are not real.
+#define COMPARE_MAX_RECORDS  4096
+#define COMPARE_MIN_T        3.5
+
+typedef struct {
+    char key[96];           // suite/input/kernel/HxW/threads
+    double median, mean, stddev;
+    int samples;
+} compare_record_t;
+
+// Read the records of a CSV results file. Returns the record count, or -1
+// if the file cannot be read.
+static int load_records(const char *path, compare_record_t *records, int max_records, char *host, int host_size) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    
+    char line[512];
+    int count = 0;
+    host[0] = '\0';
+    while (fgets(line, sizeof(line), file) != NULL && count < max_records) {
+        if (strncmp(line, "# host: ", 8) == 0) {
+            line[strcspn(line, "\r\n")] = '\0';
+            snprintf(host, host_size, "%.200s", line + 8);
+            continue;
+        }
+        if (line[0] == '#' || strncmp(line, "suite,", 6) == 0) {
+            continue;
+        }
+        
+        char suite[32], input[16], kernel[32];
+        int height, width, threads, samples, reps;
+        long long pixels;
+        double min_ms, median_ms, p90_ms, p99_ms, mean_ms, stddev_ms;
+        if (sscanf(line, "%31[^,],%15[^,],%31[^,],%d,%d,%lld,%d,%d,%d,%lf,%lf,%lf,%lf,%lf,%lf",
+                   suite, input, kernel, &height, &width, &pixels, &threads, &samples, &reps,
+                   &min_ms, &median_ms, &p90_ms, &p99_ms, &mean_ms, &stddev_ms) != 15) {
+            continue;
+        }
+        compare_record_t *record = &records[count++];
+        snprintf(record->key, sizeof(record->key), "%s/%s/%s/%dx%d/%dt",
+                 suite, input, kernel, height, width, threads);
+        record->median = median_ms;
+        record->mean = mean_ms;
+        record->stddev = stddev_ms;
+        record->samples = samples;
+    }
+    fclose(file);
+    return count;
+}
+
+// Diff two CSV result files. Returns the number of regressions, or -1 if
+// either file cannot be read.
+int compare_results(const char *base_path, const char *new_path, double threshold) {
+    static compare_record_t base[COMPARE_MAX_RECORDS], current[COMPARE_MAX_RECORDS];
+    char base_host[256], new_host[256];
+    
+    int num_base = load_records(base_path, base, COMPARE_MAX_RECORDS, base_host, sizeof(base_host));
+    int num_new = load_records(new_path, current, COMPARE_MAX_RECORDS, new_host, sizeof(new_host));
+    if (num_base < 0 || num_new < 0) {
+        printf("Error: Could not read %s\n", num_base < 0 ? base_path : new_path);
+        return -1;
+    }
+    
+    printf("Base: %s (%s)\n", base_path, base_host);
+    printf("New:  %s (%s)\n", new_path, new_host);
+    if (strcmp(base_host, new_host) != 0) {
+        printf("Warning: results come from different hosts\n");
+    }
+    printf("Threshold: %.1f%% slower and |t| > %.1f\n\n", threshold * 100.0, COMPARE_MIN_T);
+    printf("%-44s %12s %12s %8s %7s\n", "Measurement", "Base ms", "New ms", "Change", "t");
+    
+    int regressions = 0, improvements = 0, matched = 0;
+    for (int i = 0; i < num_new; i++) {
+        const compare_record_t *after = &current[i];
+        const compare_record_t *before = NULL;
+        for (int j = 0; j < num_base; j++) {
+            if (strcmp(base[j].key, after->key) == 0) {
+                before = &base[j];
+                break;
+            }
+        }
+        if (before == NULL || before->median <= 0.0) {
+            continue;
+        }
+        matched++;
+        
+        double change = after->median / before->median - 1.0;
+        double se = sqrt(before->stddev * before->stddev / before->samples +
+                         after->stddev * after->stddev / after->samples);
+        double t = se > 0.0 ? (after->mean - before->mean) / se : 0.0;
+        int significant = t > COMPARE_MIN_T || t < -COMPARE_MIN_T;
+        
+        const char *verdict = "";
+        if (significant && change > threshold) {
+            verdict = "  REGRESSION";
+            regressions++;
+        } else if (significant && change < -threshold) {
+            verdict = "  faster";
+            improvements++;
+        }
+        printf("%-44s %12.6f %12.6f %+7.1f%% %7.1f%s\n",
+               after->key, before->median, after->median, change * 100.0, t, verdict);
+    }
+    
+    printf("\n%d measurements compared, %d regressions, %d improvements\n",
+           matched, regressions, improvements);
+    return regressions;
+}
+
+// The hardware counters that counted, as one line of text ("" if none).
+// Misses are per 1000 pixels.
+static const char *format_counters(const bench_stats_t *stats, char *text, size_t size) {
+    static const char *formats[PERF_NUM_EVENTS] = {
+        "%.2f core cyc/px", "  IPC %.2f", "  L1D %.2f/kpx", "  LLC %.2f/kpx", "  dTLB %.2f/kpx", "  %.1f faults/call"
+    };
+    double values[PERF_NUM_EVENTS] = {
+        stats->core_cycles_per_pixel, stats->ipc, stats->l1d_misses_per_kpx,
+        stats->llc_misses_per_kpx, stats->dtlb_misses_per_kpx, stats->page_faults_per_call
+    };
+    size_t used = 0;
+    text[0] = '\0';
+    for (int e = 0; e < PERF_NUM_EVENTS && used < size; e++) {
+        if (stats->counters & (1 << e)) {
+            used += snprintf(text + used, size - used, formats[e] + (used == 0 ? strspn(formats[e], " ") : 0),
+                             values[e]);
+        }
+    }
+    return text;
+}
+
+// One line of benchmark statistics, and a second with the hardware counters
+static void print_bench_stats(FILE *file, const char *label, const bench_stats_t *stats) {
+    char counters[160];
+    fprintf(file, "  %-9s min %10.6f  med %10.6f  p90 %10.6f  p99 %10.6f  sd %9.6f ms  %6.2f cyc/px  %6.2f GB/s  (x%d)\n",
+            label, stats->min * 1000.0, stats->median * 1000.0, stats->p90 * 1000.0,
+            stats->p99 * 1000.0, stats->stddev * 1000.0, stats->cycles_per_pixel,
+            stats->gbps, stats->reps);
+    if (stats->counters != 0) {
+        fprintf(file, "  %-9s %s\n", "", format_counters(stats, counters, sizeof(counters)));
+    }
+}
+
+// A test frame for the comparison suites: frames back-to-back frames of
+// rows x cols pixels, as random 8-bit levels in int and uint8_t, with a
+// zeroed float output
+typedef struct {
+    int rows;
+    int cols;
+    int n;                          // Pixels in all frames
+    int *a;
+    uint8_t *a8;                    // Same levels as a; 4 per pixel with FRAME_RGBA
+    float *out;
+    float *reference;               // n floats for an expected result, with FRAME_REFERENCE
+} bench_frame_t;
+
+enum { FRAME_REFERENCE = 1, FRAME_RGBA = 2 };
+
+static void bench_frame_free(bench_frame_t *frame) {
+    free(frame->a);
+    free(frame->a8);
+    free_float_buffer(frame->out);
+    free_float_buffer(frame->reference);
+}
+
+// Allocate and fill a frame and print its heading. Returns 0, or -1 after
+// reporting the failure.
+static int bench_frame_alloc(FILE *file, bench_frame_t *frame, int rows, int cols, int frames, int options) {
+    int channels = options & FRAME_RGBA ? 4 : 1;
+    frame->rows = rows;
+    frame->cols = cols;
+    frame->n = frames * rows * cols;
+    frame->a = (int *)malloc((size_t)frame->n * sizeof(int));
+    frame->a8 = (uint8_t *)malloc((size_t)frame->n * channels);
+    frame->out = alloc_float_buffer(frame->n);
+    frame->reference = options & FRAME_REFERENCE ? alloc_float_buffer(frame->n) : NULL;
+    if (frame->a == NULL || frame->a8 == NULL || frame->out == NULL ||
+        (options & FRAME_REFERENCE && frame->reference == NULL)) {
+        fprintf(file, "%dx%d: Memory allocation failed\n\n", rows, cols);
+        bench_frame_free(frame);
+        return -1;
+    }
+    for (size_t i = 0; i < (size_t)frame->n * channels; i++) {
+        frame->a8[i] = (uint8_t)(rand() % 256);
+    }
+    for (int i = 0; i < frame->n; i++) {
+        frame->a[i] = frame->a8[i];
+    }
+    memset(frame->out, 0, (size_t)frame->n * sizeof(float));
+    
+    if (frames > 1) {
+        fprintf(file, "%d frames of %dx%d (%d pixels each):\n", frames, rows, cols, rows * cols);
+    } else {
+        fprintf(file, "%dx%d (%d pixels):\n", rows, cols, frame->n);
+    }
+    printf("  %dx%d:\n", rows, cols);
+    return 0;
+}
+
+// One timed row of a suite. The job's n, a, a8 and out default to the
+// frame's; check, if set, says whether the output the job left is right.
+typedef struct {
+    bench_job_t job;
+    const char *input;              // Pixel type, e.g. "int32" or "rgb8"
+    const char *name;               // Recorded name, name_tag with a tag
+    const char *tag;                // Variant, e.g. "nt" or "unit" (optional)
+    const char *label;              // Printed name
+    double bytes_per_pixel;         // Input plus output traffic
+    int threads;                    // Recorded thread count (0 for 1)
+    int (*check)(const bench_frame_t *frame, const bench_job_t *job);
+    bench_stats_t stats;            // Filled in by bench_entries
+    int ok;
+} bench_entry_t;
+
+#define BENCH_MAX_ENTRIES 32
+
+// Append an entry to a suite's list, if there is room
+static void add_entry(bench_entry_t *entries, int *count, bench_entry_t entry) {
+    if (*count < BENCH_MAX_ENTRIES) {
+        entries[(*count)++] = entry;
+    }
+}
+
+// Time, check, record and print each entry on frame, one line each.
+// Returns the number of failed checks.
+static int bench_entries(FILE *file, const char *suite, const bench_frame_t *frame, bench_entry_t *entries,
+                         int count) {
+    int failures = 0;
+    for (int e = 0; e < count; e++) {
+        bench_entry_t *entry = &entries[e];
+        bench_job_t job = entry->job;
+        if (job.n == 0) job.n = frame->n;
+        if (job.a == NULL) job.a = frame->a;
+        if (job.a8 == NULL) job.a8 = frame->a8;
+        if (job.out == NULL) job.out = frame->out;
+        bench_kernel(&job, entry->bytes_per_pixel, &entry->stats);
+        entry->ok = entry->check == NULL || entry->check(frame, &job);
+        failures += !entry->ok;
+        
+        char name[48], counters[160];
+        if (entry->tag != NULL) {
+            snprintf(name, sizeof(name), "%s_%s", entry->name, entry->tag);
+        } else {
+            snprintf(name, sizeof(name), "%s", entry->name);
+        }
+        record_result(suite, entry->input, name, frame->rows, frame->cols, entry->threads > 0 ? entry->threads : 1,
+                      &entry->stats);
+        fprintf(file, "  %-5s %-9s %-26s %12.6f ms  %6.2f cyc/px  %6.2f GB/s", entry->input,
+                entry->tag != NULL ? entry->tag : "", entry->label, entry->stats.median * 1000.0,
+                entry->stats.cycles_per_pixel, entry->stats.gbps);
+        if (entry->check != NULL) {
+            fprintf(file, "  %s", entry->ok ? "PASSED" : "FAILED");
+        }
+        if (entry->stats.counters != 0) {
+            fprintf(file, "  %s", format_counters(&entry->stats, counters, sizeof(counters)));
+        }
+        fprintf(file, "\n");
+    }
+    return failures;
+}
+
+// Lowest median of entries[from..to), or 0 if there are none
+static double best_median(const bench_entry_t *entries, int from, int to) {
+    double best = 0.0;
+    for (int e = from; e < to; e++) {
+        if (best == 0.0 || entries[e].stats.median < best) best = entries[e].stats.median;
+    }
+    return best;
+}
+
+// Output checks for bench_entry_t
+static int check_levels(const bench_frame_t *frame, const bench_job_t *job) {
+    return check_correctness(frame->a, job->out, job->n);
+}
+
+static int check_reference(const bench_frame_t *frame, const bench_job_t *job) {
+    return check_outputs_match(job->out, frame->reference, job->n);
+}
+
+static int check_half(const bench_frame_t *frame, const bench_job_t *job) {
+    const uint16_t *out16 = (const uint16_t *)job->out;
+    for (int i = 0; i < job->n; i++) {
+        if (out16[i] != float_to_half((float)frame->a[i] / 255.0f)) return 0;
+    }
+    return check_half_correctness(frame->a, (uint16_t *)job->out, job->n, 0);
+}
+
+static int check_bf16(const bench_frame_t *frame, const bench_job_t *job) {
+    const uint16_t *out16 = (const uint16_t *)job->out;
+    for (int i = 0; i < job->n; i++) {
+        if (out16[i] != float_to_bf16((float)frame->a[i] / 255.0f)) return 0;
+    }
+    return check_half_correctness(frame->a, (uint16_t *)job->out, job->n, 1);
+}
+
+// 16-bit affine output: the float reference, rounded
+static int check_reference_half(const bench_frame_t *frame, const bench_job_t *job) {
+    const uint16_t *out16 = (const uint16_t *)job->out;
+    for (int i = 0; i < job->n; i++) {
+        if (out16[i] != float_to_half(frame->reference[i])) return 0;
+    }
+    return 1;
+}
+
+static int check_reference_bf16(const bench_frame_t *frame, const bench_job_t *job) {
+    const uint16_t *out16 = (const uint16_t *)job->out;
+    for (int i = 0; i < job->n; i++) {
+        if (out16[i] != float_to_bf16(frame->reference[i])) return 0;
+    }
+    return 1;
+}
+
+// Inverse kernels: the levels the frame's floats came from
+static int check_inverse_int(const bench_frame_t *frame, const bench_job_t *job) {
+    return memcmp(job->a, frame->a, (size_t)job->n * sizeof(int)) == 0;
+}
+
+static int check_inverse_u8(const bench_frame_t *frame, const bench_job_t *job) {
+    for (int i = 0; i < job->n; i++) {
+        if (job->a8[i] != frame->a[i]) return 0;
+    }
+    return 1;
+}
+
+// A fresh allocating call, for jobs that free their output
+static int check_alloc_malloc(const bench_frame_t *frame, const bench_job_t *job) {
+    float *out = imgCvtGrayInttoFloat_Auto(job->n, job->a);
+    int ok = out != NULL && check_correctness(frame->a, out, job->n);
+    free(out);
+    return ok;
+}
+
+static int check_alloc_pool(const bench_frame_t *frame, const bench_job_t *job) {
+    float *out = imgCvtGrayInttoFloat_Pooled(job->n, job->a);
+    int ok = out != NULL && check_correctness(frame->a, out, job->n);
+    pool_free_float(out);
+    return ok;
+}
+
+// Every supported int kernel, then every supported uint8_t kernel, checked
+// against the input levels. Returns the index of the first uint8_t entry.
+static int add_width_entries(bench_entry_t *entries, int *count) {
+    for (int k = 0; k < num_kernels; k++) {
+        if (kernel_supported(&kernels[k].info)) {
+            add_entry(entries, count, (bench_entry_t){.job = {.call = call_int, .kernel = &kernels[k]},
+                      .input = "int32", .name = kernels[k].info.name, .label = kernels[k].info.label,
+                      .bytes_per_pixel = 8.0, .check = check_levels});
+        }
+    }
+    int first_u8 = *count;
+    for (int k = 0; k < num_u8_kernels; k++) {
+        if (kernel_supported(&u8_kernels[k].info)) {
+            add_entry(entries, count, (bench_entry_t){.job = {.call = call_u8, .u8_kernel = &u8_kernels[k]},
+                      .input = "uint8", .name = u8_kernels[k].info.name, .label = u8_kernels[k].info.label,
+                      .bytes_per_pixel = 5.0, .check = check_levels});
+        }
+    }
+    return first_u8;
+}
+
+// Compare the int input path (4 bytes read per pixel) with the uint8_t
+// input path (1 byte read per pixel). Times are medians from bench_kernel;
+// GB/s counts input plus output bytes.
+void run_input_width_comparison(FILE *file) {
+    int sizes[2] = {1000, 4000};  // Square frames, 4 MB and 64 MB of int input
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Input Width: int32 (8 bytes/pixel moved) vs uint8 (5 bytes/pixel moved)\n");
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Input width: int32 vs uint8...\n");
+    
+    for (int size_idx = 0; size_idx < 2; size_idx++) {
+        bench_frame_t frame;
+        if (bench_frame_alloc(file, &frame, sizes[size_idx], sizes[size_idx], 1, 0) != 0) {
+            continue;
+        }
+        
+        bench_entry_t entries[BENCH_MAX_ENTRIES];
+        int count = 0;
+        int first_u8 = add_width_entries(entries, &count);
+        bench_entries(file, "input_width", &frame, entries, count);
+        
+        double best_int_time = best_median(entries, 0, first_u8);
+        double best_u8_time = best_median(entries, first_u8, count);
+        fprintf(file, "  Best int32: %.6f ms, best uint8: %.6f ms, speedup: %.2fx\n\n",
+                best_int_time * 1000.0, best_u8_time * 1000.0, best_int_time / best_u8_time);
+        printf("    Best int32: %.6f ms, best uint8: %.6f ms, speedup: %.2fx\n",
+               best_int_time * 1000.0, best_u8_time * 1000.0, best_int_time / best_u8_time);
+        
+        bench_frame_free(&frame);
+    }
+    printf("\n");
+}
+
+// Sweep frame sizes from min_side to max_side, doubling each step. Every
+// step runs a square frame and a non-square frame whose width is not a
+// multiple of 16, so the SIMD tails are timed too. Covers every supported
+// int and uint8_t kernel.
+void run_size_sweep(FILE *file, int min_side, int max_side) {
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Size Sweep: %d to %d pixels per side (median per-call times)\n", min_side, max_side);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Size sweep %d..%d...\n", min_side, max_side);
+    
+    for (int side = min_side; side <= max_side; side *= 2) {
+        int shapes[2][2] = {{side, side}, {side / 2 + 1, side + 7}};  // height x width
+        for (int shape = 0; shape < 2; shape++) {
+            bench_frame_t frame;
+            if (bench_frame_alloc(file, &frame, shapes[shape][0], shapes[shape][1], 1, 0) != 0) {
+                continue;
+            }
+            
+            bench_entry_t entries[BENCH_MAX_ENTRIES];
+            int count = 0;
+            add_width_entries(entries, &count);
+            bench_entries(file, "sweep", &frame, entries, count);
+            fprintf(file, "\n");
+            
+            bench_frame_free(&frame);
+        }
+    }
+    printf("\n");
+}
+
+// Ordinary vs streaming stores for the dispatched int and uint8_t kernels,
+// from frames that fit in L2 to frames far larger than the last-level
+// cache. The crossover is the smallest frame from which streaming stays
+// faster; the dispatcher switches at nt_threshold_pixels(input bytes).
+void run_store_comparison(FILE *file) {
+    const kernel_t *kernel = selected_kernel();
+    const u8_kernel_t *u8_kernel = selected_u8_kernel();
+    long long llc = cache_llc_bytes();
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Store Mode: ordinary vs streaming (non-temporal) stores, LLC %.1f MB\n", llc / 1048576.0);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Store mode: ordinary vs streaming stores...\n");
+    
+    for (int input = 0; input < 2; input++) {
+        const char *input_name = input == 0 ? "int32" : "uint8";
+        const char *name = input == 0 ? kernel->info.name : u8_kernel->info.name;
+        const char *label = input == 0 ? kernel->info.label : u8_kernel->info.label;
+        int has_nt = input == 0 ? kernel->convert_into_nt != NULL : u8_kernel->convert_into_nt != NULL;
+        double bytes_per_pixel = input == 0 ? 8.0 : 5.0;
+        if (!has_nt) {
+            fprintf(file, "%s %s: no streaming-store variant\n\n", input_name, label);
+            continue;
+        }
+        fprintf(file, "%s %s:\n", input_name, label);
+        
+        int crossover_side = 0;
+        for (int side = 256; side <= 8192; side *= 2) {
+            bench_frame_t frame;
+            if (bench_frame_alloc(file, &frame, side, side, 1, 0) != 0) {
+                continue;
+            }
+            
+            bench_entry_t entries[2] = {
+                {.job = {.call = input == 0 ? call_int : call_u8, .kernel = kernel, .u8_kernel = u8_kernel},
+                 .input = input_name, .name = name, .label = "Ordinary", .bytes_per_pixel = bytes_per_pixel,
+                 .check = check_levels},
+                {.job = {.call = input == 0 ? call_int_nt : call_u8_nt, .kernel = kernel, .u8_kernel = u8_kernel},
+                 .input = input_name, .name = name, .tag = "nt", .label = "Streaming",
+                 .bytes_per_pixel = bytes_per_pixel, .check = check_levels},
+            };
+            bench_entries(file, "stores", &frame, entries, 2);
+            
+            double ratio = entries[1].stats.median > 0.0 ? entries[0].stats.median / entries[1].stats.median : 0.0;
+            if (ratio > 1.0 && crossover_side == 0) {
+                crossover_side = side;
+            } else if (ratio <= 1.0) {
+                crossover_side = 0;     // Must stay faster for every larger frame
+            }
+            fprintf(file, "  %.1f MB out, streaming %.2fx of ordinary\n", frame.n * 4.0 / 1048576.0, ratio);
+            
+            bench_frame_free(&frame);
+        }
+        if (crossover_side > 0) {
+            fprintf(file, "  Crossover: streaming faster from %dx%d (%.1f MB of output), IMGCVT_NT_PIXELS=%d\n",
+                    crossover_side, crossover_side, crossover_side * (double)crossover_side * 4.0 / 1048576.0,
+                    crossover_side * crossover_side);
+            printf("  %s %s: streaming stores faster from %dx%d\n", input_name, label, crossover_side,
+                   crossover_side);
+        } else {
+            fprintf(file, "  Crossover: streaming never faster at these sizes\n");
+            printf("  %s %s: streaming stores never faster\n", input_name, label);
+        }
+        fprintf(file, "\n");
+    }
+    fprintf(file, "Dispatcher threshold: %lld int32 / %lld uint8 pixels (IMGCVT_NT_PIXELS overrides)\n\n",
+            nt_threshold_pixels(sizeof(int)), nt_threshold_pixels(sizeof(uint8_t)));
+    printf("  Dispatcher threshold: %lld int32 / %lld uint8 pixels\n\n",
+           nt_threshold_pixels(sizeof(int)), nt_threshold_pixels(sizeof(uint8_t)));
+}
+
+// Two-pass baseline for the fused color kernels: an 8-bit luma frame
+// first (rounded to the nearest level), then the dispatched int kernel
+static int *two_pass_luma = NULL;
+
+static void two_pass_convert(int n, uint8_t *pixels, int channels, float *out, const luma_weights_t *weights) {
+    for (int i = 0; i < n; i++) {
+        const uint8_t *p = pixels + (size_t)i * channels;
+        two_pass_luma[i] = (weights->w[0] * p[0] + weights->w[1] * p[1] + weights->w[2] * p[2]
+                            + LUMA_WEIGHT_ONE / 2) >> LUMA_WEIGHT_BITS;
+    }
+    imgCvtGrayInttoFloat_Auto_into(n, two_pass_luma, out);
+}
+
+static void two_pass_rgb(int n, uint8_t *rgb, float *out, const luma_weights_t *weights) {
+    two_pass_convert(n, rgb, 3, out, weights);
+}
+
+static void two_pass_rgba(int n, uint8_t *rgba, float *out, const luma_weights_t *weights) {
+    two_pass_convert(n, rgba, 4, out, weights);
+}
+
+static const rgb_kernel_t two_pass_kernel = {{"two_pass", "Two-pass", 0}, two_pass_rgb, two_pass_rgba};
+
+// Fused RGB/RGBA -> float luma (BT.601) against the two-pass pipeline it
+// replaces. Every fused kernel must match the C kernel bit for bit; the
+// two-pass output differs by its 8-bit rounding, reported as max error.
+void run_rgb_comparison(FILE *file) {
+    int sizes[2] = {1000, 4000};
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Color Input: fused RGB/RGBA -> float luma (BT.601) vs two passes\n");
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Color input: fused vs two-pass...\n");
+    
+    for (int size_idx = 0; size_idx < 2; size_idx++) {
+        bench_frame_t frame;
+        if (bench_frame_alloc(file, &frame, sizes[size_idx], sizes[size_idx], 1, FRAME_RGBA | FRAME_REFERENCE) != 0) {
+            continue;
+        }
+        two_pass_luma = frame.a;    // Not an input here
+        
+        for (int channels = 3; channels <= 4; channels++) {
+            const char *input = channels == 3 ? "rgb8" : "rgba8";
+            if (channels == 3) {
+                imgCvtGrayRGBtoFloat_C_into(frame.n, frame.a8, frame.reference, &luma_bt601);
+            } else {
+                imgCvtGrayRGBAtoFloat_C_into(frame.n, frame.a8, frame.reference, &luma_bt601);
+            }
+            
+            bench_entry_t entries[BENCH_MAX_ENTRIES];
+            int count = 0;
+            for (int k = -1; k < num_rgb_kernels; k++) {
+                const rgb_kernel_t *kernel = k < 0 ? &two_pass_kernel : &rgb_kernels[k];
+                if (kernel_supported(&kernel->info)) {
+                    add_entry(entries, &count, (bench_entry_t){
+                              .job = {.call = channels == 4 ? call_rgba : call_rgb, .rgb_kernel = kernel},
+                              .input = input, .name = kernel->info.name, .label = kernel->info.label,
+                              .bytes_per_pixel = channels + 4.0, .check = k < 0 ? NULL : check_reference});
+                }
+            }
+            bench_entries(file, "color", &frame, entries, count);
+            
+            // The two-pass output differs from the fused one by its 8-bit rounding
+            (channels == 4 ? two_pass_rgba : two_pass_rgb)(frame.n, frame.a8, frame.out, &luma_bt601);
+            double max_error = 0.0;
+            for (int i = 0; i < frame.n; i++) {
+                double error = fabs((double)frame.out[i] - frame.reference[i]);
+                if (error > max_error) max_error = error;
+            }
+            double two_pass_time = entries[0].stats.median, best_fused_time = best_median(entries, 1, count);
+            fprintf(file, "  %-5s two-pass max error %.5f, best fused vs two-pass: %.2fx\n", input, max_error,
+                    best_fused_time > 0.0 ? two_pass_time / best_fused_time : 0.0);
+            printf("    %-5s two-pass %.6f ms, best fused %.6f ms, speedup %.2fx\n", input,
+                   two_pass_time * 1000.0, best_fused_time * 1000.0,
+                   best_fused_time > 0.0 ? two_pass_time / best_fused_time : 0.0);
+        }
+        fprintf(file, "\n");
+        
+        two_pass_luma = NULL;
+        bench_frame_free(&frame);
+    }
+    printf("\n");
+}
+
+// Two-pass baseline for the affine kernels: the dispatched /255 kernel,
+// then a second pass over the floats. Only valid for divisor 255.
+static void two_pass_normalize(int n, float *out, const affine_params_t *params) {
+    for (int i = 0; i < n; i++) {
+        out[i] = (out[i] - params->mean) * params->inv_std;
+    }
+}
+
+static void two_pass_affine_u8(int n, uint8_t *a, float *out, const affine_params_t *params) {
+    imgCvtGrayU8toFloat_Auto_into(n, a, out);
+    two_pass_normalize(n, out, params);
+}
+
+static void two_pass_affine_int(int n, int *a, float *out, const affine_params_t *params) {
+    imgCvtGrayInttoFloat_Auto_into(n, a, out);
+    two_pass_normalize(n, out, params);
+}
+
+static const affine_kernel_t two_pass_affine_kernel = {.info = {"two_pass", "Two-pass", 0}, .u8_into = two_pass_affine_u8,
+                                                       .int_into = two_pass_affine_int};
+
+// Affine transform kernels against the kernels and pipeline they
+// generalize. With affine_unit every affine kernel must give the same bits
+// as the /255 C kernel, and is timed next to the dispatched /255 kernel.
+// With a mean/std normalization (mean 0.449, std 0.226 on 0-1 values) the
+// fused kernels must match the C instantiation and are compared with the
+// two-pass pipeline, which rounds the same way and so matches too. The
+// half and bfloat16 outputs of the normalization are timed as well, and
+// must be that float reference rounded by float_to_half / float_to_bf16.
+void run_affine_comparison(FILE *file) {
+    int sizes[2] = {1000, 4000};
+    affine_params_t normalize;
+    make_affine_params(255.0, 0.449, 0.226, &normalize);
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Affine Transform: (v / divisor - mean) * inv_std in one pass\n");
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Affine transform: unit vs /255 kernels, normalization vs two passes...\n");
+    
+    for (int size_idx = 0; size_idx < 2; size_idx++) {
+        bench_frame_t frame;
+        if (bench_frame_alloc(file, &frame, sizes[size_idx], sizes[size_idx], 1, FRAME_REFERENCE) != 0) {
+            continue;
+        }
+        
+        for (int input = 0; input < 2; input++) {
+            const char *input_name = input == 0 ? "int32" : "uint8";
+            double in_bytes = input == 0 ? 4.0 : 1.0;
+            
+            // Unit parameters against the dispatched /255 kernel
+            if (input == 0) {
+                imgCvtGrayInttoFloat_C_into(frame.n, frame.a, frame.reference);
+            } else {
+                imgCvtGrayU8toFloat_C_into(frame.n, frame.a8, frame.reference);
+            }
+            char divide_label[32];
+            snprintf(divide_label, sizeof(divide_label), "/255 %s",
+                     input == 0 ? selected_kernel()->info.label : selected_u8_kernel()->info.label);
+            bench_entry_t entries[BENCH_MAX_ENTRIES];
+            int count = 0;
+            add_entry(entries, &count, (bench_entry_t){
+                      .job = {.call = input == 0 ? call_int : call_u8, .kernel = selected_kernel(),
+                              .u8_kernel = selected_u8_kernel()},
+                      .input = input_name, .name = "divide_255", .label = divide_label,
+                      .bytes_per_pixel = in_bytes + 4.0, .check = check_reference});
+            for (int k = 0; k < num_affine_kernels; k++) {
+                if (kernel_supported(&affine_kernels[k].info)) {
+                    add_entry(entries, &count, (bench_entry_t){
+                              .job = {.call = input == 0 ? call_affine_int : call_affine_u8,
+                                      .affine_kernel = &affine_kernels[k], .affine = &affine_unit},
+                              .input = input_name, .name = affine_kernels[k].info.name, .tag = "unit",
+                              .label = affine_kernels[k].info.label, .bytes_per_pixel = in_bytes + 4.0,
+                              .check = check_reference});
+                }
+            }
+            bench_entries(file, "affine", &frame, entries, count);
+            double divide_time = entries[0].stats.median, best_unit_time = best_median(entries, 1, count);
+            
+            // Normalization against the two-pass pipeline, to float and to
+            // 16-bit output
+            if (input == 0) {
+                imgCvtGrayInttoFloat_Affine_C_into(frame.n, frame.a, frame.reference, &normalize);
+            } else {
+                imgCvtGrayU8toFloat_Affine_C_into(frame.n, frame.a8, frame.reference, &normalize);
+            }
+            count = 0;
+            for (int k = -1; k < num_affine_kernels; k++) {
+                const affine_kernel_t *kernel = k < 0 ? &two_pass_affine_kernel : &affine_kernels[k];
+                if (kernel_supported(&kernel->info)) {
+                    add_entry(entries, &count, (bench_entry_t){
+                              .job = {.call = input == 0 ? call_affine_int : call_affine_u8, .affine_kernel = kernel,
+                                      .affine = &normalize},
+                              .input = input_name, .name = kernel->info.name, .tag = "norm",
+                              .label = kernel->info.label, .bytes_per_pixel = in_bytes + 4.0,
+                              .check = check_reference});
+                }
+            }
+            int fused_end = count;
+            for (int k = 0; k < num_affine_kernels; k++) {
+                if (!kernel_supported(&affine_kernels[k].info)) {
+                    continue;
+                }
+                add_entry(entries, &count, (bench_entry_t){
+                          .job = {.call = input == 0 ? call_affine_half_int : call_affine_half_u8,
+                                  .affine_kernel = &affine_kernels[k], .affine = &normalize},
+                          .input = input_name, .name = affine_kernels[k].info.name, .tag = "norm_f16",
+                          .label = affine_kernels[k].info.label, .bytes_per_pixel = in_bytes + 2.0,
+                          .check = check_reference_half});
+                add_entry(entries, &count, (bench_entry_t){
+                          .job = {.call = input == 0 ? call_affine_bf16_int : call_affine_bf16_u8,
+                                  .affine_kernel = &affine_kernels[k], .affine = &normalize},
+                          .input = input_name, .name = affine_kernels[k].info.name, .tag = "norm_bf16",
+                          .label = affine_kernels[k].info.label, .bytes_per_pixel = in_bytes + 2.0,
+                          .check = check_reference_bf16});
+            }
+            bench_entries(file, "affine", &frame, entries, count);
+            double two_pass_time = entries[0].stats.median, best_fused_time = best_median(entries, 1, fused_end);
+            
+            fprintf(file, "  %-5s best unit vs /255: %.2fx, best fused vs two-pass: %.2fx\n", input_name,
+                    best_unit_time > 0.0 ? divide_time / best_unit_time : 0.0,
+                    best_fused_time > 0.0 ? two_pass_time / best_fused_time : 0.0);
+            printf("    %-5s unit %.2fx of /255, normalization %.2fx faster than two passes\n", input_name,
+                   best_unit_time > 0.0 ? divide_time / best_unit_time : 0.0,
+                   best_fused_time > 0.0 ? two_pass_time / best_fused_time : 0.0);
+        }
+        fprintf(file, "\n");
+        
+        bench_frame_free(&frame);
+    }
+    printf("\n");
+}
+
+// 16-bit output (IEEE half and bfloat16) against float32 output on large
+// frames, for int and uint8_t input. Every 16-bit kernel must match the C
+// kernel bit for bit and stay within the format's rounding error.
+void run_half_comparison(FILE *file) {
+    int sizes[3] = {1000, 4000, 8192};
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Output Precision: float32 vs IEEE half / bfloat16\n");
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Output precision: float32 vs 16-bit...\n");
+    
+    for (int size_idx = 0; size_idx < 3; size_idx++) {
+        bench_frame_t frame;
+        if (bench_frame_alloc(file, &frame, sizes[size_idx], sizes[size_idx], 1, 0) != 0) {
+            continue;
+        }
+        
+        for (int input = 0; input < 2; input++) {
+            const char *input_name = input == 0 ? "int32" : "uint8";
+            double in_bytes = input == 0 ? 4.0 : 1.0;
+            
+            bench_entry_t entries[BENCH_MAX_ENTRIES];
+            int count = 0;
+            add_entry(entries, &count, (bench_entry_t){
+                      .job = {.call = input == 0 ? call_int : call_u8, .kernel = selected_kernel(),
+                              .u8_kernel = selected_u8_kernel()},
+                      .input = input_name, .name = "float32",
+                      .label = input == 0 ? selected_kernel()->info.label : selected_u8_kernel()->info.label,
+                      .bytes_per_pixel = in_bytes + 4.0, .check = check_levels});
+            int first[2], end[2];
+            for (int bf16 = 0; bf16 <= 1; bf16++) {
+                first[bf16] = count;
+                for (int k = 0; k < num_half_kernels; k++) {
+                    if (kernel_supported(&half_kernels[k].info)) {
+                        add_entry(entries, &count, (bench_entry_t){
+                                  .job = {.call = input == 0 ? (bf16 ? call_bf16_int : call_half_int)
+                                                             : (bf16 ? call_bf16_u8 : call_half_u8),
+                                          .half_kernel = &half_kernels[k]},
+                                  .input = input_name, .name = half_kernels[k].info.name,
+                                  .tag = bf16 ? "bf16" : "f16", .label = half_kernels[k].info.label,
+                                  .bytes_per_pixel = in_bytes + 2.0, .check = bf16 ? check_bf16 : check_half});
+                    }
+                }
+                end[bf16] = count;
+            }
+            bench_entries(file, "half", &frame, entries, count);
+            
+            double float_time = entries[0].stats.median;
+            for (int bf16 = 0; bf16 <= 1; bf16++) {
+                const char *format = bf16 ? "bf16" : "f16";
+                double best_time = best_median(entries, first[bf16], end[bf16]);
+                fprintf(file, "  %-5s best %s vs float32: %.2fx\n", input_name, format,
+                        best_time > 0.0 ? float_time / best_time : 0.0);
+                printf("    %-5s %-4s %.2fx of float32 speed\n", input_name, format,
+                       best_time > 0.0 ? float_time / best_time : 0.0);
+            }
+        }
+        fprintf(file, "\n");
+        
+        bench_frame_free(&frame);
+    }
+    printf("\n");
+}
+
+// int -> float -> int must give back every 8-bit level, whichever forward
+// and inverse kernels are combined. Returns the number of failing pairs.
+int run_round_trip_test(FILE *file) {
+    int levels[256];
+    uint8_t levels8[256];
+    for (int v = 0; v < 256; v++) {
+        levels[v] = v;
+        levels8[v] = (uint8_t)v;
+    }
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Round Trip: int -> float -> int for all 256 levels\n");
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    
+    int pairs = 0, failures = 0;
+    for (int f = 0; f < num_kernels + num_u8_kernels; f++) {
+        const kernel_info_t *forward = f < num_kernels ? &kernels[f].info : &u8_kernels[f - num_kernels].info;
+        if (!kernel_supported(forward)) {
+            continue;
+        }
+        float floats[256];
+        if (f < num_kernels) {
+            kernels[f].convert_into(256, levels, floats);
+        } else {
+            u8_kernels[f - num_kernels].convert_into(256, levels8, floats);
+        }
+        
+        for (int k = 0; k < num_inverse_kernels; k++) {
+            if (!kernel_supported(&inverse_kernels[k].info)) {
+                continue;
+            }
+            int back[256];
+            uint8_t back8[256];
+            inverse_kernels[k].to_int(256, floats, back);
+            inverse_kernels[k].to_u8(256, floats, back8);
+            int ok = memcmp(back, levels, sizeof(levels)) == 0 && memcmp(back8, levels8, sizeof(levels8)) == 0;
+            pairs++;
+            if (!ok) {
+                failures++;
+                fprintf(file, "  %s %s -> %s: FAILED\n", f < num_kernels ? "int32" : "uint8", forward->label,
+                        inverse_kernels[k].info.label);
+            }
+        }
+    }
+    fprintf(file, "  %d forward/inverse kernel pairs, %d failed: %s\n\n", pairs, failures,
+            failures == 0 ? "PASSED" : "FAILED");
+    printf("Round trip int -> float -> int (%d kernel pairs): %s\n\n", pairs, failures == 0 ? "PASSED" : "FAILED");
+    return failures;
+}
+
+// Differential verification
+// Every float-output /255 kernel variant (the int and uint8_t tables, their
+// streaming-store and in-place versions, and the affine kernels with
+// affine_unit) runs
+// on the same input and is checked against the exact reference and
+// against every other variant. The first DIFF_LEVEL_CASES cases put all 256
+// levels in every lane position, at every output misalignment; the next
+// are random frames of random size at random misalignments. The last
+// DIFF_WIDE_CASES mix in ints outside 0-255 (up to 65535, negatives, and
+// values near INT_MAX and INT_MIN); they only run the variants that take
+// any int, not the LUT kernels (which clamp) or uint8_t input. Guard values
+// on both sides of each output catch writes outside [0, n).
+#define DIFF_MAX_VARIANTS   48
+#define DIFF_LEVEL_CASES    16
+#define DIFF_RANDOM_CASES   300
+#define DIFF_WIDE_CASES     64
+#define DIFF_MAX_PIXELS     4096    // 16 rounds of the 256 levels
+#define DIFF_RANDOM_PIXELS  1100
+#define DIFF_GUARD          16      // Guard floats on each side of an output
+#define DIFF_GUARD_BITS     0x7FC0DEADu
+
+typedef struct {
+    char label[32];
+    const kernel_t *kernel;                 // Exactly one of the three is set
+    const u8_kernel_t *u8_kernel;
+    const affine_kernel_t *affine_kernel;
+    int u8_input;                           // Affine kernels: uint8_t instead of int input
+    int streaming;                          // Streaming-store variant
+    int inplace;                            // In-place variant: input copied to out first
+    int levels_only;                        // Defined for 0-255 input only: no wide cases
+    float *buffer;                          // Output with guards
+    float *out;
+    long long mismatches;
+    unsigned int max_ulp;
+    int guard_failures;
+    int failed_case;                        // First failing case, -1 if none
+    verify_result_t first_failure;
+} diff_variant_t;
+
+static void diff_run(const diff_variant_t *v, int n, int *a, uint8_t *a8) {
+    if (v->affine_kernel != NULL && v->u8_input) {
+        v->affine_kernel->u8_into(n, a8, v->out, &affine_unit);
+    } else if (v->affine_kernel != NULL) {
+        v->affine_kernel->int_into(n, a, v->out, &affine_unit);
+    } else if (v->kernel != NULL && v->inplace) {
+        memcpy(v->out, a, (size_t)n * sizeof(int));
+        v->kernel->convert_inplace(n, (int *)v->out);
+    } else if (v->kernel != NULL && v->streaming) {
+        v->kernel->convert_into_nt(n, a, v->out);
+    } else if (v->kernel != NULL) {
+        v->kernel->convert_into(n, a, v->out);
+    } else if (v->streaming) {
+        v->u8_kernel->convert_into_nt(n, a8, v->out);
+    } else {
+        v->u8_kernel->convert_into(n, a8, v->out);
+    }
+}
+
+static int diff_guards_intact(const float *out, int n) {
+    for (int g = 1; g <= DIFF_GUARD; g++) {
+        uint32_t before, after;
+        memcpy(&before, out - g, sizeof(before));
+        memcpy(&after, out + n - 1 + g, sizeof(after));
+        if (before != DIFF_GUARD_BITS || after != DIFF_GUARD_BITS) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Every supported variant, in table order
+static int diff_collect_variants(diff_variant_t *variants) {
+    int count = 0;
+    memset(variants, 0, DIFF_MAX_VARIANTS * sizeof(diff_variant_t));
+    for (int k = 0; k < num_kernels; k++) {
+        if (!kernel_supported(&kernels[k].info)) continue;
+        int lut = strncmp(kernels[k].info.name, "lut", 3) == 0;
+        for (int nt = 0; nt <= (kernels[k].convert_into_nt != NULL) && count < DIFF_MAX_VARIANTS; nt++) {
+            snprintf(variants[count].label, sizeof(variants[count].label), "int32 %s%s", kernels[k].info.label, nt ? " NT" : "");
+            variants[count].kernel = &kernels[k];
+            variants[count].levels_only = lut;
+            variants[count++].streaming = nt;
+        }
+        if (count < DIFF_MAX_VARIANTS) {
+            snprintf(variants[count].label, sizeof(variants[count].label), "int32 %s in place", kernels[k].info.label);
+            variants[count].kernel = &kernels[k];
+            variants[count].levels_only = lut;
+            variants[count++].inplace = 1;
+        }
+    }
+    for (int k = 0; k < num_u8_kernels; k++) {
+        if (!kernel_supported(&u8_kernels[k].info)) continue;
+        for (int nt = 0; nt <= (u8_kernels[k].convert_into_nt != NULL) && count < DIFF_MAX_VARIANTS; nt++) {
+            snprintf(variants[count].label, sizeof(variants[count].label), "uint8 %s%s", u8_kernels[k].info.label, nt ? " NT" : "");
+            variants[count].u8_kernel = &u8_kernels[k];
+            variants[count].levels_only = 1;
+            variants[count++].streaming = nt;
+        }
+    }
+    for (int k = 0; k < num_affine_kernels; k++) {
+        if (!kernel_supported(&affine_kernels[k].info)) continue;
+        for (int u8 = 0; u8 <= 1 && count < DIFF_MAX_VARIANTS; u8++) {
+            snprintf(variants[count].label, sizeof(variants[count].label), "%s Affine %s", u8 ? "uint8" : "int32", affine_kernels[k].info.label);
+            variants[count].affine_kernel = &affine_kernels[k];
+            variants[count].levels_only = u8;
+            variants[count++].u8_input = u8;
+        }
+    }
+    return count;
+}
+
+// An int for the wide cases: a level, 256-65535, a negative, a value
+// within 2^30 of INT_MAX or INT_MIN, or one of the edges in between.
+// Two rand() calls, as RAND_MAX may be 32767.
+static int diff_wide_value(void) {
+    static const int edges[] = {256, 509, 65535, 65536, 16777216, 16777217, -1, -255, -256,
+                                INT_MAX, INT_MAX - 1, INT_MIN, INT_MIN + 1};
+    int r = ((rand() & 0x7FFF) << 15) | (rand() & 0x7FFF);
+    switch (rand() % 6) {
+    case 0:  return r & 255;
+    case 1:  return 256 + r % (65536 - 256);
+    case 2:  return -1 - r % 65536;
+    case 3:  return INT_MAX - r;
+    case 4:  return INT_MIN + r;
+    default: return edges[r % (int)(sizeof(edges) / sizeof(edges[0]))];
+    }
+}
+
+// The scalar check performance_test used before the SIMD verifier, kept
+// to report what verification used to cost
+static int scalar_check(const int *int_array, const float *float_array, int n) {
+    for (int i = 0; i < n; i++) {
+        if (float_array[i] != (float)int_array[i] / 255.0f) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Returns the number of failing variants plus the number of variant pairs
+// whose outputs ever differ
+int run_differential_test(FILE *file) {
+    static diff_variant_t variants[DIFF_MAX_VARIANTS];
+    static int pair_diffs[DIFF_MAX_VARIANTS][DIFF_MAX_VARIANTS];
+    int num_variants = diff_collect_variants(variants);
+    int num_cases = DIFF_LEVEL_CASES + DIFF_RANDOM_CASES + DIFF_WIDE_CASES;
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Differential Verification: %d kernel variants, %d cases (%d with ints outside 0-255)\n",
+            num_variants, num_cases, DIFF_WIDE_CASES);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Differential verification (%d kernel variants, %d cases)...\n", num_variants, num_cases);
+    
+    int *int_buffer = (int *)malloc((DIFF_MAX_PIXELS + 16) * sizeof(int));
+    uint8_t *u8_buffer = (uint8_t *)malloc(DIFF_MAX_PIXELS + 64);
+    int allocated = int_buffer != NULL && u8_buffer != NULL;
+    for (int v = 0; v < num_variants; v++) {
+        variants[v].buffer = alloc_float_buffer(DIFF_MAX_PIXELS + 2 * DIFF_GUARD + 16);
+        variants[v].failed_case = -1;
+        allocated = allocated && variants[v].buffer != NULL;
+    }
+    if (!allocated) {
+        fprintf(file, "Memory allocation failed\n\n");
+        printf("  Memory allocation failed\n\n");
+        free(int_buffer);
+        free(u8_buffer);
+        for (int v = 0; v < num_variants; v++) free_float_buffer(variants[v].buffer);
+        return 1;
+    }
+    memset(pair_diffs, 0, sizeof(pair_diffs));
+    
+    for (int c = 0; c < num_cases; c++) {
+        int n, in_offset, u8_offset, out_offset;
+        int wide = c >= DIFF_LEVEL_CASES + DIFF_RANDOM_CASES;
+        if (c < DIFF_LEVEL_CASES) {
+            // Level v of round r sits at lane (v - r) % 16: every level in every lane
+            n = DIFF_MAX_PIXELS;
+            in_offset = u8_offset = out_offset = c;
+            for (int i = 0; i < n; i++) int_buffer[in_offset + i] = (i + i / 256) & 255;
+        } else {
+            n = rand() % DIFF_RANDOM_PIXELS;
+            in_offset = rand() % 16;
+            u8_offset = rand() % 64;
+            out_offset = rand() % 16;
+            for (int i = 0; i < n; i++) int_buffer[in_offset + i] = wide ? diff_wide_value() : rand() % 256;
+        }
+        int *a = int_buffer + in_offset;
+        uint8_t *a8 = u8_buffer + u8_offset;
+        for (int i = 0; i < n; i++) a8[i] = (uint8_t)a[i];
+        
+        for (int v = 0; v < num_variants; v++) {
+            diff_variant_t *variant = &variants[v];
+            if (wide && variant->levels_only) continue;
+            uint32_t guard = DIFF_GUARD_BITS;
+            for (int i = 0; i < DIFF_MAX_PIXELS + 2 * DIFF_GUARD + 16; i++) {
+                memcpy(&variant->buffer[i], &guard, sizeof(guard));
+            }
+            variant->out = variant->buffer + DIFF_GUARD + out_offset;
+            diff_run(variant, n, a, a8);
+            
+            verify_result_t result;
+            long long mismatches = verify_int_to_float(n, a, variant->out, &result);
+            int guards_ok = diff_guards_intact(variant->out, n);
+            variant->mismatches += mismatches;
+            if (result.max_ulp > variant->max_ulp) variant->max_ulp = result.max_ulp;
+            if (!guards_ok) variant->guard_failures++;
+            if ((mismatches > 0 || !guards_ok) && variant->failed_case < 0) {
+                variant->failed_case = c;
+                variant->first_failure = result;
+                fprintf(file, "  %s: case %d (n=%d, input +%d, output +%d) failed: %lld mismatches",
+                        variant->label, c, n, in_offset, out_offset, mismatches);
+                if (result.first_mismatch >= 0) {
+                    fprintf(file, ", first at %lld: expected %.9g, got %.9g", result.first_mismatch,
+                            result.expected, result.actual);
+                }
+                fprintf(file, "%s\n", guards_ok ? "" : ", wrote outside the output");
+            }
+            
+            for (int w = 0; w < v; w++) {
+                if (wide && variants[w].levels_only) continue;
+                if (verify_floats(n, variants[w].out, variant->out, NULL) > 0) {
+                    pair_diffs[w][v]++;
+                }
+            }
+        }
+    }
+    
+    int failures = 0;
+    for (int v = 0; v < num_variants; v++) {
+        int ok = variants[v].failed_case < 0;
+        fprintf(file, "  %-26s max %u ulp  %lld mismatches  %d guard failures  %s\n", variants[v].label,
+                variants[v].max_ulp, variants[v].mismatches, variants[v].guard_failures, ok ? "PASSED" : "FAILED");
+        if (!ok) {
+            failures++;
+            printf("  %s: FAILED (max %u ulp, %lld mismatches, %d guard failures)\n", variants[v].label,
+                   variants[v].max_ulp, variants[v].mismatches, variants[v].guard_failures);
+        }
+    }
+    int pairs = 0, differing_pairs = 0;
+    for (int v = 0; v < num_variants; v++) {
+        for (int w = 0; w < v; w++) {
+            pairs++;
+            if (pair_diffs[w][v] > 0) {
+                differing_pairs++;
+                fprintf(file, "  %s vs %s: differ in %d cases\n", variants[w].label, variants[v].label, pair_diffs[w][v]);
+            }
+        }
+    }
+    fprintf(file, "  %d variant pairs compared, %d differ: %s\n", pairs, differing_pairs,
+            differing_pairs == 0 ? "PASSED" : "FAILED");
+    printf("  %d variants, %d failed; %d pairs, %d differ\n", num_variants, failures, pairs, differing_pairs);
+    
+    free(int_buffer);
+    free(u8_buffer);
+    for (int v = 0; v < num_variants; v++) {
+        free_float_buffer(variants[v].buffer);
+    }
+    
+    // What a check of a 4000x4000 frame costs, against the conversion itself
+    int total_elements = 4000 * 4000;
+    int *int_array = (int *)malloc((size_t)total_elements * sizeof(int));
+    float *float_array = alloc_float_buffer(total_elements);
+    if (int_array != NULL && float_array != NULL) {
+        for (int i = 0; i < total_elements; i++) {
+            int_array[i] = rand() % 256;
+        }
+        double best[3] = {0.0, 0.0, 0.0};
+        int checks_ok = 1;
+        for (int run = 0; run < 5; run++) {
+            double start_time = get_time();
+            imgCvtGrayInttoFloat_Auto_into(total_elements, int_array, float_array);
+            double convert_time = get_time() - start_time;
+            start_time = get_time();
+            checks_ok &= scalar_check(int_array, float_array, total_elements);
+            double scalar_time = get_time() - start_time;
+            start_time = get_time();
+            checks_ok &= verify_int_to_float(total_elements, int_array, float_array, NULL) == 0;
+            double verify_time = get_time() - start_time;
+            if (run == 0 || convert_time < best[0]) best[0] = convert_time;
+            if (run == 0 || scalar_time < best[1]) best[1] = scalar_time;
+            if (run == 0 || verify_time < best[2]) best[2] = verify_time;
+        }
+        fprintf(file, "  Checking a 4000x4000 frame (best of 5): conversion %.3f ms, scalar check %.3f ms, "
+                "verify_int_to_float %.3f ms  %s\n", best[0] * 1000.0, best[1] * 1000.0, best[2] * 1000.0,
+                checks_ok ? "PASSED" : "FAILED");
+        printf("  4000x4000: conversion %.3f ms, scalar check %.3f ms, SIMD verify %.3f ms\n",
+               best[0] * 1000.0, best[1] * 1000.0, best[2] * 1000.0);
+    }
+    free(int_array);
+    free_float_buffer(float_array);
+    fprintf(file, "\n");
+    printf("\n");
+    return failures + differing_pairs;
+}
+
+// Inverse kernels (float -> uint8_t / int) on 1000x1000 and 4000x4000
+// frames of converted 8-bit levels. Every kernel must give back the
+// original levels.
+void run_inverse_comparison(FILE *file) {
+    int sizes[2] = {1000, 4000};
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Inverse Conversion: float -> 8-bit levels\n");
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Inverse conversion: float -> uint8/int32...\n");
+    
+    for (int size_idx = 0; size_idx < 2; size_idx++) {
+        bench_frame_t frame;
+        if (bench_frame_alloc(file, &frame, sizes[size_idx], sizes[size_idx], 1, 0) != 0) {
+            continue;
+        }
+        int *int_out = (int *)calloc((size_t)frame.n, sizeof(int));
+        uint8_t *u8_out = (uint8_t *)calloc((size_t)frame.n, 1);
+        if (int_out == NULL || u8_out == NULL) {
+            fprintf(file, "  Memory allocation failed\n\n");
+            free(int_out);
+            free(u8_out);
+            bench_frame_free(&frame);
+            continue;
+        }
+        imgCvtGrayInttoFloat_C_into(frame.n, frame.a, frame.out);
+        
+        for (int output = 0; output < 2; output++) {
+            const char *output_name = output == 0 ? "int32" : "uint8";
+            bench_entry_t entries[BENCH_MAX_ENTRIES];
+            int count = 0;
+            for (int k = 0; k < num_inverse_kernels; k++) {
+                if (kernel_supported(&inverse_kernels[k].info)) {
+                    add_entry(entries, &count, (bench_entry_t){
+                              .job = {.call = output == 0 ? call_inverse_int : call_inverse_u8, .a = int_out,
+                                      .a8 = u8_out, .inverse_kernel = &inverse_kernels[k]},
+                              .input = output_name, .name = inverse_kernels[k].info.name,
+                              .label = inverse_kernels[k].info.label, .bytes_per_pixel = output == 0 ? 8.0 : 5.0,
+                              .check = output == 0 ? check_inverse_int : check_inverse_u8});
+                }
+            }
+            bench_entries(file, "inverse", &frame, entries, count);
+            
+            // The C kernel is always supported and comes first
+            double c_time = entries[0].stats.median, best_time = best_median(entries, 1, count);
+            fprintf(file, "  %-5s best SIMD vs C: %.2fx\n", output_name, best_time > 0.0 ? c_time / best_time : 0.0);
+            printf("    %-5s C %.6f ms, best SIMD %.6f ms, speedup %.2fx\n", output_name, c_time * 1000.0,
+                   best_time * 1000.0, best_time > 0.0 ? c_time / best_time : 0.0);
+        }
+        fprintf(file, "\n");
+        
+        free(int_out);
+        free(u8_out);
+        bench_frame_free(&frame);
+    }
+    printf("\n");
+}
+
+// Many small frames: the current API called once per frame against the
+// batch entry points, reported per frame
+void run_batch_comparison(FILE *file) {
+    int sides[4] = {8, 10, 32, 64};
+    int num_frames = 4096;
+    const char *names[5] = {"loop-alloc", "loop-into", "batch-into", "batch-alloc", "packed"};
+    const char *labels[5] = {"_Auto per frame", "_Auto_into per frame", "convert_batch_into",
+                             "convert_batch", "convert_packed_into"};
+    void (*calls[5])(const bench_job_t *job) = {call_batch_loop_alloc, call_batch_loop_into, call_batch_into,
+                                                call_batch_alloc, call_batch_packed};
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Batch Conversion: %d frames per call, %s kernel\n", num_frames, selected_kernel()->info.label);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Batch conversion (%d frames)...\n", num_frames);
+    
+    for (int size_idx = 0; size_idx < 4; size_idx++) {
+        int side = sides[size_idx];
+        int frame_pixels = side * side;
+        bench_frame_t frame;
+        if (bench_frame_alloc(file, &frame, side, side, num_frames, 0) != 0) {
+            continue;
+        }
+        
+        gray_frame_t *frames = (gray_frame_t *)malloc((size_t)num_frames * sizeof(gray_frame_t));
+        gray_frame_t *scratch = (gray_frame_t *)malloc((size_t)num_frames * sizeof(gray_frame_t));
+        int *offsets = (int *)malloc((size_t)(num_frames + 1) * sizeof(int));
+        float *batch_out = NULL;
+        if (frames != NULL) {
+            for (int f = 0; f < num_frames; f++) {
+                frames[f].pixels = frame.a + (size_t)f * frame_pixels;
+                frames[f].n = frame_pixels;
+            }
+            batch_out = convert_batch(frames, num_frames, 4);
+        }
+        if (scratch == NULL || offsets == NULL || batch_out == NULL) {
+            fprintf(file, "  Memory allocation failed\n\n");
+            free(frames);
+            free(scratch);
+            free(offsets);
+            free_float_buffer(batch_out);
+            bench_frame_free(&frame);
+            continue;
+        }
+        memcpy(scratch, frames, (size_t)num_frames * sizeof(gray_frame_t));
+        for (int f = 0; f <= num_frames; f++) {
+            offsets[f] = f * frame_pixels;
+        }
+        
+        // convert_batch has filled every view; check them and the packed path
+        int ok = convert_packed_into(frame.a, offsets, num_frames, 4, frame.out) == 0 &&
+                 check_correctness(frame.a, frame.out, frame.n);
+        for (int f = 0; f < num_frames && ok; f++) {
+            ok = check_correctness((int *)frames[f].pixels, frames[f].out, frame_pixels) &&
+                 (uintptr_t)frames[f].out % BUFFER_ALIGNMENT == 0;
+        }
+        fprintf(file, "  convert_batch views and packed output: %s\n", ok ? "PASSED" : "FAILED");
+        if (!ok) printf("    FAILED\n");
+        
+        bench_entry_t entries[6];
+        for (int mode = 0; mode < 5; mode++) {
+            // The allocating modes repoint out, so they get their own frame list.
+            // The batch entry points (modes 2-4) may use the thread pool.
+            gray_frame_t *mode_frames = calls[mode] == call_batch_loop_alloc || calls[mode] == call_batch_alloc
+                                        ? scratch : frames;
+            entries[mode] = (bench_entry_t){.job = {.call = calls[mode], .threaded = mode >= 2, .frames = mode_frames,
+                                                    .num_frames = num_frames, .offsets = offsets},
+                                            .input = "int32", .name = names[mode], .label = labels[mode],
+                                            .bytes_per_pixel = 8.0};
+        }
+        bench_entries(file, "batch", &frame, entries, 5);
+        
+        // The same batch spread across the thread pool
+        int threads = parallel_init(0);
+        char threaded_label[32];
+        snprintf(threaded_label, sizeof(threaded_label), "convert_batch_into, %d thr", threads);
+        entries[5] = (bench_entry_t){.job = {.call = call_batch_into, .threaded = 1, .frames = frames,
+                                             .num_frames = num_frames, .offsets = offsets},
+                                     .input = "int32", .name = "batch-into", .label = threaded_label,
+                                     .bytes_per_pixel = 8.0, .threads = threads};
+        bench_entries(file, "batch", &frame, entries + 5, 1);
+        parallel_shutdown();
+        
+        double loop_time = entries[0].stats.median;
+        for (int e = 0; e < 6; e++) {
+            double per_frame_ns = entries[e].stats.median / num_frames * 1e9;
+            double speedup = entries[e].stats.median > 0.0 ? loop_time / entries[e].stats.median : 0.0;
+            fprintf(file, "  %-26s %10.1f ns/frame  vs loop %.2fx\n", entries[e].label, per_frame_ns, speedup);
+            printf("    %-26s %10.1f ns/frame, vs loop %.2fx\n", entries[e].label, per_frame_ns, speedup);
+        }
+        fprintf(file, "\n");
+        
+        free(frames);
+        free(scratch);
+        free(offsets);
+        free_float_buffer(batch_out);
+        bench_frame_free(&frame);
+    }
+    printf("\n");
+}
+
+// Steady-state cost of a frame that allocates its output, converts and
+// releases it: malloc/free against the buffer pool, with the plain
+// conversion into a reused buffer as the floor
+void run_pool_comparison(FILE *file) {
+    int sizes[3] = {256, 1000, 4096};
+    const char *names[4] = {"into", "malloc", "pool", "pool-huge"};
+    const char *labels[4] = {"_Auto_into (reused)", "_Auto + free", "_Pooled + pool_free", "_Pooled, huge pages"};
+    void (*calls[4])(const bench_job_t *job) = {call_int, call_alloc_malloc, call_alloc_pool, call_alloc_pool};
+    int (*checks[4])(const bench_frame_t *frame, const bench_job_t *job) = {check_levels, check_alloc_malloc,
+                                                                           check_alloc_pool, check_alloc_pool};
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Output Allocation: malloc vs buffer pool, %s kernel\n", selected_kernel()->info.label);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Output allocation: malloc vs buffer pool...\n");
+    
+    for (int size_idx = 0; size_idx < 3; size_idx++) {
+        bench_frame_t frame;
+        if (bench_frame_alloc(file, &frame, sizes[size_idx], sizes[size_idx], 1, 0) != 0) {
+            continue;
+        }
+        
+        bench_entry_t entries[4];
+        pool_stats_t pool_stats[4] = {{0, 0, 0}};
+        for (int mode = 0; mode < 4; mode++) {
+            entries[mode] = (bench_entry_t){.job = {.call = calls[mode], .kernel = selected_kernel()},
+                                            .input = "int32", .name = names[mode], .label = labels[mode],
+                                            .bytes_per_pixel = 8.0, .check = checks[mode]};
+            // Each pooled mode gets a fresh pool, so its hit count is its own
+            if (mode >= 2) {
+                pool_init(0, mode == 3 ? 1 : -1);
+            }
+            bench_entries(file, "pool", &frame, &entries[mode], 1);
+            if (mode >= 2) {
+                pool_get_stats(&pool_stats[mode]);
+                pool_shutdown();
+            }
+        }
+        
+        double floor_time = entries[0].stats.median;
+        fprintf(file, "  %.1f MB output\n", frame.n * sizeof(float) / 1048576.0);
+        for (int mode = 0; mode < 4; mode++) {
+            const bench_stats_t *stats = &entries[mode].stats;
+            fprintf(file, "  %-22s p99 %10.6f ms  %5.2fx floor", labels[mode], stats->p99 * 1000.0,
+                    floor_time > 0.0 ? stats->median / floor_time : 0.0);
+            if (mode >= 2) {
+                fprintf(file, "  (%lld hits, %lld misses)", pool_stats[mode].hits, pool_stats[mode].misses);
+            }
+            fprintf(file, "\n");
+            printf("    %-22s median %.6f ms, p99 %.6f ms%s\n", labels[mode], stats->median * 1000.0,
+                   stats->p99 * 1000.0, entries[mode].ok ? "" : " (FAILED)");
+        }
+        fprintf(file, "\n");
+        
+        bench_frame_free(&frame);
+    }
+    printf("\n");
+}
+
+// Cost of writing a converted 1000x1000 frame, compared with converting it:
+// the original per-pixel fprintf("%.2f ") loop, the buffered text writer
+// and the GRF1 binary writer. Files go to output_format_test.*.
+void run_output_comparison(FILE *file) {
+    int height = 1000, width = 1000;
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Conversion vs Output: %dx%d\n", height, width);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Conversion vs output (%dx%d)...\n", height, width);
+    
+    bench_frame_t frame;
+    if (bench_frame_alloc(file, &frame, height, width, 1, 0) != 0) {
+        return;
+    }
+    bench_entry_t entry = {.job = {.call = call_int, .kernel = selected_kernel()}, .input = "int32",
+                           .name = selected_kernel()->info.name, .label = selected_kernel()->info.label,
+                           .bytes_per_pixel = 8.0, .check = check_levels};
+    bench_entries(file, "output", &frame, &entry, 1);
+    double convert_time = entry.stats.median;
+    float *float_array = frame.out;
+    
+    // Per-pixel fprintf, as automated_mode() used to write it
+    double start_time = get_time();
+    FILE *out = fopen("output_format_test.txt", "w");
+    if (out != NULL) {
+        for (int i = 0; i < height; i++) {
+            for (int j = 0; j < width; j++) {
+                fprintf(out, "%.2f ", float_array[i * width + j]);
+            }
+            fprintf(out, "\n");
+        }
+        fclose(out);
+    }
+    double fprintf_time = get_time() - start_time;
+    
+    start_time = get_time();
+    out = fopen("output_format_test.txt", "w");
+    int text_ok = out != NULL && write_float_text(out, float_array, height, width) == 0;
+    if (out != NULL) fclose(out);
+    double text_time = get_time() - start_time;
+    
+    start_time = get_time();
+    out = fopen("output_format_test.bin", "wb");
+    int binary_ok = out != NULL && write_float_binary(out, float_array, height, width) == 0;
+    if (out != NULL) fclose(out);
+    double binary_time = get_time() - start_time;
+    
+    fprintf(file, "  Text, per-pixel fprintf     %10.3f ms\n", fprintf_time * 1000.0);
+    fprintf(file, "  Text, buffered writer       %10.3f ms  %s\n", text_time * 1000.0, text_ok ? "" : "FAILED");
+    fprintf(file, "  Binary float32 (GRF1)       %10.3f ms  %s\n\n", binary_time * 1000.0, binary_ok ? "" : "FAILED");
+    printf("  Conversion: %.3f ms, fprintf text: %.3f ms, buffered text: %.3f ms, binary: %.3f ms\n\n",
+           convert_time * 1000.0, fprintf_time * 1000.0, text_time * 1000.0, binary_time * 1000.0);
+    
+    remove("output_format_test.txt");
+    remove("output_format_test.bin");
+    bench_frame_free(&frame);
+}
+
+// Frames past the 32-bit pixel count: 2^30 pixels as a baseline, just
+// over 2^31 (past INT_MAX) and 2^32 (past UINT32_MAX), converted with the
+// size_t drivers on the thread pool. A frame runs only if input and
+// output fit in the physical memory free at the time, since overcommitted
+// pages would be swapped or killed, not timed. Each frame is converted
+// LARGE_RUNS times after one untimed call and verified in full, a piece
+// at a time.
+#define LARGE_RUNS 3
 
-// High-resolution timer function
-double get_time() {
+// Physical memory not in use, in bytes (0 if unknown)
+static long long available_memory_bytes(void) {
 #ifdef _WIN32
-    LARGE_INTEGER frequency, counter;
-    QueryPerformanceFrequency(&frequency);
-    QueryPerformanceCounter(&counter);
-    return (double)counter.QuadPart / (double)frequency.QuadPart;
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    return GlobalMemoryStatusEx(&status) ? (long long)status.ullAvailPhys : 0;
 #else
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    return pages > 0 && page_size > 0 ? (long long)pages * page_size : 0;
 #endif
 }
 
-// Check correctness of conversion
-int check_correctness(int *int_array, float *float_array, int n) {
-    for (int i = 0; i < n; i++) {
-        float expected = (float)int_array[i] / 255.0f;
-        float diff = float_array[i] - expected;
-        if (diff < 0) diff = -diff; // absolute value
-        if (diff > 0.001f) { // Allow small floating point error
-            return 0;
+// Mismatches of a large int or uint8_t conversion, checked in pieces
+static long long verify_large(size_t n, const int *a, const uint8_t *a8, const float *out) {
+    long long mismatches = 0;
+    for (size_t start = 0; start < n; start += LARGE_PIECE_PIXELS) {
+        int count = n - start < LARGE_PIECE_PIXELS ? (int)(n - start) : LARGE_PIECE_PIXELS;
+        mismatches += a != NULL ? verify_int_to_float(count, a + start, out + start, NULL)
+                                : verify_u8_to_float(count, a8 + start, out + start, NULL);
+    }
+    return mismatches;
+}
+
+int run_large_frame_test(FILE *file) {
+    int sides[3] = {32768, 46341, 65536};   // 2^30, 2^31 + 4633, 2^32 pixels
+    int threads = parallel_init(0);
+    int failures = 0;
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Large Frames: size_t pixel counts past 2^31 and 2^32, %d threads\n", threads);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Large frames (%d threads)...\n", threads);
+    
+    for (int input = 0; input < 2; input++) {
+        int in_bytes = input == 0 ? 1 : 4;
+        const char *input_name = input == 0 ? "uint8" : "int32";
+        for (int size_idx = 0; size_idx < 3; size_idx++) {
+            int side = sides[size_idx];
+            size_t n, bytes;
+            if (image_pixel_count(side, side, &n) != 0 || size_mul_checked(n, in_bytes + sizeof(float), &bytes) != 0) {
+                fprintf(file, "%s %dx%d: too large for this platform\n", input_name, side, side);
+                continue;
+            }
+            long long available = available_memory_bytes();
+            if ((double)available < bytes * 1.1) {
+                fprintf(file, "%s %dx%d (%lld pixels): skipped, needs %.1f GB, %.1f GB free\n",
+                        input_name, side, side, (long long)n, bytes / 1e9, available / 1e9);
+                printf("  %s %dx%d: skipped (needs %.1f GB)\n", input_name, side, side, bytes / 1e9);
+                continue;
+            }
+            
+            void *in = malloc(n * in_bytes);
+            float *out = alloc_float_buffer_large(n);
+            if (in == NULL || out == NULL) {
+                fprintf(file, "%s %dx%d: Memory allocation failed\n", input_name, side, side);
+                free(in);
+                free_float_buffer(out);
+                continue;
+            }
+            int *a = input == 1 ? (int *)in : NULL;
+            uint8_t *a8 = input == 0 ? (uint8_t *)in : NULL;
+            for (size_t i = 0; i < n; i++) {
+                uint8_t v = (uint8_t)(i * 2654435761u >> 24);
+                if (a != NULL) a[i] = v; else a8[i] = v;
+            }
+            memset(out, 0, n * sizeof(float));
+            
+            double times[LARGE_RUNS];
+            double sum = 0.0, sum_sq = 0.0;
+            int ok = 1;
+            for (int run = -1; run < LARGE_RUNS && ok; run++) {
+                double start_time = get_time();
+                ok = (a != NULL ? imgCvtGrayInttoFloat_Large_into(n, a, out)
+                                : imgCvtGrayU8toFloat_Large_into(n, a8, out)) == 0;
+                double elapsed = get_time() - start_time;
+                if (run >= 0) {
+                    times[run] = elapsed;
+                    sum += elapsed;
+                    sum_sq += elapsed * elapsed;
+                }
+            }
+            long long mismatches = ok ? verify_large(n, a, a8, out) : -1;
+            if (mismatches != 0) {
+                failures++;
+            }
+            
+            if (ok) {
+                bench_stats_t stats;
+                memset(&stats, 0, sizeof(stats));
+                qsort(times, LARGE_RUNS, sizeof(double), compare_doubles);
+                stats.min = times[0];
+                stats.median = percentile(times, LARGE_RUNS, 0.50);
+                stats.p90 = percentile(times, LARGE_RUNS, 0.90);
+                stats.p99 = percentile(times, LARGE_RUNS, 0.99);
+                stats.mean = sum / LARGE_RUNS;
+                double variance = sum_sq / LARGE_RUNS - stats.mean * stats.mean;
+                stats.stddev = variance > 0.0 ? sqrt(variance) : 0.0;
+                stats.gbps = stats.median > 0.0 ? (in_bytes + 4.0) * n / stats.median / 1e9 : 0.0;
+                stats.reps = 1;
+                stats.samples = LARGE_RUNS;
+                record_result("large", input_name, "auto", side, side, threads, &stats);
+                fprintf(file, "%s %dx%d (%lld pixels): min %.3f ms  med %.3f ms  %.2f GB/s  %lld mismatches  %s\n",
+                        input_name, side, side, (long long)n, stats.min * 1000.0, stats.median * 1000.0,
+                        stats.gbps, mismatches, mismatches == 0 ? "PASSED" : "FAILED");
+                printf("  %s %dx%d: %.3f ms, %.2f GB/s%s\n", input_name, side, side,
+                       stats.median * 1000.0, stats.gbps, mismatches == 0 ? "" : " (FAILED)");
+            } else {
+                fprintf(file, "%s %dx%d: conversion rejected the frame  FAILED\n", input_name, side, side);
+            }
+            
+            free(in);
+            free_float_buffer(out);
         }
     }
-    return 1;
+    fprintf(file, "\n");
+    parallel_shutdown();
+    printf("\n");
+    return failures;
 }
 
-// Check if two float arrays produce the same output
-int check_outputs_match(float *array1, float *array2, int n) {
-    for (int i = 0; i < n; i++) {
-        float diff = array1[i] - array2[i];
-        if (diff < 0) diff = -diff; // absolute value
-        if (diff > 0.001f) { // Allow small floating point error
-            return 0;
+// In-place vs out-of-place int -> float with the dispatched kernel, on the
+// calling thread and on the pool. Both read and write 4 bytes per pixel;
+// in place needs one buffer instead of two. Timed in-place calls run on
+// frames already converted, which costs the same: the float bits are just
+// different ints. Each mode is verified on a fresh copy of the input.
+// Returns the number of failed checks.
+int run_inplace_comparison(FILE *file) {
+    int sizes[3] = {1024, 4096, 8192};
+    const char *names[4] = {"into", "inplace", "into_parallel", "inplace_parallel"};
+    const char *labels[4] = {"Out of place", "In place", "Out of place, pool", "In place, pool"};
+    void (*calls[4])(const bench_job_t *job) = {call_int, call_int_inplace, call_int_parallel,
+                                                call_int_inplace_parallel};
+    const kernel_t *kernel = selected_kernel();
+    int threads = parallel_init(0);
+    int failures = 0;
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "In-Place Conversion: %s kernel, pool of %d threads\n", kernel->info.label, threads);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("In-place vs out-of-place (%s kernel)...\n", kernel->info.label);
+    
+    for (int size_idx = 0; size_idx < 3; size_idx++) {
+        int side = sizes[size_idx];
+        int total_elements = side * side;
+        
+        int *int_array = (int *)malloc((size_t)total_elements * sizeof(int));
+        int *work = (int *)alloc_float_buffer(total_elements);
+        float *float_array = alloc_float_buffer(total_elements);
+        if (int_array == NULL || work == NULL || float_array == NULL) {
+            fprintf(file, "%dx%d: Memory allocation failed\n\n", side, side);
+            free(int_array);
+            free_float_buffer((float *)work);
+            free_float_buffer(float_array);
+            continue;
+        }
+        for (int i = 0; i < total_elements; i++) {
+            int_array[i] = rand() % 256;
+        }
+        memcpy(work, int_array, (size_t)total_elements * sizeof(int));
+        memset(float_array, 0, (size_t)total_elements * sizeof(float));
+        
+        fprintf(file, "%dx%d (%d pixels):\n", side, side, total_elements);
+        printf("  %dx%d:\n", side, side);
+        
+        double into_time = 0.0;
+        for (int mode = 0; mode < 4; mode++) {
+            int inplace = mode == 1 || mode == 3;
+            int parallel = mode >= 2;
+            bench_job_t job = {.call = calls[mode], .threaded = parallel, .kernel = kernel, .n = total_elements,
+                               .a = inplace ? work : int_array, .out = float_array};
+            bench_stats_t stats;
+            bench_kernel(&job, 8.0, &stats);
+            record_result("inplace", "int32", names[mode], side, side, parallel ? threads : 1, &stats);
+            
+            const float *result = float_array;
+            if (inplace) {
+                memcpy(work, int_array, (size_t)total_elements * sizeof(int));
+                result = parallel ? imgCvtGrayInttoFloat_Parallel_inplace(kernel, total_elements, work)
+                                  : imgCvtGrayInttoFloat_InPlace(total_elements, work);
+            }
+            long long mismatches = verify_int_to_float(total_elements, int_array, result, NULL);
+            if (mismatches != 0) {
+                failures++;
+            }
+            if (mode == 0) into_time = stats.median;
+            
+            double footprint = total_elements * (inplace ? 4.0 : 8.0) / 1048576.0;
+            fprintf(file, "  %-20s median %10.6f ms  %6.2f GB/s  %5.2fx  %7.1f MB  %s\n",
+                    labels[mode], stats.median * 1000.0, stats.gbps,
+                    stats.median > 0.0 ? into_time / stats.median : 0.0, footprint,
+                    mismatches == 0 ? "PASSED" : "FAILED");
+            printf("    %-20s median %.6f ms, %.1f MB%s\n", labels[mode], stats.median * 1000.0,
+                   footprint, mismatches == 0 ? "" : " (FAILED)");
         }
+        fprintf(file, "\n");
+        
+        free(int_array);
+        free_float_buffer((float *)work);
+        free_float_buffer(float_array);
     }
-    return 1;
+    parallel_shutdown();
+    printf("\n");
+    return failures;
+}
+
+// Strided and ROI conversion: a crop or a padded frame converted through
+// the 2D entry points, against copying its rows into a dense array and
+// converting that. GB/s counts the useful input and output bytes only.
+// Each case is verified into an output with padded rows (the padding must
+// stay untouched), and rectangles outside the frame must be rejected.
+// Returns the number of failed checks.
+#define STRIDED_OUT_PAD     7       // Extra floats per output row when verifying
+#define STRIDED_PAD_BITS    0x7FC0DEADu
+
+typedef struct {
+    const char *label;
+    int frame_width, frame_height, stride;
+    gray_roi_t roi;
+} strided_case_t;
+
+static long long verify_strided(const int *a, const uint8_t *a8, int stride, const gray_roi_t *roi,
+                                const float *out, int out_stride) {
+    long long mismatches = 0;
+    for (int y = 0; y < roi->height; y++) {
+        size_t in_offset = (size_t)(roi->y + y) * stride + roi->x;
+        const float *row = out + (size_t)y * out_stride;
+        mismatches += a != NULL ? verify_int_to_float(roi->width, a + in_offset, row, NULL)
+                                : verify_u8_to_float(roi->width, a8 + in_offset, row, NULL);
+        for (int x = roi->width; x < out_stride; x++) {
+            uint32_t bits;
+            memcpy(&bits, row + x, sizeof(bits));
+            mismatches += bits != STRIDED_PAD_BITS;
+        }
+    }
+    return mismatches;
+}
+
+int run_strided_comparison(FILE *file) {
+    static const strided_case_t cases[3] = {
+        {"padded",   1000, 1000, 1024, {0, 0, 1000, 1000}},
+        {"crop",     1920, 1080, 1920, {37, 11, 1000, 1000}},
+        {"crop 4K",  7680, 4320, 7680, {1001, 503, 3840, 2160}},
+    };
+    const char *names[3] = {"copy_then_convert", "2d", "2d_parallel"};
+    const char *labels[3] = {"Copy, then convert", "2D", "2D, pool"};
+    int failures = 0;
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Strided / ROI Conversion: 2D entry points vs copying to a dense array\n");
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Strided / ROI conversion...\n");
+    
+    for (int input = 0; input < 2; input++) {
+        const char *input_name = input == 0 ? "int32" : "uint8";
+        size_t sample = input == 0 ? sizeof(int) : sizeof(uint8_t);
+        for (int c = 0; c < 3; c++) {
+            const strided_case_t *test = &cases[c];
+            const gray_roi_t *roi = &test->roi;
+            int n = roi->width * roi->height;
+            int out_stride = roi->width + STRIDED_OUT_PAD;
+            size_t frame_samples = (size_t)test->frame_height * test->stride;
+            
+            void *frame = malloc(frame_samples * sample);
+            void *scratch = malloc((size_t)n * sample);
+            float *float_array = alloc_float_buffer((int)((size_t)roi->height * out_stride));
+            if (frame == NULL || scratch == NULL || float_array == NULL) {
+                fprintf(file, "%s %s: Memory allocation failed\n", input_name, test->label);
+                free(frame);
+                free(scratch);
+                free_float_buffer(float_array);
+                continue;
+            }
+            int *a = input == 0 ? (int *)frame : NULL;
+            uint8_t *a8 = input == 1 ? (uint8_t *)frame : NULL;
+            for (size_t i = 0; i < frame_samples; i++) {
+                if (a != NULL) a[i] = rand() % 256; else a8[i] = (uint8_t)(rand() % 256);
+            }
+            size_t roi_offset = (size_t)roi->y * test->stride + roi->x;
+            
+            fprintf(file, "%s %s: %dx%d at (%d, %d) of %dx%d, stride %d\n", input_name, test->label,
+                    roi->width, roi->height, roi->x, roi->y, test->frame_width, test->frame_height, test->stride);
+            printf("  %s %s %dx%d:\n", input_name, test->label, roi->width, roi->height);
+            
+            double copy_time = 0.0;
+            for (int mode = 0; mode < 3; mode++) {
+                int threads = mode == 2 ? parallel_init(0) : 1;
+                bench_job_t job = {.n = n, .a = a != NULL ? a + roi_offset : NULL,
+                                   .a8 = a8 != NULL ? a8 + roi_offset : NULL, .out = float_array,
+                                   .call = mode == 0 ? (a != NULL ? call_copy_int : call_copy_u8)
+                                                     : (a != NULL ? call_2d_int : call_2d_u8),
+                                   .threaded = mode == 2,
+                                   .rows = roi->height, .in_stride = test->stride, .scratch = scratch};
+                bench_stats_t stats;
+                bench_kernel(&job, sample + 4.0, &stats);
+                record_result("strided", input_name, names[mode], roi->height, roi->width, threads, &stats);
+                if (mode == 0) copy_time = stats.median;
+                
+                // Verify into padded rows
+                for (size_t i = 0; i < (size_t)roi->height * out_stride; i++) {
+                    uint32_t bits = STRIDED_PAD_BITS;
+                    memcpy(float_array + i, &bits, sizeof(bits));
+                }
+                int rc;
+                if (mode == 0) {
+                    if (a != NULL) {
+                        copy_rows(&job, job.a, sizeof(int));
+                    } else {
+                        copy_rows(&job, job.a8, sizeof(uint8_t));
+                    }
+                    rc = a != NULL ? imgCvtGrayInttoFloat_2D_into(roi->width, roi->height, (int *)scratch, roi->width, float_array, out_stride)
+                                   : imgCvtGrayU8toFloat_2D_into(roi->width, roi->height, (uint8_t *)scratch, roi->width, float_array, out_stride);
+                } else {
+                    rc = a != NULL ? imgCvtGrayInttoFloat_ROI_into(a, test->frame_width, test->frame_height, test->stride, roi, float_array, out_stride)
+                                   : imgCvtGrayU8toFloat_ROI_into(a8, test->frame_width, test->frame_height, test->stride, roi, float_array, out_stride);
+                }
+                long long mismatches = rc == 0 ? verify_strided(a, a8, test->stride, roi, float_array, out_stride) : -1;
+                if (mode == 2) {
+                    parallel_shutdown();
+                }
+                if (mismatches != 0) {
+                    failures++;
+                }
+                
+                fprintf(file, "  %-20s median %10.6f ms  %6.2f GB/s  %5.2fx  %s\n", labels[mode],
+                        stats.median * 1000.0, stats.gbps, stats.median > 0.0 ? copy_time / stats.median : 0.0,
+                        mismatches == 0 ? "PASSED" : "FAILED");
+                printf("    %-20s median %.6f ms%s\n", labels[mode], stats.median * 1000.0,
+                       mismatches == 0 ? "" : " (FAILED)");
+            }
+            
+            // Rectangles that leave the frame convert nothing
+            gray_roi_t outside = {test->frame_width - roi->width + 1, 0, roi->width, roi->height};
+            int rejected = (a != NULL ? imgCvtGrayInttoFloat_ROI_into(a, test->frame_width, test->frame_height, test->stride, &outside, float_array, out_stride)
+                                      : imgCvtGrayU8toFloat_ROI_into(a8, test->frame_width, test->frame_height, test->stride, &outside, float_array, out_stride)) != 0;
+            if (!rejected) {
+                failures++;
+            }
+            fprintf(file, "  ROI outside the frame: %s\n\n", rejected ? "rejected, PASSED" : "accepted, FAILED");
+            
+            free(frame);
+            free(scratch);
+            free_float_buffer(float_array);
+        }
+    }
+    printf("\n");
+    return failures;
+}
+
+// Fused statistics: conversion that gathers the histogram, min, max, sum
+// and sum of squares as it goes, against converting and then scanning the
+// output (gray_stats_scan), on one thread and on the pool. The fused and
+// scanned statistics must agree: counts, histogram, min and max exactly,
+// the sums to rounding (they are added in a different order). A frame with
+// int values outside 0-255 checks the out-of-range path.
+//
+// Adding m doubles in any order is within (m - 1) * 2^-53 * sum|terms| of
+// the exact total. Neither side adds more than n + GRAY_HIST_BINS terms:
+// the scan adds every pixel, and the fused side adds 256 bin products plus
+// the out-of-range pixels, band by band. So the two sums may differ by up
+// to (n + GRAY_HIST_BINS) * DBL_EPSILON * sum|terms|, and that is the
+// bound used. The terms of sum_sq are never negative. sum|v| is at most
+// sqrt(n * sum_sq) by Cauchy-Schwarz.
+static int same_frame_stats(const gray_stats_t *x, const gray_stats_t *y) {
+    double scale = ((double)x->count + GRAY_HIST_BINS) * DBL_EPSILON;
+    double sum_tolerance = scale * sqrt((double)x->count * x->sum_sq);
+    double sum_sq_tolerance = scale * x->sum_sq;
+    return x->count == y->count && memcmp(x->histogram, y->histogram, sizeof(x->histogram)) == 0 &&
+           x->min == y->min && x->max == y->max &&
+           fabs(x->sum - y->sum) <= sum_tolerance && fabs(x->sum_sq - y->sum_sq) <= sum_sq_tolerance;
+}
+
+int run_stats_comparison(FILE *file) {
+    int sizes[3] = {1000, 4096, 8192};
+    const char *names[4] = {"convert_then_scan", "fused", "convert_then_scan_parallel", "fused_parallel"};
+    const char *labels[4] = {"Convert, then scan", "Fused", "Convert, then scan, pool", "Fused, pool"};
+    int failures = 0;
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Fused Statistics: %d-bin histogram, min, max, mean and variance\n", GRAY_HIST_BINS);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Fused statistics vs convert-then-scan...\n");
+    
+    for (int input = 0; input < 2; input++) {
+        const char *input_name = input == 0 ? "int32" : "uint8";
+        double bytes_per_pixel = input == 0 ? 8.0 : 5.0;
+        for (int size_idx = 0; size_idx < 3; size_idx++) {
+            int side = sizes[size_idx];
+            int total_elements = side * side;
+            
+            int *int_array = (int *)malloc((size_t)total_elements * sizeof(int));
+            uint8_t *u8_array = (uint8_t *)malloc(total_elements);
+            float *float_array = alloc_float_buffer(total_elements);
+            if (int_array == NULL || u8_array == NULL || float_array == NULL) {
+                fprintf(file, "%s %dx%d: Memory allocation failed\n\n", input_name, side, side);
+                free(int_array);
+                free(u8_array);
+                free_float_buffer(float_array);
+                continue;
+            }
+            for (int i = 0; i < total_elements; i++) {
+                int_array[i] = rand() % 256;
+                u8_array[i] = (uint8_t)int_array[i];
+            }
+            memset(float_array, 0, (size_t)total_elements * sizeof(float));
+            
+            fprintf(file, "%s %dx%d (%d pixels):\n", input_name, side, side, total_elements);
+            printf("  %s %dx%d:\n", input_name, side, side);
+            
+            double scan_time = 0.0;
+            gray_stats_t reference;
+            for (int mode = 0; mode < 4; mode++) {
+                int parallel = mode >= 2;
+                int threads = parallel ? parallel_init(0) : 1;
+                gray_stats_t frame_stats;
+                bench_job_t job = {.n = total_elements, .a = input == 0 ? int_array : NULL,
+                                   .a8 = input == 1 ? u8_array : NULL, .out = float_array, .threaded = parallel,
+                                   .call = mode == 1 || mode == 3 ? (input == 0 ? call_stats_int : call_stats_u8)
+                                                                  : (input == 0 ? call_scan_int : call_scan_u8),
+                                   .frame_stats = &frame_stats};
+                bench_stats_t stats;
+                bench_kernel(&job, bytes_per_pixel, &stats);
+                record_result("stats", input_name, names[mode], side, side, threads, &stats);
+                if (mode == 0) {
+                    scan_time = stats.median;
+                    reference = frame_stats;
+                }
+                
+                long long mismatches = input == 0 ? verify_int_to_float(total_elements, int_array, float_array, NULL)
+                                                  : verify_u8_to_float(total_elements, u8_array, float_array, NULL);
+                int ok = mismatches == 0 && same_frame_stats(&reference, &frame_stats);
+                if (parallel) {
+                    parallel_shutdown();
+                }
+                if (!ok) {
+                    failures++;
+                }
+                
+                fprintf(file, "  %-26s median %10.6f ms  %6.2f GB/s  %5.2fx  mean %.6f  var %.6f  %s\n",
+                        labels[mode], stats.median * 1000.0, stats.gbps,
+                        stats.median > 0.0 ? scan_time / stats.median : 0.0,
+                        gray_stats_mean(&frame_stats), gray_stats_variance(&frame_stats), ok ? "PASSED" : "FAILED");
+                printf("    %-26s median %.6f ms%s\n", labels[mode], stats.median * 1000.0, ok ? "" : " (FAILED)");
+            }
+            fprintf(file, "\n");
+            
+            free(int_array);
+            free(u8_array);
+            free_float_buffer(float_array);
+        }
+    }
+    
+    // Out-of-range int input: below 0 and above 255 land in the end bins
+    int values[5000];
+    float out[5000];
+    for (int i = 0; i < 5000; i++) {
+        values[i] = i % 7 == 0 ? -1000 + i : i % 11 == 0 ? 255 + i : rand() % 256;
+    }
+    gray_stats_t fused, scanned;
+    int ok = imgCvtGrayInttoFloat_Stats_into(5000, values, out, &fused) == 0 &&
+             verify_int_to_float(5000, values, out, NULL) == 0 &&
+             gray_stats_scan(5000, out, &scanned) == 0 && same_frame_stats(&fused, &scanned);
+    if (!ok) {
+        failures++;
+    }
+    fprintf(file, "int32 values outside 0-255: min %.6f  max %.6f  bins %lld / %lld  %s\n\n", fused.min, fused.max,
+            fused.histogram[0], fused.histogram[GRAY_HIST_BINS - 1], ok ? "PASSED" : "FAILED");
+    printf("  Values outside 0-255: %s\n\n", ok ? "PASSED" : "FAILED");
+    return failures;
+}
+
+// Multi-threaded scaling: the dispatched kernel on 1, 2, 4, ... threads up
+// to one per CPU. Speedup is relative to 1 thread (median times),
+// efficiency is speedup divided by the thread count.
+void run_thread_scaling(FILE *file) {
+    int sizes[2] = {1000, 8192};  // 8192x8192 = 256 MB of int input
+    const kernel_t *kernel = selected_kernel();
+    int max_threads = parallel_cpu_count();
+    if (max_threads > PARALLEL_MAX_THREADS) max_threads = PARALLEL_MAX_THREADS;
+    
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
+    fprintf(file, "Thread Scaling: %s kernel, %d-pixel bands, up to %d threads\n",
+            kernel->info.label, PARALLEL_BAND_PIXELS, max_threads);
+    fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
+    printf("Thread scaling (%s kernel)...\n", kernel->info.label);
+    
+    for (int size_idx = 0; size_idx < 2; size_idx++) {
+        int side = sizes[size_idx];
+        int total_elements = side * side;
+        
+        int *int_array = (int *)malloc((size_t)total_elements * sizeof(int));
+        float *float_array = alloc_float_buffer(total_elements);
+        if (int_array == NULL || float_array == NULL) {
+            fprintf(file, "%dx%d: Memory allocation failed\n\n", side, side);
+            free(int_array);
+            free_float_buffer(float_array);
+            continue;
+        }
+        for (int i = 0; i < total_elements; i++) {
+            int_array[i] = rand() % 256;
+        }
+        memset(float_array, 0, (size_t)total_elements * sizeof(float));
+        
+        fprintf(file, "%dx%d (%d pixels):\n", side, side, total_elements);
+        printf("  %dx%d:\n", side, side);
+        
+        double single_time = 0.0;
+        for (int threads = 1; ; threads *= 2) {
+            if (threads > max_threads) threads = max_threads;
+            parallel_init(threads);
+            
+            bench_job_t job = {.call = call_int_parallel, .threaded = 1, .kernel = kernel, .n = total_elements,
+                               .a = int_array, .out = float_array};
+            bench_stats_t stats;
+            bench_kernel(&job, 8.0, &stats);
+            record_result("threads", "int32", kernel->info.name, side, side, threads, &stats);
+            double elapsed = stats.median;
+            if (threads == 1) single_time = elapsed;
+            
+            double speedup = elapsed > 0.0 ? single_time / elapsed : 0.0;
+            int ok = check_correctness(int_array, float_array, total_elements);
+            fprintf(file, "  %2d threads: %.6f ms  %.2f GB/s  speedup %.2fx  efficiency %.0f%%  %s\n",
+                   threads, elapsed * 1000.0, 8.0 * total_elements / elapsed / 1e9,
+                   speedup, 100.0 * speedup / threads, ok ? "PASSED" : "FAILED");
+            printf("    %2d threads: %.6f ms, speedup %.2fx, efficiency %.0f%%%s\n",
+                   threads, elapsed * 1000.0, speedup, 100.0 * speedup / threads, ok ? "" : " (FAILED)");
+            
+            if (threads == max_threads) break;
+        }
+        fprintf(file, "\n");
+        
+        free(int_array);
+        free_float_buffer(float_array);
+    }
+    parallel_shutdown();
+    printf("\n");
 }
 
-int main() {
+// Usage: performance_test [min_side max_side]
+//        performance_test --compare base.csv new.csv [threshold_percent]
+// The optional arguments set the range of the size sweep. Compare mode
+// diffs two CSV result files and exits with 1 if anything regressed.
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "--compare") == 0) {
+        if (argc < 4) {
+            printf("Usage: %s --compare base.csv new.csv [threshold_percent]\n", argv[0]);
+            return 2;
+        }
+        double threshold = argc >= 5 ? atof(argv[4]) / 100.0 : 0.05;
+        int regressions = compare_results(argv[2], argv[3], threshold);
+        return regressions < 0 ? 2 : regressions > 0 ? 1 : 0;
+    }
+    
     // Test sizes: 10x10, 100x100, 1000x1000
     int test_sizes[3][2] = {{10, 10}, {100, 100}, {1000, 1000}};
     int num_iterations = 30;
     
+    // Size sweep range, in pixels per side
+    int sweep_min = 16;
+    int sweep_max = 2048;
+    if (argc >= 3) {
+        sweep_min = atoi(argv[1]);
+        sweep_max = atoi(argv[2]);
+        if (sweep_min < 1 || sweep_max < sweep_min || sweep_max > 16384) {
+            printf("Usage: %s [min_side max_side]  (1 <= min_side <= max_side <= 16384)\n", argv[0]);
+            return 1;
+        }
+    }
+    
     // Seed random number generator
     srand((unsigned int)time(NULL));
     
+    const kernel_t *reference_kernel = find_kernel("c");  // Outputs are compared against C
+    
     // Open performance results file
     FILE *file = fopen("performance_test_results.txt", "w");
     if (file == NULL) {
@@ -71,20 +2481,42 @@ int main() {
         return 1;
     }
     
+    // Structured records (CSV and JSON) for --compare and other tools
+    open_records();
+    
+    // Hardware counters, where this host allows them
+    int perf_events = perf_open();
+    char perf_list[128] = "";
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (perf_events & (1 << e)) {
+            snprintf(perf_list + strlen(perf_list), sizeof(perf_list) - strlen(perf_list), "%s%s",
+                     perf_list[0] != '\0' ? ", " : "", perf_event_name(e));
+        }
+    }
+    if (perf_list[0] == '\0') {
+        snprintf(perf_list, sizeof(perf_list), "unavailable (perf_event_open not permitted or IMGCVT_PERF=0)");
+    }
+    
     fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     fprintf(file, "Performance Test Results\n");
-    fprintf(file, "Comparing Assembly vs C Implementation\n");
-    fprintf(file, "Running %d iterations for each image dimension\n", num_iterations);
+    fprintf(file, "Comparing Assembly (Scalar, SSE2, AVX2, AVX-512) vs C Implementation\n");
+    fprintf(file, "Running %d correctness iterations for each image dimension\n", num_iterations);
+    fprintf(file, "Timings: median/p90/p99 of %d samples after %d warm-up calls, small sizes batched\n",
+            BENCH_SAMPLES, BENCH_WARMUP);
+    fprintf(file, "Dispatcher selects: %s\n", selected_kernel()->info.label);
+    fprintf(file, "Hardware counters (calling thread, user space): %s\n", perf_list);
     fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
     
     fprintf(io_file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     fprintf(io_file, "Test Inputs and Outputs\n");
-    fprintf(io_file, "Comparing Assembly vs C Implementation\n");
+    fprintf(io_file, "Comparing Assembly (Scalar, SSE2, AVX2, AVX-512) vs C Implementation\n");
     fprintf(io_file, "Running %d iterations for each image dimension\n", num_iterations);
     fprintf(io_file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
     
     printf("Running performance tests...\n");
-    printf("Comparing Assembly vs C implementation\n");
+    printf("Comparing Assembly (Scalar, SSE2, AVX2, AVX-512) vs C implementation\n");
+    printf("Dispatcher selects: %s (override with IMGCVT_KERNEL)\n", selected_kernel()->info.label);
+    printf("Hardware counters: %s\n", perf_list);
     printf("This may take a while for larger image sizes.\n\n");
     
     // Test each image size
@@ -108,14 +2540,24 @@ int main() {
         
         printf("Testing %dx%d...\n", height, width);
         
-        double total_time_asm = 0.0;
-        double total_time_c = 0.0;
-        int passed_count_asm = 0;
-        int failed_count_asm = 0;
-        int passed_count_c = 0;
-        int failed_count_c = 0;
-        int outputs_match_count = 0;
-        int outputs_mismatch_count = 0;
+        bench_stats_t stats[MAX_KERNELS];
+        double output_time = 0.0;  // Writing test_inputs_outputs.txt, reported separately
+        int passed_count[MAX_KERNELS] = {0};
+        int failed_count[MAX_KERNELS] = {0};
+        int outputs_match_count[MAX_KERNELS] = {0};
+        int outputs_mismatch_count[MAX_KERNELS] = {0};
+        
+        // Output buffers are allocated (and pre-faulted) once per size, so
+        // the timings below measure only the conversion kernels
+        float *float_arrays[MAX_KERNELS] = {NULL};
+        for (int k = 0; k < num_kernels; k++) {
+            if (kernel_supported(&kernels[k].info)) {
+                float_arrays[k] = alloc_float_buffer(total_elements);
+                if (float_arrays[k] != NULL) {
+                    memset(float_arrays[k], 0, total_elements * sizeof(float));
+                }
+            }
+        }
         
         // Run iterations
         for (int iteration = 0; iteration < num_iterations; iteration++) {
@@ -127,7 +2569,7 @@ int main() {
                 continue;
             }
             
-            // Generate random pixel values (0-255) - same input for both versions
+            // Generate random pixel values (0-255) - same input for every kernel
             for (int i = 0; i < total_elements; i++) {
                 array[i] = rand() % 256;
             }
@@ -136,108 +2578,62 @@ int main() {
             if (height <= 100) {
                 fprintf(io_file, "Iteration %d:\n", iteration + 1);
                 fprintf(io_file, "Input (Integer Pixel Values):\n");
-                for (int i = 0; i < height; i++) {
-                    for (int j = 0; j < width; j++) {
-                        fprintf(io_file, "%d ", array[i * width + j]);
-                    }
-                    fprintf(io_file, "\n");
-                }
+                double output_start = get_time();
+                write_int_text(io_file, array, height, width);
+                output_time += get_time() - output_start;
                 fprintf(io_file, "\n");
             }
             
-            // Test Assembly version
-            double start_time_asm = get_time();
-            float *float_array_asm = imgCvtGrayInttoFloat(total_elements, array);
-            double end_time_asm = get_time();
+            fprintf(file, "Iteration %d:\n", iteration + 1);
             
-            double elapsed_asm = 0.0;
-            int correctness_asm = 0;
-            if (float_array_asm == NULL) {
-                fprintf(file, "Iteration %d (Assembly): FAILED - Memory allocation failed\n", iteration + 1);
-                if (height <= 100) {
-                    fprintf(io_file, "Assembly Output: FAILED - Memory allocation failed\n");
-                }
-                failed_count_asm++;
-            } else {
-                elapsed_asm = end_time_asm - start_time_asm;
-                total_time_asm += elapsed_asm;
-                correctness_asm = check_correctness(array, float_array_asm, total_elements);
-                if (correctness_asm) {
-                    passed_count_asm++;
-                } else {
-                    failed_count_asm++;
+            // Test each available kernel on the same input
+            for (int k = 0; k < num_kernels; k++) {
+                if (!kernel_supported(&kernels[k].info)) {
+                    continue;
                 }
                 
-                // Write assembly output to IO file - only for 10x10 and 100x100
-                if (height <= 100) {
-                    fprintf(io_file, "Assembly Output (Float Pixel Values):\n");
-                    for (int i = 0; i < height; i++) {
-                        for (int j = 0; j < width; j++) {
-                            fprintf(io_file, "%.2f ", float_array_asm[i * width + j]);
-                        }
-                        fprintf(io_file, "\n");
+                if (float_arrays[k] == NULL) {
+                    fprintf(file, "  %-9s FAILED - Memory allocation failed\n", kernels[k].info.label);
+                    if (height <= 100) {
+                        fprintf(io_file, "%s Output: FAILED - Memory allocation failed\n", kernels[k].info.label);
                     }
-                    fprintf(io_file, "\n");
-                }
-            }
-            
-            // Test C version
-            double start_time_c = get_time();
-            float *float_array_c = imgCvtGrayInttoFloat_C(total_elements, array);
-            double end_time_c = get_time();
-            
-            double elapsed_c = 0.0;
-            int correctness_c = 0;
-            if (float_array_c == NULL) {
-                fprintf(file, "Iteration %d (C): FAILED - Memory allocation failed\n", iteration + 1);
-                if (height <= 100) {
-                    fprintf(io_file, "C Output: FAILED - Memory allocation failed\n");
+                    failed_count[k]++;
+                    continue;
                 }
-                failed_count_c++;
-            } else {
-                elapsed_c = end_time_c - start_time_c;
-                total_time_c += elapsed_c;
-                correctness_c = check_correctness(array, float_array_c, total_elements);
-                if (correctness_c) {
-                    passed_count_c++;
+                
+                kernels[k].convert_into(total_elements, array, float_arrays[k]);
+                int correctness = check_correctness(array, float_arrays[k], total_elements);
+                if (correctness) {
+                    passed_count[k]++;
                 } else {
-                    failed_count_c++;
+                    failed_count[k]++;
                 }
                 
-                // Write C output to IO file - only for 10x10 and 100x100
+                fprintf(file, "  %-9s %s\n", kernels[k].info.label, correctness ? "PASSED" : "FAILED");
+                
+                // Write kernel output to IO file - only for 10x10 and 100x100
                 if (height <= 100) {
-                    fprintf(io_file, "C Output (Float Pixel Values):\n");
-                    for (int i = 0; i < height; i++) {
-                        for (int j = 0; j < width; j++) {
-                            fprintf(io_file, "%.2f ", float_array_c[i * width + j]);
-                        }
-                        fprintf(io_file, "\n");
-                    }
+                    fprintf(io_file, "%s Output (Float Pixel Values):\n", kernels[k].info.label);
+                    double output_start = get_time();
+                    write_float_text(io_file, float_arrays[k], height, width);
+                    output_time += get_time() - output_start;
                     fprintf(io_file, "\n");
                 }
             }
             
-            // Check if outputs match (both must have succeeded)
-            int outputs_match = 0;
-            if (float_array_asm != NULL && float_array_c != NULL) {
-                outputs_match = check_outputs_match(float_array_asm, float_array_c, total_elements);
+            // Check that every kernel matches the C reference output
+            float *reference = float_arrays[reference_kernel - kernels];
+            for (int k = 0; k < num_kernels; k++) {
+                if (&kernels[k] == reference_kernel || float_arrays[k] == NULL || reference == NULL) {
+                    continue;
+                }
+                int outputs_match = check_outputs_match(float_arrays[k], reference, total_elements);
                 if (outputs_match) {
-                    outputs_match_count++;
+                    outputs_match_count[k]++;
                 } else {
-                    outputs_mismatch_count++;
+                    outputs_mismatch_count[k]++;
                 }
-            }
-            
-            // Write iteration results to performance file
-            fprintf(file, "Iteration %d:\n", iteration + 1);
-            fprintf(file, "  Assembly: %s - Time: %.6f ms (%.9f seconds)\n", 
-                   correctness_asm ? "PASSED" : "FAILED", 
-                   elapsed_asm * 1000.0, elapsed_asm);
-            fprintf(file, "  C:        %s - Time: %.6f ms (%.9f seconds)\n", 
-                   correctness_c ? "PASSED" : "FAILED", 
-                   elapsed_c * 1000.0, elapsed_c);
-            if (float_array_asm != NULL && float_array_c != NULL) {
-                fprintf(file, "  Outputs Match: %s\n", outputs_match ? "YES" : "NO");
+                fprintf(file, "  %s Outputs Match C: %s\n", kernels[k].info.label, outputs_match ? "YES" : "NO");
             }
             fprintf(file, "\n");
             
@@ -248,25 +2644,78 @@ int main() {
             
             // Free memory
             free(array);
-            if (float_array_asm != NULL) free(float_array_asm);
-            if (float_array_c != NULL) free(float_array_c);
         }
         
-        // Calculate average times
-        double avg_time_asm = total_time_asm / num_iterations;
-        double avg_time_asm_ms = avg_time_asm * 1000.0;
-        double avg_time_c = total_time_c / num_iterations;
-        double avg_time_c_ms = avg_time_c * 1000.0;
+        // Timing: one fixed input, measured with the statistical harness
+        memset(stats, 0, sizeof(stats));
+        int *bench_array = (int *)malloc(total_elements * sizeof(int));
+        if (bench_array != NULL) {
+            for (int i = 0; i < total_elements; i++) {
+                bench_array[i] = rand() % 256;
+            }
+            fprintf(file, "Timing (%d samples after %d warm-up calls, per-call times):\n",
+                    BENCH_SAMPLES, BENCH_WARMUP);
+            for (int k = 0; k < num_kernels; k++) {
+                if (float_arrays[k] == NULL) {
+                    continue;
+                }
+                bench_job_t job = {.call = call_int, .kernel = &kernels[k], .n = total_elements, .a = bench_array,
+                                   .out = float_arrays[k]};
+                bench_kernel(&job, 8.0, &stats[k]);
+                print_bench_stats(file, kernels[k].info.label, &stats[k]);
+                record_result("main", "int32", kernels[k].info.name, height, width, 1, &stats[k]);
+            }
+            fprintf(file, "\n");
+            free(bench_array);
+        }
+        
+        for (int k = 0; k < num_kernels; k++) {
+            if (float_arrays[k] != NULL) free_float_buffer(float_arrays[k]);
+        }
         
         fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n\n");
         
-        printf("  Assembly: %d passed, %d failed, Avg: %.6f ms\n", 
-               passed_count_asm, failed_count_asm, avg_time_asm_ms);
-        printf("  C:        %d passed, %d failed, Avg: %.6f ms\n", 
-               passed_count_c, failed_count_c, avg_time_c_ms);
-        printf("  Outputs Match: %d, Mismatch: %d\n\n", outputs_match_count, outputs_mismatch_count);
+        if (height <= 100) {
+            printf("  Writing inputs/outputs: %.3f ms total\n", output_time * 1000.0);
+        }
+        
+        // Report median times and speedup over the scalar assembly
+        double median_scalar_ms = stats[0].median * 1000.0;
+        for (int k = 0; k < num_kernels; k++) {
+            if (!kernel_supported(&kernels[k].info)) {
+                printf("  %-9s skipped (not supported by this CPU)\n", kernels[k].info.label);
+                continue;
+            }
+            double median_ms = stats[k].median * 1000.0;
+            printf("  %-9s %d passed, %d failed, Median: %.6f ms, %.2f cyc/px, Speedup vs scalar: %.2fx\n", 
+                   kernels[k].info.label, passed_count[k], failed_count[k], median_ms,
+                   stats[k].cycles_per_pixel, median_ms > 0.0 ? median_scalar_ms / median_ms : 0.0);
+            if (&kernels[k] != reference_kernel) {
+                printf("            Outputs Match C: %d, Mismatch: %d\n", 
+                       outputs_match_count[k], outputs_mismatch_count[k]);
+            }
+        }
+        printf("\n");
     }
     
+    int round_trip_failures = run_round_trip_test(file);
+    int differential_failures = run_differential_test(file);
+    run_input_width_comparison(file);
+    run_size_sweep(file, sweep_min, sweep_max);
+    run_store_comparison(file);
+    run_rgb_comparison(file);
+    run_affine_comparison(file);
+    run_half_comparison(file);
+    run_inverse_comparison(file);
+    run_batch_comparison(file);
+    run_pool_comparison(file);
+    run_output_comparison(file);
+    int large_failures = run_large_frame_test(file);
+    int inplace_failures = run_inplace_comparison(file);
+    int strided_failures = run_strided_comparison(file);
+    int stats_failures = run_stats_comparison(file);
+    run_thread_scaling(file);
+    
     fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
     fprintf(file, "Performance Test Complete\n");
     fprintf(file, "+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+\n");
@@ -277,10 +2726,14 @@ int main() {
     
     fclose(file);
     fclose(io_file);
+    close_records();
+    perf_close();
     
     printf("Performance test complete!\n");
     printf("Results saved to: performance_test_results.txt\n");
+    printf("Records saved to: performance_test_results.csv, performance_test_results.json\n");
     printf("Inputs/Outputs saved to: test_inputs_outputs.txt\n");
     
-    return 0;
+    return round_trip_failures > 0 || differential_failures > 0 || large_failures > 0 ||
+           inplace_failures > 0 || strided_failures > 0 || stats_failures > 0 ? 1 : 0;
 }